@@ -0,0 +1,99 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// compares util::GlobList with the WildcardMatch loops it replaced, on
+// the config mask lists matched most often. exits non zero if the two
+// ever disagree
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "util/glob.hpp"
+#include "util/string.hpp"
+
+namespace
+{
+
+const int lookups = 2000000;
+
+template <typename Function>
+double NanosecondsEach(const std::vector<std::string>& inputs, Function function, long& hits)
+{
+  hits = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < lookups; ++i)
+  {
+    hits += function(inputs[i % inputs.size()]);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / lookups;
+}
+
+bool Case(const char* name, const std::vector<std::string>& masks, 
+          const std::vector<std::string>& inputs, bool iCase)
+{
+  util::GlobList list(iCase);
+  list.Add(masks.begin(), masks.end());
+  
+  for (const auto& input : inputs)
+  {
+    if (util::WildcardMatch(masks, input, iCase) != list.Match(input))
+    {
+      printf("%s: different result for %s\n", name, input.c_str());
+      return false;
+    }
+  }
+  
+  long loopHits;
+  long listHits;
+  double before = NanosecondsEach(inputs, [&](const std::string& input)
+    { return util::WildcardMatch(masks, input, iCase); }, loopHits);
+  double after = NanosecondsEach(inputs, [&](const std::string& input)
+    { return list.Match(input); }, listHits);
+  
+  printf("%-16s %2zu masks  %6.0f ns -> %6.0f ns  (%ld hits)\n", 
+         name, masks.size(), before, after, listHits);
+  return loopHits == listHits;
+}
+
+}
+
+int main()
+{
+  bool okay = true;
+  
+  okay &= Case("calc_crc", 
+               { "*.rar", "*.r[0-9][0-9]", "*.zip", "*.mp3", "*.flac", "*.sfv", "*.avi", "*.mkv" },
+               { "/site/incoming/Some.Release-GRP/some.release.r17", 
+                 "/site/incoming/Some.Release-GRP/sample/x.mkv",
+                 "/site/incoming/Some.Release-GRP/some.release.nfo", 
+                 "/site/mp3/Artist-Album-2013-GRP/01-artist-track.mp3" }, false);
+                 
+  okay &= Case("idle_commands", 
+               { "NOOP", "STAT", "PWD", "SITE IDLE*", "SITE WHO" },
+               { "RETR file.rar", "noop", "CWD /site", "PASV", "site who" }, true);
+               
+  okay &= Case("noretrieve", 
+               { "passwd", "group", ".message", "*.log" },
+               { "file.rar", ".message", "some.release.nfo", "x.sfv" }, false);
+               
+  okay &= Case("section paths", 
+               { "/site/incoming/*", "/site/archive/*", "/site/mp3/*", "/site/0day/*" },
+               { "/site/mp3/Artist-Album/01.mp3", "/site/private/x", "/site/0day/today/file.zip" }, 
+               false);
+               
+  return okay ? 0 : 1;
+}
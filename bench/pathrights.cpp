@@ -0,0 +1,154 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// compares path right lookups through cfg::Rights with the rule by rule
+// loop it replaced, over a rule set shaped like a production config.
+// exits non zero if the two ever pick a different rule
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include <boost/algorithm/string/replace.hpp>
+#include "cfg/setting.hpp"
+#include "util/string.hpp"
+
+namespace
+{
+
+// the old evaluator, minus the acl evaluation both share
+const cfg::Right* LoopMatch(const std::vector<cfg::Right>& rights, const std::string& username,
+                            const std::string& groupname, const std::string& path)
+{
+  for (const auto& right : rights)
+  {
+    if (right.SpecialVar())
+    {
+      std::string specialPath(right.Path());
+      boost::replace_all(specialPath, "[:username:]", username);
+      boost::replace_all(specialPath, "[:groupname:]", groupname);
+      if (util::WildcardMatch(specialPath, path)) return &right;
+    }
+    else 
+    if (util::WildcardMatch(right.Path(), path)) return &right;
+  }
+  return nullptr;
+}
+
+std::vector<std::vector<std::string>> RuleSet()
+{
+  const char* sections[] = 
+  { 
+    "0DAY", "APPS", "MP3", "TV", "X264", "XVID", 
+    "DVDR", "GAMES", "EBOOK", "FLAC", "MVID", "REQUESTS" 
+  };
+  
+  std::vector<std::vector<std::string>> toks;
+  toks.push_back({ "/site/private/[:groupname:]/*", "-[:groupname:]", "!*" });
+  toks.push_back({ "/site/users/[:username:]/*", "-[:username:]" });
+  for (const char* section : sections)
+  {
+    std::string path(std::string("/site/") + section);
+    toks.push_back({ path + "/*/Sample/*", "!*" });
+    toks.push_back({ path + "/*/[Ss]ubs/*", "=STAFF" });
+    toks.push_back({ path + "/_PRE/*", "=SITEOP" });
+    toks.push_back({ path + "/*NUKED*", "1" });
+    toks.push_back({ path + "/*", "*" });
+    for (int day = 1; day <= 8; ++day)
+    {
+      char dated[16];
+      snprintf(dated, sizeof(dated), "/10%02d/*", day);
+      toks.push_back({ path + dated, "=GRP" + std::to_string(day), "1" });
+    }
+  }
+  toks.push_back({ "/site/ARCHIVE/*", "1" });
+  toks.push_back({ "*.nfo", "*" });
+  toks.push_back({ "*", "1" });
+  return toks;
+}
+
+std::vector<std::string> Paths()
+{
+  const char* sections[] = { "0DAY", "APPS", "MP3", "TV", "X264", "XVID" };
+  std::vector<std::string> paths;
+  std::mt19937 rng(7);
+  for (int i = 0; i < 2000; ++i)
+  {
+    std::string path("/site/");
+    path += sections[rng() % 6];
+    path += "/Some.Release.Name-" + std::to_string(i) + "/";
+    if (rng() % 3 == 0) path += "Sample/";
+    path += "file" + std::to_string(rng() % 50) + (rng() % 5 ? ".rar" : ".nfo");
+    paths.emplace_back(path);
+  }
+  paths.emplace_back("/site/ARCHIVE/x");
+  paths.emplace_back("/site/private/STAFF/x");
+  paths.emplace_back("/site/users/bob/x");
+  return paths;
+}
+
+template <typename Function>
+double NanosecondsEach(const std::vector<std::string>& paths, int rounds, Function function)
+{
+  volatile size_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; ++i)
+  {
+    for (const auto& path : paths) sink += function(path) != nullptr;
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / (rounds * paths.size());
+}
+
+}
+
+int main()
+{
+  std::vector<cfg::Right> loop;
+  cfg::Rights rights;
+  for (const auto& toks : RuleSet())
+  {
+    loop.emplace_back(toks);
+    rights.Add(toks);
+  }
+  
+  const std::string username("bob");
+  const std::string groupname("STAFF");
+  auto paths = Paths();
+  
+  for (const auto& path : paths)
+  {
+    const cfg::Right* expected = LoopMatch(loop, username, groupname, path);
+    const cfg::Right* actual = rights.Match(path, username, &groupname);
+    if ((expected == nullptr) != (actual == nullptr) ||
+        (expected && expected - loop.data() != actual - &rights[0]))
+    {
+      printf("different rule for %s\n", path.c_str());
+      return 1;
+    }
+  }
+  
+  const int rounds = 200;
+  double before = NanosecondsEach(paths, rounds, [&](const std::string& path)
+    { return LoopMatch(loop, username, groupname, path); });
+  double after = NanosecondsEach(paths, rounds, [&](const std::string& path)
+    { return rights.Match(path, username, &groupname); });
+    
+  printf("%zu rules, %zu paths\n", loop.size(), paths.size());
+  printf("rule by rule: %8.0f ns per lookup\n", before);
+  printf("cfg::Rights:  %8.0f ns per lookup\n", after);
+  return 0;
+}
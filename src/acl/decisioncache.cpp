@@ -0,0 +1,64 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "acl/decisioncache.hpp"
+
+namespace acl { namespace path
+{
+
+std::atomic<unsigned long> DecisionCache::currentGeneration(0);
+
+DecisionPtr DecisionCache::Lookup(const std::string& key, int configVersion,
+                                  unsigned long generation)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (configVersion != this->configVersion || generation != this->generation) return nullptr;
+  auto it = decisions.find(key);
+  return it != decisions.end() ? it->second : nullptr;
+}
+
+void DecisionCache::Insert(const std::string& key, int configVersion, unsigned long generation,
+                           const DecisionPtr& decision)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  // made from group names replaced since
+  if (generation != currentGeneration) return;
+  if (configVersion != this->configVersion || generation != this->generation ||
+      decisions.size() >= maximumDecisions)
+  {
+    decisions.clear();
+    this->configVersion = configVersion;
+    this->generation = generation;
+  }
+  decisions[key] = decision;
+}
+
+std::shared_ptr<const ACLInfo> DecisionCache::Info(unsigned long generation)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (generation != infoGeneration) return nullptr;
+  return info;
+}
+
+void DecisionCache::Bind(unsigned long generation, const std::shared_ptr<const ACLInfo>& info)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (generation != currentGeneration) return;
+  this->info = info;
+  infoGeneration = generation;
+}
+
+} /* path namespace */
+} /* acl namespace */
@@ -0,0 +1,91 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __ACL_DECISIONCACHE_HPP
+#define __ACL_DECISIONCACHE_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "util/error.hpp"
+#include "util/glob.hpp"
+
+namespace acl 
+{
+
+struct ACLInfo;
+
+namespace path
+{
+
+// the outcome of a right for every entry of one directory
+struct Decision
+{
+  bool perEntry;     // depends on the entry, check each one in full
+  util::Error result;
+  std::vector<util::GlobList> hiddenMasks; // entries matching are hidden from view
+  
+  // rules of the right matching only some entries, tried in order before 
+  // falling back on result, with whether each allows the entry
+  std::vector<std::pair<unsigned, bool>> rules;
+  std::string groupname; // bound to [:groupname:] when matching them
+  
+  Decision() : perEntry(false), result(util::Error::Success()) { }
+};
+
+typedef std::shared_ptr<const Decision> DecisionPtr;
+
+// a user's decisions by directory, right and whether the entries are
+// directories. each copy of a user has its own, dropped when the user is
+// modified or reloaded, whenever the config in use changes and whenever
+// groups are replicated, as decisions hold the primary group's name.
+// the user's ACLInfo is bound here too, so it is only built once until
+// then rather than for every check
+class DecisionCache
+{
+  std::mutex mutex;
+  std::unordered_map<std::string, DecisionPtr> decisions;
+  int configVersion;
+  unsigned long generation;
+  std::shared_ptr<const ACLInfo> info;
+  unsigned long infoGeneration;
+  
+  static std::atomic<unsigned long> currentGeneration;
+  static const size_t maximumDecisions = 4096;
+  
+public:
+  DecisionCache() : configVersion(-1), generation(0), infoGeneration(0) { }
+  
+  // generation is Generation() as it was before the decision was made
+  DecisionPtr Lookup(const std::string& key, int configVersion, unsigned long generation);
+  void Insert(const std::string& key, int configVersion, unsigned long generation,
+              const DecisionPtr& decision);
+  
+  // nullptr if none is bound or groups have been replicated since
+  std::shared_ptr<const ACLInfo> Info(unsigned long generation);
+  void Bind(unsigned long generation, const std::shared_ptr<const ACLInfo>& info);
+  
+  static unsigned long Generation() { return currentGeneration; }
+  // every user's decisions are stale
+  static void Invalidate() { ++currentGeneration; }
+};
+
+} /* path namespace */
+} /* acl namespace */
+
+#endif
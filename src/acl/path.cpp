@@ -13,10 +13,11 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-#include <boost/algorithm/string/replace.hpp>
 #include <boost/regex.hpp>
 #include "acl/path.hpp"
+#include "acl/decisioncache.hpp"
 #include "fs/owner.hpp"
+#include "fs/trash.hpp"
 #include "cfg/get.hpp"
 #include "util/string.hpp"
 #include "acl/user.hpp"
@@ -37,50 +38,20 @@ bool HiddenFile(const fs::VirtualPath& path)
 
   for (auto& hf : cfg::Get().HiddenFiles())
   {
-    if (util::WildcardMatch(hf.Path(), dirname))
-    {
-      for (auto& mask : hf.Masks())
-      {
-        if (util::WildcardMatch(mask, basename)) return true;
-      }
-    }
+    if (hf.Path().Match(dirname) && hf.Masks().Match(basename)) return true;
   }
   return false;
 }
 
-bool Evaluate(const std::vector<cfg::Right>& rights, 
-              const User& user, const fs::VirtualPath& path)
+bool Evaluate(const cfg::Rights& rights, const User& user, const fs::VirtualPath& path)
 {
-  std::string group;
-  bool firstSpecial = true;
-  auto info = user.ACLInfo();
-
-  for (const auto& right : rights)
-  {
-    if (right.SpecialVar())
-    {
-      std::string specialPath(right.Path());
-      boost::replace_all(specialPath, "[:username:]", user.Name());
-      if (firstSpecial)
-      {
-        if (user.PrimaryGID() != -1)
-        {
-          group = user.PrimaryGroup();
-        }
-        firstSpecial = false;
-      }
-      
-      if (!group.empty())
-        boost::replace_all(specialPath, "[:groupname:]", group);
-        
-      if (util::WildcardMatch(specialPath, path.ToString()))
-        return right.ACL().Evaluate(info);
-    }
-    else
-      if (util::WildcardMatch(right.Path(), path.ToString()))
-        return right.ACL().Evaluate(info);
-  }
-  return false;
+  // the rules are matched against the strings bound for the session,
+  // nothing is looked up or copied
+  auto info = user.BoundACLInfo();
+  const std::string* group = user.PrimaryGID() != -1 && !info->groupname.empty() ? 
+                             &info->groupname : nullptr;
+  const cfg::Right* right = rights.Match(path.ToString(), info->username, group);
+  return right && right->ACL().Evaluate(*info);
 }
 
 template <Type type>
@@ -178,12 +149,8 @@ struct Traits<Download>
 private:
   static util::Error CheckNoretrieve(const fs::VirtualPath& path)
   {
-    const cfg::Config& config = cfg::Get();
-    for (auto& mask : config.Noretrieve())
-    {
-      if (util::WildcardMatch(mask, path.Basename().ToString()))
-        return util::Error::Failure(EACCES);
-    }
+    if (cfg::Get().Noretrieve().Match(path.Basename().ToString()))
+      return util::Error::Failure(EACCES);
     return util::Error::Success();
   }
 
@@ -412,11 +379,11 @@ struct Traits<Hideowner>
 
 bool PrivatePath(const fs::VirtualPath& path, const User& user)
 {
-  auto info = user.ACLInfo();
+  auto info = user.BoundACLInfo();
   for (const auto& pp : cfg::Get().Privpath())
   {
     if (!path.ToString().compare(0, pp.Path().length(), pp.Path()))
-      return !pp.ACL().Evaluate(info);
+      return !pp.ACL().Evaluate(*info);
   }
   return false;
 }
@@ -441,6 +408,8 @@ util::Error InnerAllowed(const User& user, const fs::VirtualPath& path)
   if (!InsideHomeDir(user, path)) return util::Error::Failure(EACCES);
   if (!InsideHomeDir(user, path)) return util::Error::Failure(ENOENT);
   if (PrivatePath(path, user)) return util::Error::Failure(ENOENT);
+  // wiped trees waiting for the reaper, nothing may touch these
+  if (fs::IsTrash(path.ToString())) return util::Error::Failure(ENOENT);
   return Traits<type>::Allowed(user, path);
 }
 
@@ -483,6 +452,172 @@ template util::Error DirAllowed<View>(const User& user, const fs::VirtualPath& p
 template util::Error DirAllowed<Hideinwho>(const User& user, const fs::VirtualPath& path);
 template util::Error DirAllowed<Hideowner>(const User& user, const fs::VirtualPath& path);
 
+namespace
+{
+
+template <Type type>
+struct DecisionTraits;
+
+template <>
+struct DecisionTraits<View>
+{
+  static void Decide(const User&, const std::string& prefix, bool, Decision& decision)
+  {
+    if (fs::IsTrash(prefix))
+    {
+      decision.result = util::Error::Failure(ENOENT);
+      return;
+    }
+    
+    for (auto& hf : cfg::Get().HiddenFiles())
+    {
+      if (hf.Path().Match(prefix)) decision.hiddenMasks.push_back(hf.Masks());
+    }
+  }
+  
+  static util::Error Entry(const User&, const Decision& decision, const fs::VirtualPath&, 
+                           const fs::Path& name, bool)
+  {
+    if (decision.result)
+    {
+      if (name == fs::trashName) return util::Error::Failure(ENOENT);
+      for (const auto& masks : decision.hiddenMasks)
+      {
+        if (masks.Match(name.ToString())) return util::Error::Failure(ENOENT);
+      }
+    }
+    return decision.result;
+  }
+};
+
+template <>
+struct DecisionTraits<Hideowner>
+{
+  static void Decide(const User& user, const std::string& prefix, bool isDirectory, 
+                     Decision& decision)
+  {
+    const cfg::Rights& rights = cfg::Get().Hideowner();
+    auto info = user.ACLInfo();
+    if (user.PrimaryGID() != -1) decision.groupname = info.groupname;
+    const std::string* group = !decision.groupname.empty() ? &decision.groupname : nullptr;
+    
+    std::vector<unsigned> some;
+    const cfg::Right* all;
+    if (!rights.MatchEntries(prefix, isDirectory, info.username, group, some, all))
+    {
+      decision.perEntry = true;
+      return;
+    }
+    
+    for (unsigned rule : some)
+      decision.rules.emplace_back(rule, rights[rule].ACL().Evaluate(info));
+    if (!all || !all->ACL().Evaluate(info))
+      decision.result = util::Error::Failure(EACCES);
+  }
+  
+  static util::Error Entry(const User& user, const Decision& decision, 
+                           const fs::VirtualPath& directory, const fs::Path& name, 
+                           bool isDirectory)
+  {
+    if (decision.rules.empty()) return decision.result;
+    
+    std::string path((directory / name).ToString());
+    if (isDirectory) path += '/';
+    
+    const cfg::Rights& rights = cfg::Get().Hideowner();
+    const std::string* group = !decision.groupname.empty() ? &decision.groupname : nullptr;
+    for (const auto& rule : decision.rules)
+    {
+      if (rights.MatchRule(rule.first, path, user.Name(), group))
+        return rule.second ? util::Error::Success() : util::Error::Failure(EACCES);
+    }
+    return decision.result;
+  }
+};
+
+// mirrors InnerAllowed for every entry of the directory at prefix
+template <Type type>
+Decision Decide(const User& user, const std::string& prefix, bool isDirectory)
+{
+  Decision decision;
+  
+  std::string homeDir(user.HomeDir());
+  if (homeDir.empty())
+  {
+    decision.result = util::Error::Failure(EACCES);
+    return decision;
+  }
+  
+  if (homeDir.back() != '/') homeDir += '/';
+  if (!util::StartsWith(prefix, homeDir))
+  {
+    if (util::StartsWith(homeDir, prefix)) decision.perEntry = true;
+    else decision.result = util::Error::Failure(EACCES);
+    return decision;
+  }
+  
+  auto info = user.ACLInfo();
+  for (const auto& pp : cfg::Get().Privpath())
+  {
+    if (util::StartsWith(prefix, pp.Path()))
+    {
+      if (!pp.ACL().Evaluate(info))
+      {
+        decision.result = util::Error::Failure(ENOENT);
+        return decision;
+      }
+      break;
+    }
+    
+    if (util::StartsWith(pp.Path(), prefix))
+    {
+      decision.perEntry = true;
+      return decision;
+    }
+  }
+  
+  DecisionTraits<type>::Decide(user, prefix, isDirectory, decision);
+  return decision;
+}
+
+}
+
+template <Type type>
+util::Error EntryAllowed(const User& user, const fs::VirtualPath& directory,
+                         const fs::Path& name, bool isDirectory)
+{
+  std::string key(directory.ToString());
+  if (key.empty() || key.back() != '/') key += '/';
+  std::string::size_type prefixLength = key.length();
+  key += '\0';
+  key += static_cast<char>(type);
+  key += isDirectory ? 'd' : 'f';
+  
+  int configVersion = cfg::Get().Version();
+  unsigned long generation = DecisionCache::Generation();
+  auto cache = user.PathDecisions();
+  DecisionPtr decision = cache->Lookup(key, configVersion, generation);
+  if (!decision)
+  {
+    decision = std::make_shared<Decision>(Decide<type>(user, key.substr(0, prefixLength), 
+                                                       isDirectory));
+    cache->Insert(key, configVersion, generation, decision);
+  }
+  
+  if (decision->perEntry)
+  {
+    if (isDirectory) return DirAllowed<type>(user, directory / name);
+    else return FileAllowed<type>(user, directory / name);
+  }
+  
+  return DecisionTraits<type>::Entry(user, *decision, directory, name, isDirectory);
+}
+
+template util::Error EntryAllowed<View>(const User& user, const fs::VirtualPath& directory,
+                                        const fs::Path& name, bool isDirectory);
+template util::Error EntryAllowed<Hideowner>(const User& user, const fs::VirtualPath& directory,
+                                             const fs::Path& name, bool isDirectory);
+
 template <Type type>
 util::Error Allowed(const User& user, const fs::VirtualPath& path)
 {
@@ -498,10 +633,10 @@ template util::Error Allowed<Move>(const User& user, const fs::VirtualPath& path
 
 util::Error Filter(const User& user, const fs::Path& basename)
 {
-  auto info = user.ACLInfo();
+  auto info = user.BoundACLInfo();
   for (auto& filter : cfg::Get().PathFilter())
   {
-    if (filter.ACL().Evaluate(info))
+    if (filter.ACL().Evaluate(*info))
     {
       if (!boost::regex_match(basename.ToString(), filter.Regex()))
       {
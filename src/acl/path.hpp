@@ -61,6 +61,12 @@ util::Error FileAllowed(const User& user, const fs::VirtualPath& path);
 template <Type type>
 util::Error DirAllowed(const User& user, const fs::VirtualPath& path);
 
+// same as FileAllowed or DirAllowed on directory / name, whatever
+// doesn't depend on name is decided once per directory for the user
+template <Type type>
+util::Error EntryAllowed(const User& user, const fs::VirtualPath& directory,
+                         const fs::Path& name, bool isDirectory);
+
 util::Error Filter(const User& user, const fs::Path& basename);
 
 } /* path namespace */
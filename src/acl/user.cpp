@@ -27,6 +27,7 @@
 #include "acl/group.hpp"
 #include "acl/userdata.hpp"
 #include "acl/acl.hpp"
+#include "acl/decisioncache.hpp"
 
 namespace acl
 {
@@ -47,6 +48,7 @@ User& User::operator=(User&& rhs)
 {
   data = std::move(rhs.data);
   db = std::move(rhs.db);
+  decisions = std::move(rhs.decisions);
   return *this;
 }
 
@@ -54,12 +56,14 @@ User& User::operator=(const User& rhs)
 {
   data.reset(new UserData(*rhs.data));
   db.reset(new db::User(*data));
+  ForgetDecisions();
   return *this;
 }
 
 User::User(User&& other) :
   data(std::move(other.data)),
-  db(new db::User(*data))
+  db(new db::User(*data)),
+  decisions(std::move(other.decisions))
 {
 }
 
@@ -199,6 +203,7 @@ const boost::optional<boost::posix_time::ptime>& User::LastLogin() const
   
 bool User::Rename(const std::string& name)
 {
+  ForgetDecisions();
   std::string oldName = data->name;
   data->name = name; 
   if (!db->SaveName())
@@ -284,6 +289,7 @@ void User::SetPassword(const std::string& password)
 
 void User::SetFlags(const std::string& flags)
 {
+  ForgetDecisions();
   assert(ValidFlags(flags));
   auto trans = util::MakeTransaction(data->flags, flags);
   db->SaveFlags();
@@ -291,6 +297,7 @@ void User::SetFlags(const std::string& flags)
 
 void User::AddFlags(const std::string& flags)
 {
+  ForgetDecisions();
   assert(ValidFlags(flags));
   auto trans = util::MakeTransaction(data->flags);
   for (char ch: flags)
@@ -309,6 +316,7 @@ void User::AddFlag(Flag flag)
 
 void User::DelFlags(const std::string& flags)
 {
+  ForgetDecisions();
   auto trans = util::MakeTransaction(data->flags);
   for (char ch: flags)
   {
@@ -348,6 +356,8 @@ void User::SetPrimaryGID(acl::GroupID gid)
 {
   if (data->primaryGid == gid) return;
 
+  ForgetDecisions();
+
   auto trans1 = util::MakeTransaction(data->primaryGid);
   auto trans2 = util::MakeTransaction(data->secondaryGids);
 
@@ -369,6 +379,8 @@ void User::SetPrimaryGID(acl::GroupID gid)
 void User::AddGIDs(const std::vector<acl::GroupID>& gids)
 {
   if (gids.empty()) return;
+
+  ForgetDecisions();
   
   auto trans1 = util::MakeTransaction(data->primaryGid);
   auto trans2 = util::MakeTransaction(data->secondaryGids);
@@ -413,6 +425,7 @@ void User::CleanGadminGIDs()
 
 void User::DelGIDs(const std::vector<acl::GroupID>& gids)
 {
+  ForgetDecisions();
   auto trans1 = util::MakeTransaction(data->primaryGid);
   auto trans2 = util::MakeTransaction(data->secondaryGids);
   auto trans3 = util::MakeTransaction(data->gadminGids);
@@ -438,6 +451,7 @@ void User::DelGIDs(const std::vector<acl::GroupID>& gids)
 
 void User::SetGIDs(const std::vector<acl::GroupID>& gids)
 {
+  ForgetDecisions();
   auto trans1 = util::MakeTransaction(data->primaryGid);
   auto trans2 = util::MakeTransaction(data->secondaryGids);
   auto trans3 = util::MakeTransaction(data->gadminGids);
@@ -457,6 +471,7 @@ void User::SetGIDs(const std::vector<acl::GroupID>& gids)
 
 void User::ToggleGIDs(const std::vector<acl::GroupID>& gids)
 {
+  ForgetDecisions();
   auto trans1 = util::MakeTransaction(data->primaryGid);
   auto trans2 = util::MakeTransaction(data->secondaryGids);
   auto trans3 = util::MakeTransaction(data->gadminGids);
@@ -534,12 +549,14 @@ void User::SetSectionWeeklyAllotment(const std::string& section, long long allot
 
 void User::SetHomeDir(const std::string& homeDir)
 {
+  ForgetDecisions();
   auto trans = util::MakeTransaction(data->homeDir, homeDir);
   db->SaveHomeDir();
 }
 
 void User::SetStartUpDir(const std::string& startUpDir)
 {
+  ForgetDecisions();
   auto trans = util::MakeTransaction(data->startUpDir, startUpDir);
   db->SaveStartUpDir();
 }
@@ -627,8 +644,7 @@ void User::SetSectionRatio(const std::string& section, int ratio)
 
 long long User::SectionCredits(const std::string& section) const
 {
-  auto it = data->credits.find(section);
-  return it != data->credits.end() ? it->second : 0;
+  return db->Credits(section);
 }
 
 void User::IncrSectionCredits(const std::string& section, long long kBytes)
@@ -646,6 +662,11 @@ void User::DecrSectionCreditsForce(const std::string& section, long long kBytes)
   (void) db->DecrCredits(section, kBytes, true);
 }
 
+void User::SettleSectionCredits(const std::string& section, long long reserved, long long actual)
+{
+  db->SettleCredits(section, reserved, actual);
+}
+
 void User::Purge() const
 {
   db->Purge();
@@ -656,6 +677,35 @@ void User::Purge() const
   return ::acl::ACLInfo(data->name, PrimaryGroup(), data->flags);
 }
 
+void User::ForgetDecisions()
+{
+  std::atomic_store(&decisions, std::shared_ptr<path::DecisionCache>());
+}
+
+std::shared_ptr<path::DecisionCache> User::PathDecisions() const
+{
+  auto cache = std::atomic_load(&decisions);
+  if (!cache)
+  {
+    auto created = std::make_shared<path::DecisionCache>();
+    cache = std::atomic_compare_exchange_strong(&decisions, &cache, created) ? created : cache;
+  }
+  return cache;
+}
+
+std::shared_ptr<const ::acl::ACLInfo> User::BoundACLInfo() const
+{
+  unsigned long generation = path::DecisionCache::Generation();
+  auto cache = PathDecisions();
+  auto info = cache->Info(generation);
+  if (!info)
+  {
+    info = std::make_shared<const ::acl::ACLInfo>(ACLInfo());
+    cache->Bind(generation, info);
+  }
+  return info;
+}
+
 boost::optional<User> User::Load(acl::UserID uid)
 {
   auto data = db::User::Load(uid);
@@ -711,6 +761,18 @@ std::vector<acl::User> User::GetUsers(const std::string& multiStr)
   return users;
 }
 
+std::vector<acl::User> User::GetUsers(const std::vector<acl::UserID>& uids)
+{
+  auto userData = db::GetUsers(uids);
+  std::vector<acl::User> users;
+  users.reserve(userData.size());
+  for (auto& data : userData)
+  {
+    users.push_back(User(std::move(data)));
+  }
+  return users;
+}
+
 size_t User::TotalUsers()
 {
   return GetUIDs("*").size();
@@ -49,11 +49,17 @@ struct UserData;
 
 struct ACLInfo;
 
+namespace path
+{
+class DecisionCache;
+}
+
 class User
 {
 private:
   std::unique_ptr<UserData> data;
   std::unique_ptr<db::User> db;
+  mutable std::shared_ptr<path::DecisionCache> decisions; // each copy its own
 
   User();
   User(UserData&& data_);
@@ -61,6 +67,7 @@ private:
   bool HasSecondaryGID(GroupID gid) const;
   void SetPasswordNoSave(const std::string& password);
   void CleanGadminGIDs();
+  void ForgetDecisions();
   
 public:
   User& operator=(User&& rhs);
@@ -164,6 +171,7 @@ public:
   void IncrSectionCredits(const std::string& section, long long kBytes);
   bool DecrSectionCredits(const std::string& section, long long kBytes);
   void DecrSectionCreditsForce(const std::string& section, long long kBytes);
+  void SettleSectionCredits(const std::string& section, long long reserved, long long actual);
   
   long long DefaultCredits() const { return SectionCredits(""); }
   void IncrDefaultCredits(long long kBytes)
@@ -182,6 +190,11 @@ public:
   void Purge() const;
   
   ::acl::ACLInfo ACLInfo() const;
+  // held for the whole check, the user may forget its decisions meanwhile
+  std::shared_ptr<path::DecisionCache> PathDecisions() const;
+  // ACLInfo built once and kept with the decisions, so it is rebuilt
+  // whenever they are forgotten or groups are replicated
+  std::shared_ptr<const ::acl::ACLInfo> BoundACLInfo() const;
   
   static boost::optional<User> Load(acl::UserID uid);
   static boost::optional<User> Load(const std::string& name);
@@ -192,6 +205,7 @@ public:
                             const User& templateUser);
   static std::vector<acl::UserID> GetUIDs(const std::string& multiStr = "*");
   static std::vector<acl::User> GetUsers(const std::string& multiStr = "*");
+  static std::vector<acl::User> GetUsers(const std::vector<acl::UserID>& uids);
   
   static size_t TotalUsers();
 };
@@ -85,6 +85,9 @@ Config::Config(const std::string& configPath, bool tool) :
   transferLog(defaultTransferLog),
   maxUsers(defaultMaxUsers),
   dlIncomplete(defaultDlIncomplete),
+  fanoutBuffer(defaultFanoutBuffer),
+  dirCache(defaultDirCache),
+  idleCommands(true),
   totalUsers(defaultTotalUsers),
   lslong(defaultLslong),
   nukeMax(defaultNukeMax),
@@ -101,6 +104,7 @@ Config::Config(const std::string& configPath, bool tool) :
   umask(defaultUmask),
   logLines(defaultLogLines),
   dataBufferSize(defaultDataBufferSize),
+  fairShare(defaultFairShare),
   tlsControl(defaultTlsControl),
   tlsListing(defaultTlsListing),
   tlsData(defaultTlsData),
@@ -194,6 +198,13 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
     database.replicaSet = toks[0];
   }
   else
+  if (opt == "db_pool_size")
+  {
+    ParameterCheck(opt, toks, 1);
+    database.poolSize = util::StrToInt(toks[0]);
+    if (database.poolSize < 1) throw std::bad_cast();
+  }
+  else
   if (opt == "sitepath")
   {
     ParameterCheck(opt, toks, 1);
@@ -266,6 +277,17 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
     ParameterCheck(opt, toks, 1);
     dlIncomplete = YesNoToBoolean(toks[0]);
   }
+  else if (opt == "fanout_buffer")
+  {
+    ParameterCheck(opt, toks, 1);
+    fanoutBuffer = ParseSize(toks[0]);
+  }
+  else if (opt == "dir_cache")
+  {
+    ParameterCheck(opt, toks, 1);
+    dirCache = util::StrToLLong(toks[0]);
+    if (dirCache < 0) throw std::bad_cast();
+  }
   else if (opt == "sitename_long")
   {
     ParameterCheck(opt, toks, 1);
@@ -334,7 +356,7 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
   else if (opt == "calc_crc")
   {
     ParameterCheck(opt, toks, 1, -1);
-    calcCrc.insert(calcCrc.end(), toks.begin(), toks.end());
+    calcCrc.Add(toks.begin(), toks.end());
   }
   else if (opt == "xdupe")
   {
@@ -359,13 +381,12 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
   else if (opt == "idle_commands")
   {
     ParameterCheck(opt, toks, 1, -1);
-    idleCommands.insert(idleCommands.end(), toks.begin(), toks.end());
-    for (auto& cmd : idleCommands) util::ToUpper(cmd);
+    idleCommands.Add(toks.begin(), toks.end());
   }
   else if (opt == "noretrieve")
   {
     ParameterCheck(opt, toks, 1, -1);
-    noretrieve.insert(noretrieve.end(), toks.begin(), toks.end());
+    noretrieve.Add(toks.begin(), toks.end());
   }
   else if (opt == "maximum_speed")
   {
@@ -439,87 +460,87 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
   else if (opt == "delete")
   {
     ParameterCheck(opt, toks, 2, -1);
-    delete_.emplace_back(toks);
+    delete_.Add(toks);
   }
   else if (opt == "deleteown")
   {
     ParameterCheck(opt, toks, 2, -1);
-    deleteown.emplace_back(toks);
+    deleteown.Add(toks);
   }
   else if (opt == "overwrite")
   {
     ParameterCheck(opt, toks, 2, -1);
-    overwrite.emplace_back(toks);
+    overwrite.Add(toks);
   }
   else if (opt == "overwriteown")
   {
     ParameterCheck(opt, toks, 2, -1);
-    overwriteown.emplace_back(toks);
+    overwriteown.Add(toks);
   }
   else if (opt == "resume")
   {
     ParameterCheck(opt, toks, 2, -1);
-    resume.emplace_back(toks);
+    resume.Add(toks);
   }
   else if (opt == "resumeown")
   {
     ParameterCheck(opt, toks, 2, -1);
-    resumeown.emplace_back(toks);
+    resumeown.Add(toks);
   }
   else if (opt == "rename")
   {
     ParameterCheck(opt, toks, 2, -1);
-    rename.emplace_back(toks);
+    rename.Add(toks);
   }
   else if (opt == "renameown")
   {
     ParameterCheck(opt, toks, 2, -1);
-    renameown.emplace_back(toks);
+    renameown.Add(toks);
   }
   else if (opt == "move")
   {
     ParameterCheck(opt, toks, 2, -1);
-    move.emplace_back(toks);
+    move.Add(toks);
   }
   else if (opt == "moveown")
   {
     ParameterCheck(opt, toks, 2, -1);
-    moveown.emplace_back(toks);
+    moveown.Add(toks);
   }
   else if (opt == "makedir")
   {
     ParameterCheck(opt, toks, 2, -1);
-    makedir.emplace_back(toks);
+    makedir.Add(toks);
   }
   else if (opt == "upload")
   {
     ParameterCheck(opt, toks, 2, -1);
-    upload.emplace_back(toks);
+    upload.Add(toks);
   }
   else if (opt == "download")
   {
     ParameterCheck(opt, toks, 2, -1);
-    download.emplace_back(toks);
+    download.Add(toks);
   }
   else if (opt == "downloadown")
   {
     ParameterCheck(opt, toks, 2, -1);
-    downloadown.emplace_back(toks);
+    downloadown.Add(toks);
   }
   else if (opt == "modify")
   {
     ParameterCheck(opt, toks, 2, -1);
-    modify.emplace_back(toks);
+    modify.Add(toks);
   }
   else if (opt == "modifyown")
   {
     ParameterCheck(opt, toks, 2, -1);
-    modifyown.emplace_back(toks);
+    modifyown.Add(toks);
   }
   else if (opt == "nuke")
   {
     ParameterCheck(opt, toks, 2, -1);
-    nuke.emplace_back(toks);
+    nuke.Add(toks);
   }
   else if (opt == "event_path")
   {
@@ -539,22 +560,22 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
   else if (opt == "hideinwho")
   {
     ParameterCheck(opt, toks, 2, -1);
-    hideinwho.emplace_back(toks);
+    hideinwho.Add(toks);
   }
   else if (opt == "freefile")
   {
     ParameterCheck(opt, toks, 2, -1);
-    freefile.emplace_back(toks);
+    freefile.Add(toks);
   }
   else if (opt == "nostats")
   {
     ParameterCheck(opt, toks, 2, -1);
-    nostats.emplace_back(toks);
+    nostats.Add(toks);
   }
   else if (opt == "hideowner")
   {
     ParameterCheck(opt, toks, 2, -1);
-    hideowner.emplace_back(toks);
+    hideowner.Add(toks);
   }
   else if (opt == "show_diz")
   {
@@ -588,7 +609,7 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
   }
   else if (opt == "lslong")
   {
-    ParameterCheck(opt, toks, 2);
+    ParameterCheck(opt, toks, 2, 4);
     lslong = ::cfg::Lslong(toks);
   }
   else if (opt == "hidden_files")
@@ -720,6 +741,16 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
     dataBufferSize = util::StrToInt(toks[0]);
     if (dataBufferSize < 0) throw std::bad_cast();
   }
+  else if (opt == "fair_share")
+  {
+    ParameterCheck(opt, toks, 2);
+    fairShare = ::cfg::FairShare(toks);
+  }
+  else if (opt == "fair_share_weight")
+  {
+    ParameterCheck(opt, toks, 3);
+    fairShareWeights.emplace_back(toks);
+  }
   else if (opt == "tls_control")
   {
     tlsControl = acl::ACL(util::Join(toks, " "));
@@ -747,7 +778,7 @@ void Config::ParseSection(const std::string& opt, std::vector<std::string>& toks
   if (opt == "path")
   {
     ParameterCheck(opt, toks, 1, -1);
-    currentSection->paths.insert(currentSection->paths.end(), toks.begin(), toks.end());
+    currentSection->paths.Add(toks.begin(), toks.end());
   }
   else if (opt == "separate_credits")
   {
@@ -886,6 +917,15 @@ ConfigPtr Config::Load(std::string configPath, bool tool)
   return std::make_shared<Config>(lastConfigPath, tool);
 }
 
+int Config::FairShareWeight(::cfg::FairShareWeight::Type type, const std::string& name) const
+{
+  for (const auto& fsw : fairShareWeights)
+  {
+    if (fsw.GetType() == type && fsw.Name() == name) return fsw.Weight();
+  }
+  return defaultFairShareWeight;
+}
+
 bool Config::IsEventLogged(const std::string& path) const
 {
   if (path.empty()) return false;
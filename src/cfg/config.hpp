@@ -77,7 +77,7 @@ class Config
   std::vector<SpeedLimit> maximumSpeed;
   std::vector<SpeedLimit> minimumSpeed;
   ::cfg::SimXfers simXfers;
-  std::vector<std::string> calcCrc;
+  util::GlobList calcCrc;
   std::vector<std::string> xdupe;
   std::vector<std::string> validIp;
   std::vector<std::string> activeAddr;
@@ -100,27 +100,27 @@ class Config
   ::cfg::TransferLog transferLog;
   
   // ind rights
-  std::vector< ::cfg::Right> delete_; // delete is reserved
-  std::vector< ::cfg::Right> deleteown;
-  std::vector< ::cfg::Right> overwrite;
-  std::vector< ::cfg::Right> overwriteown;
-  std::vector< ::cfg::Right> resume;
-  std::vector< ::cfg::Right> resumeown;
-  std::vector< ::cfg::Right> rename;
-  std::vector< ::cfg::Right> renameown;
-  std::vector< ::cfg::Right> move;
-  std::vector< ::cfg::Right> moveown;
-  std::vector< ::cfg::Right> makedir;
-  std::vector< ::cfg::Right> upload;
-  std::vector< ::cfg::Right> download;
-  std::vector< ::cfg::Right> downloadown;
-  std::vector< ::cfg::Right> nuke;
-  std::vector< ::cfg::Right> hideinwho;
-  std::vector< ::cfg::Right> freefile;
-  std::vector< ::cfg::Right> nostats;
-  std::vector< ::cfg::Right> hideowner;
-  std::vector< ::cfg::Right> modify;
-  std::vector< ::cfg::Right> modifyown;
+  ::cfg::Rights delete_; // delete is reserved
+  ::cfg::Rights deleteown;
+  ::cfg::Rights overwrite;
+  ::cfg::Rights overwriteown;
+  ::cfg::Rights resume;
+  ::cfg::Rights resumeown;
+  ::cfg::Rights rename;
+  ::cfg::Rights renameown;
+  ::cfg::Rights move;
+  ::cfg::Rights moveown;
+  ::cfg::Rights makedir;
+  ::cfg::Rights upload;
+  ::cfg::Rights download;
+  ::cfg::Rights downloadown;
+  ::cfg::Rights nuke;
+  ::cfg::Rights hideinwho;
+  ::cfg::Rights freefile;
+  ::cfg::Rights nostats;
+  ::cfg::Rights hideowner;
+  ::cfg::Rights modify;
+  ::cfg::Rights modifyown;
 
   std::vector<std::string> eventpath;
   std::vector<std::string> dupepath;
@@ -134,12 +134,14 @@ class Config
   std::vector<std::string> bannedUsers;
   std::vector< ::cfg::Right> showDiz;
   bool dlIncomplete;
+  long long fanoutBuffer;
+  long long dirCache;
   std::vector< ::cfg::Cscript> cscript;
-  std::vector<std::string> idleCommands;
+  util::GlobList idleCommands;
   int totalUsers;
   ::cfg::Lslong lslong;
   std::vector< ::cfg::HiddenFiles> hiddenFiles;
-  std::vector<std::string> noretrieve;
+  util::GlobList noretrieve;
   ::cfg::NukeMax nukeMax;
   std::vector< ::cfg::Creditcheck> creditcheck;
   std::vector< ::cfg::Creditloss> creditloss;
@@ -166,6 +168,8 @@ class Config
   int logLines;
   ssize_t dataBufferSize;
   std::string natAddr;
+  ::cfg::FairShare fairShare;
+  std::vector< ::cfg::FairShareWeight> fairShareWeights;
   
   acl::ACL tlsControl;
   acl::ACL tlsListing;
@@ -223,7 +227,7 @@ public:
   const std::vector<SpeedLimit>& MaximumSpeed() const { return maximumSpeed; }
   const std::vector<SpeedLimit>& MinimumSpeed() const { return minimumSpeed; }
   const ::cfg::SimXfers& SimXfers() const { return simXfers; }
-  const std::vector<std::string>& CalcCrc() const { return calcCrc; }
+  const util::GlobList& CalcCrc() const { return calcCrc; }
   const std::vector<std::string>& Xdupe() const { return xdupe; }
   const std::vector<std::string>& ValidIp() const { return validIp; }
   const std::vector<std::string>& ActiveAddr() const { return activeAddr; }
@@ -246,27 +250,27 @@ public:
   const ::cfg::TransferLog TransferLog() const { return transferLog; }
 
   // rights section
-  const std::vector< ::cfg::Right>& Delete() const { return delete_; } 
-  const std::vector< ::cfg::Right>& Deleteown() const { return deleteown; } 
-  const std::vector< ::cfg::Right>& Overwrite() const { return overwrite; } 
-  const std::vector< ::cfg::Right>& Overwriteown() const { return overwriteown; } 
-  const std::vector< ::cfg::Right>& Resume() const { return resume; } 
-  const std::vector< ::cfg::Right>& Resumeown() const { return resumeown; } 
-  const std::vector< ::cfg::Right>& Rename() const { return rename; } 
-  const std::vector< ::cfg::Right>& Renameown() const { return renameown; } 
-  const std::vector< ::cfg::Right>& Move() const { return move; } 
-  const std::vector< ::cfg::Right>& Moveown() const { return moveown; } 
-  const std::vector< ::cfg::Right>& Makedir() const { return makedir; } 
-  const std::vector< ::cfg::Right>& Upload() const { return upload; } 
-  const std::vector< ::cfg::Right>& Download() const { return download; } 
-  const std::vector< ::cfg::Right>& Downloadown() const { return downloadown; } 
-  const std::vector< ::cfg::Right>& Modify() const { return modify; } 
-  const std::vector< ::cfg::Right>& Modifyown() const { return modifyown; } 
-  const std::vector< ::cfg::Right>& Nuke() const { return nuke; } 
-  const std::vector< ::cfg::Right>& Hideinwho() const { return hideinwho; } 
-  const std::vector< ::cfg::Right>& Freefile() const { return freefile; } 
-  const std::vector< ::cfg::Right>& Nostats() const { return nostats; } 
-  const std::vector< ::cfg::Right>& Hideowner() const { return hideowner; } 
+  const ::cfg::Rights& Delete() const { return delete_; } 
+  const ::cfg::Rights& Deleteown() const { return deleteown; } 
+  const ::cfg::Rights& Overwrite() const { return overwrite; } 
+  const ::cfg::Rights& Overwriteown() const { return overwriteown; } 
+  const ::cfg::Rights& Resume() const { return resume; } 
+  const ::cfg::Rights& Resumeown() const { return resumeown; } 
+  const ::cfg::Rights& Rename() const { return rename; } 
+  const ::cfg::Rights& Renameown() const { return renameown; } 
+  const ::cfg::Rights& Move() const { return move; } 
+  const ::cfg::Rights& Moveown() const { return moveown; } 
+  const ::cfg::Rights& Makedir() const { return makedir; } 
+  const ::cfg::Rights& Upload() const { return upload; } 
+  const ::cfg::Rights& Download() const { return download; } 
+  const ::cfg::Rights& Downloadown() const { return downloadown; } 
+  const ::cfg::Rights& Modify() const { return modify; } 
+  const ::cfg::Rights& Modifyown() const { return modifyown; } 
+  const ::cfg::Rights& Nuke() const { return nuke; } 
+  const ::cfg::Rights& Hideinwho() const { return hideinwho; } 
+  const ::cfg::Rights& Freefile() const { return freefile; } 
+  const ::cfg::Rights& Nostats() const { return nostats; } 
+  const ::cfg::Rights& Hideowner() const { return hideowner; } 
 
   bool IsEventLogged(const std::string& path) const;
   bool IsDupeLogged(const std::string& path) const;
@@ -280,12 +284,14 @@ public:
   const std::vector<std::string>& BannedUsers() const { return bannedUsers; }
   const std::vector< ::cfg::Right>& ShowDiz() const { return showDiz; }
   bool DlIncomplete() const { return dlIncomplete; }
+  long long FanoutBuffer() const { return fanoutBuffer; }
+  long long DirCache() const { return dirCache; }
   const std::vector< ::cfg::Cscript>& Cscript() const { return cscript; }
-  const std::vector<std::string>& IdleCommands() const { return idleCommands; }
+  const util::GlobList& IdleCommands() const { return idleCommands; }
   int TotalUsers() const { return totalUsers; }
   const ::cfg::Lslong& Lslong() const { return lslong; }
   const std::vector< ::cfg::HiddenFiles>& HiddenFiles() const { return hiddenFiles; }
-  const std::vector<std::string>& Noretrieve() const { return noretrieve; }
+  const util::GlobList& Noretrieve() const { return noretrieve; }
   const ::cfg::NukeMax& NukeMax() const { return nukeMax; }
   const std::vector< ::cfg::Creditcheck>& Creditcheck() const { return creditcheck; }
   const std::vector< ::cfg::Creditloss>& Creditloss() const { return creditloss; }
@@ -315,6 +321,8 @@ public:
   int LogLines() const { return logLines; }
   size_t DataBufferSize() const { return dataBufferSize; }
   const std::string& NATAddr() const { return natAddr; }
+  const ::cfg::FairShare& FairShare() const { return fairShare; }
+  int FairShareWeight(::cfg::FairShareWeight::Type type, const std::string& name) const;
   
   const acl::ACL& CommandACL(const std::string& keyword) const
   { return commandACLs.at(keyword); }
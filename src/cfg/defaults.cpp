@@ -30,6 +30,8 @@ const Log               defaultDebugLog           ("debug",     false,  false,
 const Log               defaultSiteopLog          ("siteop",    true,   true,   0);
 const TransferLog       defaultTransferLog        ("transfer",  false,  false,  0,  false,  false);
 const bool              defaultDlIncomplete       = true;
+const long long         defaultFanoutBuffer       = 0;              // disabled
+const long long         defaultDirCache           = 50000;          // entries
 const int               defaultTotalUsers         = -1;             // unlimited
 const int               defaultMultiplierMax      = 10;
 const int               defaultMaxSitecmdLines    = 100;
@@ -50,6 +52,7 @@ const char*             defaultTlsFxp             = "!*";           // not enfor
 const char*             defaultDatabaseName       = "ebftpd";
 const char*             defaultDatabaseAddress    = "localhost";
 const int               defaultDatabasePort       = 27017;
+const int               defaultDatabasePoolSize   = 32;
 const PathFilter        defaultPathFilter         ("^[[\\]A-Za-z0-9_'()[:space:]][[\\]A-Za-z0-9_.'()[:space:]-]+$", "*");
 const NukeStyle         defaultNukeStyle          ("NUKED-%N",      // format
                                                    NukeStyle::Keep, // action
@@ -65,10 +68,15 @@ const AllowFxp          defaultAllowFxp           (true,            // download
 const MaxUsers          defaultMaxUsers           (50,              // users
                                                    5);              // exempt
 const Lslong            defaultLslong             ("l",             // options
-                                                   2);              // max recursive
+                                                   2,               // max recursive
+                                                   100000,          // max entries
+                                                   30);             // max seconds
 const SimXfers          defaultSimXfers           (-1,              // download (unlimited)
                                                    -1);             // upload (unlimited)
 const NukeMax           defaultNukeMax            (10,              // multiplier
                                                    50);             // percent
+const FairShare         defaultFairShare          (0,               // download (disabled)
+                                                   0);              // upload (disabled)
+const int               defaultFairShareWeight    = 1;
 
 } /*cfg namespace*/
@@ -34,6 +34,8 @@ extern const Log               defaultDebugLog;
 extern const Log               defaultSiteopLog;
 extern const TransferLog       defaultTransferLog;
 extern const bool              defaultDlIncomplete;
+extern const long long         defaultFanoutBuffer;
+extern const long long         defaultDirCache;
 extern const int               defaultTotalUsers;
 extern const int               defaultMultiplierMax;
 extern const int               defaultMaxSitecmdLines;
@@ -54,6 +56,7 @@ extern const char*             defaultTlsFxp;
 extern const char*             defaultDatabaseName;
 extern const char*             defaultDatabaseAddress;
 extern const int               defaultDatabasePort;
+extern const int               defaultDatabasePoolSize;
 extern const PathFilter        defaultPathFilter;
 extern const NukeStyle         defaultNukeStyle;
 extern const IdleTimeout       defaultIdleTimeout;
@@ -62,6 +65,8 @@ extern const MaxUsers          defaultMaxUsers;
 extern const Lslong            defaultLslong;
 extern const SimXfers          defaultSimXfers;
 extern const NukeMax           defaultNukeMax;
+extern const FairShare         defaultFairShare;
+extern const int               defaultFairShareWeight;
 
 } /* cfg namespace */
 
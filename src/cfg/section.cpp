@@ -14,18 +14,13 @@
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "cfg/section.hpp"
-#include "util/string.hpp"
 
 namespace cfg
 {
 
 bool Section::IsMatch(const std::string& path) const
 {
-  for (const std::string& p : paths)
-  {
-    if (util::WildcardMatch(p, path)) return true;
-  }
-  return false;
+  return paths.Match(path);
 }
 
 } /* cfg namespace */
@@ -18,6 +18,7 @@
 
 #include <string>
 #include <vector>
+#include "util/glob.hpp"
 
 namespace fs
 {
@@ -30,7 +31,7 @@ namespace cfg
 class Section
 {
   std::string name;
-  std::vector<std::string> paths;
+  util::GlobList paths;
   bool separateCredits;
   int ratio;
 
@@ -28,10 +28,16 @@
 namespace cfg
 {
 
+Database::Database() :
+  poolSize(defaultDatabasePoolSize)
+{
+}
+
 Database::Database(const char* name, const char* address, int port, const char* login, const char* password) :
   name(name), 
   login(login),
-  password(password)
+  password(password),
+  poolSize(defaultDatabasePoolSize)
 {
   hosts.emplace_back(address, port);
 }
@@ -76,34 +82,24 @@ AsciiDownloads::AsciiDownloads(const std::vector<std::string>& toks) :
   }
   catch (const std::bad_cast&) { }
   if (kBytes == 0) kBytes = -1;
-  masks.assign(toks.begin() + 1, toks.end());
+  masks.Add(toks.begin() + 1, toks.end());
 }
 
 bool AsciiDownloads::Allowed(off_t size, const std::string& path) const
 {
   if (kBytes > 0 && size / 1024 > kBytes) return false;
-  if (masks.empty()) return true;
-  for (auto& mask : masks)
-  {
-    if (util::WildcardMatch(mask, path)) return true;
-  }
-  return false;
+  return masks.Empty() || masks.Match(path);
 }
 
 
-AsciiUploads::AsciiUploads(const std::vector<std::string>& toks) :
-  masks(toks)
+AsciiUploads::AsciiUploads(const std::vector<std::string>& toks)
 {
+  masks.Add(toks.begin(), toks.end());
 }
 
 bool AsciiUploads::Allowed(const std::string& path) const
 {
-  if (masks.empty()) return true;
-  for (auto& mask : masks)
-  {
-    if (util::WildcardMatch(mask, path)) return true;
-  }
-  return false;
+  return masks.Empty() || masks.Match(path);
 }
 
 SecureIp::SecureIp(std::vector<std::string> toks)
@@ -202,6 +198,170 @@ Right::Right(std::vector<std::string> toks)
                path.find("[:groupname:]") != std::string::npos;
 }
 
+void Rights::Add(const std::vector<std::string>& toks)
+{
+  static const std::vector<std::string> variables { "[:username:]", "[:groupname:]" };
+
+  rules.emplace_back(toks);
+  const std::string& path = rules.back().Path();
+  auto length = std::min(path.find_first_of("*?[\\"), path.length());
+  tails.emplace_back(length, util::Glob(path.substr(length), false, variables));
+  
+  unsigned node = 0;
+  for (std::string::size_type i = 0; i < length; ++i)
+  {
+    auto& children = nodes[node].children;
+    auto it = std::lower_bound(children.begin(), children.end(), 
+                               std::make_pair(path[i], 0u));
+    if (it == children.end() || it->first != path[i])
+    {
+      it = children.emplace(it, path[i], nodes.size());
+      nodes.emplace_back();
+    }
+    node = it->second;
+  }
+  nodes[node].rules.emplace_back(rules.size() - 1);
+}
+
+const Right* Rights::Match(const std::string& path, const std::string& username, 
+                           const std::string* groupname) const
+{
+  const std::string* values[] = { &username, groupname };
+  unsigned best = rules.size();
+  auto tryRules = [&](unsigned node, std::string::size_type depth, size_t& next) -> bool
+    {
+      unsigned rule = nodes[node].rules[next++];
+      if (!tails[rule].second.Match(path.data() + depth, path.length() - depth, values)) 
+        return false;
+      best = rule;
+      return true;
+    };
+  
+  // the nodes along path holding rules, their rules are then tried
+  // merged back into config order so the first match is the answer
+  static const size_t maximumCandidates = 32;
+  std::pair<unsigned, std::string::size_type> candidates[maximumCandidates];
+  size_t next[maximumCandidates] = { 0 };
+  size_t count = 0;
+  
+  unsigned node = 0;
+  std::string::size_type depth = 0;
+  while (true)
+  {
+    if (!nodes[node].rules.empty())
+    {
+      if (count < maximumCandidates) candidates[count++] = std::make_pair(node, depth);
+      else
+      {
+        // more candidate prefixes than we track, settle this node on its own
+        size_t i = 0;
+        while (i < nodes[node].rules.size() && nodes[node].rules[i] < best && 
+               !tryRules(node, depth, i));
+      }
+    }
+    
+    if (depth == path.length()) break;
+    const auto& children = nodes[node].children;
+    auto it = std::lower_bound(children.begin(), children.end(), 
+                               std::make_pair(path[depth], 0u));
+    if (it == children.end() || it->first != path[depth]) break;
+    node = it->second;
+    ++depth;
+  }
+  
+  while (true)
+  {
+    size_t lowest = count;
+    for (size_t i = 0; i < count; ++i)
+    {
+      const auto& nodeRules = nodes[candidates[i].first].rules;
+      if (next[i] < nodeRules.size() && nodeRules[next[i]] < best &&
+          (lowest == count || nodeRules[next[i]] < 
+                              nodes[candidates[lowest].first].rules[next[lowest]]))
+        lowest = i;
+    }
+    
+    if (lowest == count) break;
+    if (tryRules(candidates[lowest].first, candidates[lowest].second, next[lowest])) break;
+  }
+  
+  return best < rules.size() ? &rules[best] : nullptr;
+}
+
+bool Rights::MatchRule(unsigned rule, const std::string& path, const std::string& username, 
+                       const std::string* groupname) const
+{
+  const std::string* values[] = { &username, groupname };
+  auto length = tails[rule].first;
+  return !path.compare(0, length, rules[rule].Path(), 0, length) &&
+         tails[rule].second.Match(path.data() + length, path.length() - length, values);
+}
+
+void Rights::Collect(unsigned node, std::vector<unsigned>& found) const
+{
+  found.insert(found.end(), nodes[node].rules.begin(), nodes[node].rules.end());
+  for (const auto& child : nodes[node].children)
+  {
+    if (found.size() > maximumEntryRules) return;
+    Collect(child.second, found);
+  }
+}
+
+bool Rights::MatchEntries(const std::string& prefix, bool directories, 
+                          const std::string& username, const std::string* groupname,
+                          std::vector<unsigned>& some, const Right*& all) const
+{
+  const std::string* values[] = { &username, groupname };
+  std::vector<std::pair<unsigned, util::Glob::Outcome>> outcomes;
+  
+  unsigned node = 0;
+  std::string::size_type depth = 0;
+  while (true)
+  {
+    for (unsigned rule : nodes[node].rules)
+    {
+      outcomes.emplace_back(rule, tails[rule].second.MatchSegment(prefix.data() + depth, 
+                            prefix.length() - depth, directories, values));
+    }
+    
+    const auto& children = nodes[node].children;
+    if (depth == prefix.length())
+    {
+      // rules with a longer literal prefix depend on the entry's name
+      std::vector<unsigned> longer;
+      for (const auto& child : children) Collect(child.second, longer);
+      if (longer.size() > maximumEntryRules) return false;
+      for (unsigned rule : longer) outcomes.emplace_back(rule, util::Glob::Outcome::Depends);
+      break;
+    }
+    
+    auto it = std::lower_bound(children.begin(), children.end(), 
+                               std::make_pair(prefix[depth], 0u));
+    if (it == children.end() || it->first != prefix[depth]) break;
+    node = it->second;
+    ++depth;
+  }
+  
+  std::sort(outcomes.begin(), outcomes.end());
+  some.clear();
+  all = nullptr;
+  for (const auto& outcome : outcomes)
+  {
+    if (outcome.second == util::Glob::Outcome::Always)
+    {
+      all = &rules[outcome.first];
+      break;
+    }
+    
+    if (outcome.second == util::Glob::Outcome::Depends)
+    {
+      if (some.size() == maximumEntryRules) return false;
+      some.emplace_back(outcome.first);
+    }
+  }
+  return true;
+}
+
 PathFilter::PathFilter(const char* regex, const char* acl) :
   regex(new boost::regex(regex)),
   acl(acl)
@@ -275,13 +435,18 @@ ACLInt::ACLInt(std::vector<std::string> toks)
   acl = acl::ACL(util::Join(toks, " ")); 
 }
 
-Lslong::Lslong(const char* options, int maxRecursion) : 
+Lslong::Lslong(const char* options, int maxRecursion, long long maxEntries, int maxSeconds) : 
   options(options),
-  maxRecursion(maxRecursion)
+  maxRecursion(maxRecursion),
+  maxEntries(maxEntries),
+  maxSeconds(maxSeconds)
 {
 }
 
-Lslong::Lslong(std::vector<std::string> toks)   
+Lslong::Lslong(std::vector<std::string> toks) :
+  maxRecursion(defaultLslong.MaxRecursion()),
+  maxEntries(defaultLslong.MaxEntries()),
+  maxSeconds(defaultLslong.MaxSeconds())
 {
   options = toks[0];
   if (options[0] == '-') options.erase(0, 1);
@@ -289,13 +454,20 @@ Lslong::Lslong(std::vector<std::string> toks)
   
   maxRecursion = util::StrToInt(toks[1]);
   if (maxRecursion < 0) throw std::bad_cast();
+  if (toks.size() == 2) return;
+  
+  maxEntries = util::StrToLLong(toks[2]);
+  if (maxEntries < 0) throw std::bad_cast();
+  if (toks.size() == 3) return;
+  
+  maxSeconds = util::StrToInt(toks[3]);
+  if (maxSeconds < 0) throw std::bad_cast();
 }
 
 HiddenFiles::HiddenFiles(std::vector<std::string> toks)   
 {
-  path = toks[0];
-  toks.erase(toks.begin());
-  masks = toks;
+  path = util::Glob(toks[0]);
+  masks.Add(toks.begin() + 1, toks.end());
 }
 
 Creditcheck::Creditcheck(std::vector<std::string> toks)   
@@ -488,4 +660,26 @@ bool NukeMax::IsOkay(int value, bool isPercent) const
   if (isPercent) return value >= 0 && value <= percent;
   else return value >= 0 && value <= multiplier;
 }
+
+FairShare::FairShare(const std::vector<std::string>& toks) :
+  downloads(ParseSize(toks[0])),
+  uploads(ParseSize(toks[1]))
+{
+}
+
+FairShareWeight::FairShareWeight(const std::vector<std::string>& toks)
+{
+  std::string typeStr(util::ToLowerCopy(toks[0]));
+  if (typeStr == "section") type = Type::Section;
+  else if (typeStr == "group") type = Type::Group;
+  else if (typeStr == "user") type = Type::User;
+  else throw std::bad_cast();
+  
+  name = toks[1];
+  if (type == Type::Section) util::ToUpper(name);
+  
+  weight = util::StrToInt(toks[2]);
+  if (weight < 1) throw std::bad_cast();
+}
+
 }
@@ -25,6 +25,7 @@
 #include "acl/passwdstrength.hpp"
 #include "acl/ipstrength.hpp"
 #include "main.hpp"
+#include "util/glob.hpp"
 
 namespace boost { namespace posix_time
 {
@@ -44,9 +45,10 @@ class Database
   std::string login;
   std::string password;
   std::string replicaSet;
+  int poolSize;
   
 public:
-  Database() = default;
+  Database();
   Database(const char* name, const char* address, int port, const char* login, const char* password);
   
   const std::string& Name() const { return name; }
@@ -54,7 +56,9 @@ public:
   const std::string& Login() const { return login; }
   const std::string& Password() const { return password; }
   bool NeedAuth() const;
+  int PoolSize() const { return poolSize; }
   
+  // pool size isn't compared, it can be changed without a restart
   bool operator==(const Database& rhs) const;
   bool operator!=(const Database& rhs) const { return !operator==(rhs); }
   
@@ -75,6 +79,52 @@ public:
   bool SpecialVar() const { return specialVar; }
 };
 
+// a right's rules in config order, indexed in a trie by the literal text
+// before each path's first wildcard, so a lookup walks the path once and 
+// only matches the rest of the rules whose literal prefix it starts with
+class Rights
+{
+  struct Node
+  {
+    std::vector<std::pair<char, unsigned>> children; // sorted by character
+    std::vector<unsigned> rules; // ascending, the rules whose prefix ends here
+  };
+  
+  std::vector<Right> rules;
+  std::vector<std::pair<std::string::size_type, util::Glob>> tails; // prefix length, the rest
+  std::vector<Node> nodes; // the root is first
+  
+  static const size_t maximumEntryRules = 64;
+  
+  void Collect(unsigned node, std::vector<unsigned>& found) const;
+  
+public:
+  Rights() : nodes(1) { }
+  
+  void Add(const std::vector<std::string>& toks);
+  
+  // the first rule matching path, groupname is null for a user without a group
+  const Right* Match(const std::string& path, const std::string& username, 
+                     const std::string* groupname) const;
+  
+  // for every entry of the directory whose path, with a trailing slash, 
+  // is prefix: the rules that match only some of them in config order and
+  // the first rule after them matching all of them, if any, false if too 
+  // many rules depend on the entry for this to be worth it
+  bool MatchEntries(const std::string& prefix, bool directories, 
+                    const std::string& username, const std::string* groupname,
+                    std::vector<unsigned>& some, const Right*& all) const;
+  
+  bool MatchRule(unsigned rule, const std::string& path, const std::string& username, 
+                 const std::string* groupname) const;
+  
+  const Right& operator[](unsigned rule) const { return rules[rule]; }
+  std::vector<Right>::const_iterator begin() const { return rules.begin(); }
+  std::vector<Right>::const_iterator end() const { return rules.end(); }
+  bool empty() const { return rules.empty(); }
+  size_t size() const { return rules.size(); }
+};
+
 class ACLInt
 {
   int arg;
@@ -89,7 +139,7 @@ public:
 class AsciiDownloads
 {
   long long kBytes;
-  std::vector<std::string> masks;
+  util::GlobList masks;
   
 public:
   AsciiDownloads() : kBytes(-1) { }
@@ -99,7 +149,7 @@ public:
 
 class AsciiUploads
 {
-  std::vector<std::string> masks;
+  util::GlobList masks;
   
 public:
   AsciiUploads() = default;
@@ -265,23 +315,27 @@ class Lslong
 {
   std::string options;
   int maxRecursion;
+  long long maxEntries;
+  int maxSeconds;
   
 public:
-  Lslong(const char* options, int maxRecursion);
+  Lslong(const char* options, int maxRecursion, long long maxEntries, int maxSeconds);
   Lslong(std::vector<std::string> toks);
   const std::string& Options() const { return options; }
   int MaxRecursion() const { return maxRecursion; }
+  long long MaxEntries() const { return maxEntries; }
+  int MaxSeconds() const { return maxSeconds; }
 };
 
 class HiddenFiles
 {
-  std::string path;
-  std::vector<std::string> masks;
+  util::Glob path;
+  util::GlobList masks;
   
 public:
   HiddenFiles(std::vector<std::string> toks);
-  const std::string& Path() const { return path; }
-  const std::vector<std::string>& Masks() const { return masks; }
+  const util::Glob& Path() const { return path; }
+  const util::GlobList& Masks() const { return masks; }
 };
 
 class Creditcheck
@@ -419,14 +473,14 @@ public:
 class CheckScript
 {
   std::string path;
-  std::string mask;
+  util::Glob mask;
   bool disabled;
 
 public:
   CheckScript(const std::vector<std::string>& toks);
 
   const std::string Path() const { return path; }
-  const std::string Mask() const { return mask; }
+  const util::Glob& Mask() const { return mask; }
   bool Disabled() const { return disabled; }
 };
 
@@ -488,6 +542,41 @@ public:
   bool IsOkay(int value, bool isPercent) const;
 };
 
+class FairShare
+{
+  long long downloads;
+  long long uploads;
+  
+public:
+  FairShare(long long downloads, long long uploads) :
+    downloads(downloads),
+    uploads(uploads)
+  { }
+  
+  FairShare(const std::vector<std::string>& toks);
+  
+  long long Downloads() const { return downloads; }
+  long long Uploads() const { return uploads; }
+};
+
+class FairShareWeight
+{
+public:
+  enum class Type { Section, Group, User };
+  
+private:
+  Type type;
+  std::string name;
+  int weight;
+  
+public:
+  FairShareWeight(const std::vector<std::string>& toks);
+  
+  Type GetType() const { return type; }
+  const std::string& Name() const { return name; }
+  int Weight() const { return weight; }
+};
+
 }
 
 #endif
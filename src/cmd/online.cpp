@@ -27,16 +27,7 @@ namespace cmd
 
 std::string CompileWhosOnline(const std::string& id, text::Template& templ)
 {
-  std::vector<ftp::OnlineClient> clients;
-  
-  {
-    ftp::OnlineReader reader(id);  
-    
-    {
-      ftp::OnlineReaderLock lock(reader);
-      std::copy(reader.begin(), reader.end(), std::back_inserter(clients));
-    }
-  }
+  std::vector<ftp::OnlineClient> clients(ftp::OnlineReader(id).Snapshot());
   
   std::ostringstream multiStr;
   for (const auto& client : clients)
@@ -40,6 +40,7 @@
 #include "fs/owner.hpp"
 #include "fs/path.hpp"
 #include "ftp/data.hpp"
+#include "ftp/mlst.hpp"
 #include "logs/logs.hpp"
 #include "main.hpp"
 #include "stats/util.hpp"
@@ -261,6 +262,7 @@ void FEATCommand::Execute()
   control.PartReply(ftp::NoCode, " SSCN");
   control.PartReply(ftp::NoCode, " CPSV");
   control.PartReply(ftp::NoCode, " MFMT");
+  control.PartReply(ftp::NoCode, " MLST " + ftp::mlst::FeatureString(client.MlstFacts()));
   control.Reply(ftp::SystemStatus, "End.");
 
   (void) singleLineReplies;
@@ -283,7 +285,7 @@ void HELPCommand::Execute()
     "------------------------------------------------------------------\n"
     " ABOR *ACCT *ADAT *ALLO  APPE  AUTH *CCC   CDUP *CONF  CWD   DELE\n"
     "*ENC   EPRT  EPSV  FEAT  HELP *LANG  LIST *LPRT *LPSV  MDTM *MIC\n"
-    " MKD  *MLSD *MLST  MODE  NLST  NOOP *OPTS  PASS  PASV  PBSZ  PORT\n"
+    " MKD   MLSD  MLST  MODE  NLST  NOOP  OPTS  PASS  PASV  PBSZ  PORT\n"
     " PROT  PWD   QUIT *REIN *REST  RETR  RMD   RNFR  RNTO  SITE  SIZE\n"
     "*SMNT  STAT  STOR  STOU *STRU  SYST  TYPE\n"
     "------------------------------------------------------------------\n"
@@ -496,6 +498,23 @@ void NOOPCommand::Execute()
   return;
 }
 
+void OPTSCommand::Execute()
+{
+  std::string option(args[1]);
+  util::ToUpper(option);
+  if (option == "MLST")
+  {
+    std::string factList;
+    if (args.size() >= 3) factList = args[2];
+    ftp::mlst::Fact facts = ftp::mlst::ParseFacts(factList);
+    client.SetMlstFacts(facts);
+    control.Reply(ftp::CommandOkay, "MLST OPTS " + ftp::mlst::FactsString(facts));
+    return;
+  }
+  
+  control.Reply(ftp::SyntaxError, "Option not understood.");
+}
+
 void PASVCommand::Execute()
 {
   util::net::Endpoint ep;
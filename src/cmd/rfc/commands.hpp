@@ -185,6 +185,15 @@ public:
   void Execute();
 };
 
+class OPTSCommand : public Command
+{
+public:
+  OPTSCommand(ftp::Client& client, const std::string& argStr, const Args& args) :
+    Command(client, client.Control(), client.Data(), argStr, args) { }
+
+  void Execute();
+};
+
 class PASVCommand : public Command
 {
 public:
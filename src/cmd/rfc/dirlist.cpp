@@ -13,6 +13,7 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <array>
 #include <iomanip>
 #include <cmath>
 #include <memory>
@@ -32,9 +33,69 @@
 #include "cfg/get.hpp"
 #include "stats/util.hpp"
 #include "util/scopeguard.hpp"
+#include "fs/listingpool.hpp"
 
 namespace cmd { namespace rfc
 {
+
+void ListBuffer::Append(const char* s, size_t len)
+{
+  if (length + len > capacity)
+  {
+    Flush();
+    if (len > capacity)
+    {
+      socket.Write(s, len);
+      return;
+    }
+  }
+  
+  memcpy(buffer.get() + length, s, len);
+  length += len;
+}
+
+void ListBuffer::AppendPadded(const char* s, size_t len, size_t width, Align align)
+{
+  if (align == Right && len < width) Pad(width - len);
+  Append(s, len);
+  if (align == Left && len < width) Pad(width - len);
+}
+
+void ListBuffer::AppendNumber(unsigned long long value, size_t width, Align align)
+{
+  char digits[20];
+  char* end = digits + sizeof(digits);
+  char* begin = end;
+  do
+  {
+    *--begin = '0' + value % 10;
+    value /= 10;
+  }
+  while (value > 0);
+  
+  AppendPadded(begin, end - begin, width, align);
+}
+
+void ListBuffer::Pad(size_t len)
+{
+  static const char spaces[] = "                ";
+  while (len > 0)
+  {
+    size_t chunk = std::min(len, sizeof(spaces) - 1);
+    Append(spaces, chunk);
+    len -= chunk;
+  }
+}
+
+void ListBuffer::Flush()
+{
+  if (length > 0)
+  {
+    socket.Write(buffer.get(), length);
+    length = 0;
+  }
+}
+
 namespace
 {
 
@@ -142,16 +203,33 @@ void ListOptions::ParseOption(char option)
   }
 }
 
+DirectoryList::Context::Context(const acl::User& user, const ListOptions& options) :
+  user(new acl::User(user)),
+  options(options)
+{
+}
+
 DirectoryList::DirectoryList(ftp::Client& client,
                              ftp::Writeable& socket,
                              const fs::Path& path,
                              const ListOptions& options,
-                             int maxRecursion) :
+                             int maxRecursion,
+                             long long maxEntries,
+                             int maxSeconds) :
   client(client),
   socket(socket),
   path(path),
   options(options),
-  maxRecursion(maxRecursion)
+  maxRecursion(maxRecursion),
+  maxEntries(maxEntries),
+  maxDuration(boost::posix_time::seconds(maxSeconds)),
+  context(std::make_shared<Context>(client.User(), options)),
+  readAhead(0),
+  entries(0),
+  truncated(false),
+  buffer(socket),
+  lastTimestampTime(0),
+  lastTimestamp(nullptr)
 {
 }
 
@@ -195,9 +273,11 @@ void DirectoryList::SplitPath(const fs::Path& path, fs::VirtualPath& parent,
   parent = fs::PathFromUser(parent.ToString());
 }
 
-void DirectoryList::Readdir(const fs::VirtualPath& path, fs::DirEnumerator& dirEnum) const
+void DirectoryList::Readdir(const Context& context, const fs::VirtualPath& path, 
+                            fs::DirEnumerator& dirEnum)
 {
-  dirEnum.Readdir(client.User(), path, !options.NoOwners() && !options.SizeName());
+  const ListOptions& options = context.options;
+  dirEnum.Readdir(*context.user, path, !options.NoOwners() && !options.SizeName());
 
   if (options.SizeSort())
   {
@@ -222,14 +302,81 @@ void DirectoryList::Readdir(const fs::VirtualPath& path, fs::DirEnumerator& dirE
   }
 }
 
-void DirectoryList::ListPath(const fs::VirtualPath& path, std::queue<std::string> masks, int depth) const
+bool DirectoryList::ReadAhead(const fs::VirtualPath& path, 
+                              std::future<fs::DirEnumerator>& pending) const
+{
+  if (readAhead >= maxReadAhead) return false;
+  
+  auto promise = std::make_shared<std::promise<fs::DirEnumerator>>();
+  auto context = this->context;
+  bool submitted = fs::ListingPool::Get().Submit([promise, context, path]()
+    {
+      cfg::UpdateLocal();
+      fs::DirEnumerator dirEnum;
+      try
+      {
+        Readdir(*context, path, dirEnum);
+        promise->set_value(std::move(dirEnum));
+      }
+      catch (const util::SystemError&)
+      {
+        // silent failure - gives empty directory list
+        promise->set_value(fs::DirEnumerator());
+      }
+      catch (const boost::thread_interrupted&)
+      {
+        throw;
+      }
+      catch (...)
+      {
+        promise->set_exception(std::current_exception());
+      }
+    });
+  
+  if (!submitted) return false;
+  pending = promise->get_future();
+  ++readAhead;
+  return true;
+}
+
+bool DirectoryList::LimitReached() const
+{
+  if (truncated) return true;
+  if ((maxEntries > 0 && entries >= maxEntries) ||
+      (!maxDuration.is_special() && maxDuration.total_seconds() > 0 &&
+       boost::posix_time::microsec_clock::local_time() - start >= maxDuration))
+  {
+    logs::Debug("Directory listing of %1% truncated after %2% entries", this->path, entries);
+    truncated = true;
+  }
+  return truncated;
+}
+
+void DirectoryList::ListPath(const fs::VirtualPath& path, std::queue<std::string> masks, int depth,
+                             std::future<fs::DirEnumerator>* pending) const
 {
   if (maxRecursion && depth > maxRecursion) return;
+  if (LimitReached()) return;
 
   fs::DirEnumerator dirEnum;
   try
   {
-    Readdir(path, dirEnum);
+    if (pending && pending->valid()) 
+    {
+      try
+      {
+        dirEnum = pending->get();
+      }
+      catch (const std::future_error&)
+      {
+        // pool stopped before getting to it
+        Readdir(*context, path, dirEnum);
+      }
+    }
+    else
+    {
+      Readdir(*context, path, dirEnum);
+    }
   }
   catch (const util::SystemError& e)
   {
@@ -237,18 +384,21 @@ void DirectoryList::ListPath(const fs::VirtualPath& path, std::queue<std::string
     return;
   }
   
+  entries += dirEnum.size();
 
-  std::ostringstream message;
-  if (depth > 1) message << "\r\n";
+  if (depth > 1) buffer.Append("\r\n", 2);
   
   if (!path.IsEmpty() && depth > 1 && (options.Recursive() || !masks.empty()))
   {
-    message << path << ":\r\n";
+    buffer.Append(path.ToString());
+    buffer.Append(":\r\n", 3);
   }
   
   if (options.LongFormat())
   {
-    message << "total " << static_cast<long long>(dirEnum.TotalBytes() / 1024) << "\r\n";
+    buffer.Append("total ", 6);
+    buffer.AppendNumber(dirEnum.TotalBytes() / 1024);
+    buffer.Append("\r\n", 2);
   }
   
   std::string mask;
@@ -268,51 +418,65 @@ void DirectoryList::ListPath(const fs::VirtualPath& path, std::queue<std::string
       
       if (options.LongFormat())
       {
+        const util::path::Status& status = de.Status();
         if (options.SizeName())
         {
-          message << std::left << std::setw(10) << de.Status().Size() << ' '
-                  << de.Path();
+          buffer.AppendNumber(status.Size(), 10, ListBuffer::Left);
+          buffer.Append(' ');
+          buffer.Append(pathStr);
         }
         else
         {
-          message << Permissions(de.Status()) << ' '
-                  << std::setw(3) << de.Status().Native().st_nlink << ' '
-                  << std::left << std::setw(10) 
-                  << UIDToName(de.Owner().UID()) << ' ';
+          char perms[10];
+          Permissions(status, perms);
+          buffer.Append(perms, sizeof(perms));
+          buffer.Append(' ');
+          buffer.AppendNumber(status.Native().st_nlink, 3, ListBuffer::Right);
+          buffer.Append(' ');
+          buffer.AppendPadded(UIDToName(de.Owner().UID()), 10, ListBuffer::Left);
+          buffer.Append(' ');
           
           if (!options.NoGroup())
-            message << std::left << std::setw(10) 
-                    << GIDToName(de.Owner().GID()) << ' ';
+          {
+            buffer.AppendPadded(GIDToName(de.Owner().GID()), 10, ListBuffer::Left);
+            buffer.Append(' ');
+          }
                   
-          message << std::right << std::setw(10) << de.Status().Size() << ' '
-                  << Timestamp(de.Status()) << ' '
-                  << de.Path();
+          buffer.AppendNumber(status.Size(), 10, ListBuffer::Right);
+          buffer.Append(' ');
+          buffer.Append(Timestamp(status), timestampLength);
+          buffer.Append(' ');
+          buffer.Append(pathStr);
         }
         
-        if (de.Status().IsSymLink())
+        if (status.IsSymLink())
         {
           auto real = fs::MakeReal(path / de.Path());
           std::string dest;
           if (util::path::Readlink(real.ToString(), dest))
           {
-            message << " -> " << dest;
+            buffer.Append(" -> ", 4);
+            buffer.Append(dest);
           }
         }
                 
-        if (options.SlashDirs() && de.Status().IsDirectory()) message << '/';
-        message << "\r\n";
+        if (options.SlashDirs() && status.IsDirectory()) buffer.Append('/');
+        buffer.Append("\r\n", 2);
       }
       else
       {
-        message << de.Path() << "\r\n";
+        buffer.Append(pathStr);
+        buffer.Append("\r\n", 2);
       }
     }
   }
   
-  Output(message.str());
+  buffer.Flush();
   
-  if (options.Recursive() || !mask.empty())
+  if ((options.Recursive() || !mask.empty()) &&
+      (!maxRecursion || depth + 1 <= maxRecursion))
   {
+    std::vector<fs::VirtualPath> subdirs;
     for (const auto& de : dirEnum)
     {
       if (!de.Status().IsDirectory() ||
@@ -324,8 +488,29 @@ void DirectoryList::ListPath(const fs::VirtualPath& path, std::queue<std::string
 
       fs::VirtualPath fullPath(path);
       fullPath /= de.Path();
-   
-      ListPath(fullPath, masks, depth + 1);
+      subdirs.emplace_back(std::move(fullPath));
+    }
+    
+    // subdirectories are read ahead on the listing pool, output still
+    // goes out depth first in the same order as a serial listing
+    std::vector<std::future<fs::DirEnumerator>> subdirsPending(subdirs.size());
+    std::vector<bool> readingAhead(subdirs.size(), false);
+    size_t next = 0;
+    auto fill = [&]()
+      {
+        while (next < subdirs.size() && ReadAhead(subdirs[next], subdirsPending[next]))
+        {
+          readingAhead[next++] = true;
+        }
+      };
+    
+    fill();
+    for (size_t i = 0; i < subdirs.size(); ++i)
+    {
+      next = std::max(next, i + 1);
+      ListPath(subdirs[i], masks, depth + 1, &subdirsPending[i]);
+      if (readingAhead[i]) --readAhead;
+      fill();
     }
   }
 }
@@ -335,40 +520,45 @@ void DirectoryList::Execute()
   fs::VirtualPath parent;
   std::queue<std::string> masks;
   SplitPath(path, parent, masks);
+  start = boost::posix_time::microsec_clock::local_time();
   ListPath(parent, masks);
 }
 
-std::string DirectoryList::Permissions(const util::path::Status& status)
+void DirectoryList::Permissions(const util::path::Status& status, char* perms)
 {
-  std::string perms(10, '-');
+  static const char modeTable[8][3] =
+  {
+    { '-', '-', '-' }, { '-', '-', 'x' }, { '-', 'w', '-' }, { '-', 'w', 'x' },
+    { 'r', '-', '-' }, { 'r', '-', 'x' }, { 'r', 'w', '-' }, { 'r', 'w', 'x' }
+  };
   
   if (status.IsSymLink()) perms[0] = 'l';
   else if (status.IsDirectory()) perms[0] = 'd';
+  else perms[0] = '-';
   
-  const struct stat& native = status.Native();
-  
-  if (native.st_mode & S_IRUSR) perms[1] = 'r';
-  if (native.st_mode & S_IWUSR) perms[2] = 'w';
-  if (native.st_mode & S_IXUSR) perms[3] = 'x';
-  if (native.st_mode & S_IRGRP) perms[4] = 'r';
-  if (native.st_mode & S_IWGRP) perms[5] = 'w';
-  if (native.st_mode & S_IXGRP) perms[6] = 'x';
-  if (native.st_mode & S_IROTH) perms[7] = 'r';
-  if (native.st_mode & S_IWOTH) perms[8] = 'w';
-  if (native.st_mode & S_IXOTH) perms[9] = 'x';
-  
-  return perms;
+  mode_t mode = status.Native().st_mode;
+  memcpy(perms + 1, modeTable[(mode >> 6) & 7], 3);
+  memcpy(perms + 4, modeTable[(mode >> 3) & 7], 3);
+  memcpy(perms + 7, modeTable[mode & 7], 3);
 }
 
-
-std::string DirectoryList::Timestamp(const util::path::Status& status) const
+const char* DirectoryList::Timestamp(const util::path::Status& status) const
 {
   time_t modTime = status.Native().st_mtime - status.Native().st_mtime % 60;
+  if (lastTimestamp && modTime == lastTimestampTime) return lastTimestamp;
+  
   auto it = timestampCache.find(modTime);
-  if (it != timestampCache.end()) return it->second;
-  char buf[13];
-  strftime(buf, sizeof(buf), "%b %d %H:%M", localtime(&modTime));
-  return timestampCache[modTime] = buf;
+  if (it == timestampCache.end())
+  {
+    std::array<char, timestampLength + 1> buf;
+    struct tm tm;
+    strftime(buf.data(), buf.size(), "%b %d %H:%M", localtime_r(&modTime, &tm));
+    it = timestampCache.emplace(modTime, buf).first;
+  }
+  
+  lastTimestampTime = modTime;
+  lastTimestamp = it->second.data();
+  return lastTimestamp;
 }
   
 const std::string& DirectoryList::UIDToName(acl::UserID uid) const
@@ -435,7 +625,8 @@ void LISTCommand::Execute()
   std::string forcedOptions(nlst ? "" : "l" + config.Lslong().Options());
   
   DirectoryList dirList(client, data, path, ListOptions(options, forcedOptions),
-                        config.Lslong().MaxRecursion());
+                        config.Lslong().MaxRecursion(), config.Lslong().MaxEntries(),
+                        config.Lslong().MaxSeconds());
 
   try
   {
@@ -450,7 +641,8 @@ void LISTCommand::Execute()
   }
   
   data.Close();
-  control.Reply(ftp::DataClosedOkay, "End of directory listing (" + 
+  control.Reply(ftp::DataClosedOkay, std::string("End of directory listing") + 
+      (dirList.Truncated() ? ", truncated at limit" : "") + " (" +
       stats::HighResSecondsString(data.State().StartTime(), data.State().EndTime()) + ")"); 
 }
 
@@ -491,13 +683,16 @@ void STATCommand::Execute()
     
   control.PartReply(ftp::DirectoryStatus, "Status of " + fs::MakePretty(MakeVirtual(path)).ToString() + ":");
   DirectoryList dirList(client, control, path, ListOptions(options, forcedOptions),
-                        config.Lslong().MaxRecursion());
+                        config.Lslong().MaxRecursion(), config.Lslong().MaxEntries(),
+                        config.Lslong().MaxSeconds());
   
   boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
   dirList.Execute();
   boost::posix_time::ptime end = boost::posix_time::microsec_clock::local_time();
   
-  control.Reply(ftp::DirectoryStatus, "End of status (" + stats::HighResSecondsString(start, end) + ")"); 
+  control.Reply(ftp::DirectoryStatus, std::string("End of status") + 
+      (dirList.Truncated() ? ", truncated at limit" : "") + " (" + 
+      stats::HighResSecondsString(start, end) + ")"); 
   return;
   
   (void) singleLineReplies;
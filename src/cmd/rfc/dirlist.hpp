@@ -16,10 +16,14 @@
 #ifndef __CMD_DIRLIST_HPP
 #define __CMD_DIRLIST_HPP
 
+#include <array>
 #include <ctime>
+#include <future>
+#include <memory>
 #include <string>
 #include <queue>
 #include <unordered_map>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include "fs/path.hpp"
 #include "acl/types.hpp"
 #include "ftp/writeable.hpp"
@@ -36,6 +40,11 @@ namespace fs
 class DirEnumerator;
 }
 
+namespace acl
+{
+class User;
+}
+
 namespace util { namespace path
 {
 class Status;
@@ -75,42 +84,105 @@ public:
   bool NoOwners() const { return noOwners; }
 };
 
+// fixed size buffer listing lines are formatted straight into, written
+// to the socket whenever it fills and at the end of each directory
+class ListBuffer
+{
+  ftp::Writeable& socket;
+  std::unique_ptr<char[]> buffer;
+  size_t length;
+  
+  static const size_t capacity = 64 * 1024;
+  
+  void Pad(size_t len);
+  
+public:
+  enum Align { Left, Right };
+
+  ListBuffer(ftp::Writeable& socket) :
+    socket(socket), buffer(new char[capacity]), length(0) { }
+  
+  void Append(const char* s, size_t len);
+  void Append(const std::string& s) { Append(s.data(), s.length()); }
+  void Append(char ch)
+  {
+    if (length == capacity) Flush();
+    buffer[length++] = ch;
+  }
+  
+  void AppendPadded(const char* s, size_t len, size_t width, Align align);
+  void AppendPadded(const std::string& s, size_t width, Align align)
+  { AppendPadded(s.data(), s.length(), width, align); }
+  void AppendNumber(unsigned long long value, size_t width = 0, Align align = Left);
+  
+  void Flush();
+};
+
 class DirectoryList
 {
+  // shared with directory reads still queued when the listing ends
+  struct Context
+  {
+    std::unique_ptr<acl::User> user;
+    ListOptions options;
+    
+    Context(const acl::User& user, const ListOptions& options);
+  };
+
   ftp::Client& client;
   ftp::Writeable& socket;
   fs::Path path;
   ListOptions options;
   int maxRecursion;
+  long long maxEntries;
+  boost::posix_time::time_duration maxDuration;
+  std::shared_ptr<const Context> context;
+  
+  mutable int readAhead;
+  mutable long long entries;
+  mutable boost::posix_time::ptime start;
+  mutable bool truncated;
   
   mutable std::unordered_map<acl::UserID, std::string> userNameCache;
   mutable std::unordered_map<acl::GroupID, std::string> groupNameCache;
-  mutable std::unordered_map<time_t, std::string> timestampCache;
+  mutable ListBuffer buffer;
+  mutable std::unordered_map<time_t, std::array<char, 13>> timestampCache;
+  mutable time_t lastTimestampTime;
+  mutable const char* lastTimestamp;
   
-  void ListPath(const fs::VirtualPath& path, std::queue<std::string> masks, int depth = 1) const;
-  void Readdir(const fs::VirtualPath& path, fs::DirEnumerator& dirEnum) const;
-  inline void Output(const std::string& message) const
-  {
-    socket.Write(message.c_str(), message.length());
-  }
+  static const int maxReadAhead = 16;
+  static const size_t timestampLength = 12;
   
+  void ListPath(const fs::VirtualPath& path, std::queue<std::string> masks, int depth = 1,
+                std::future<fs::DirEnumerator>* pending = nullptr) const;
+  bool ReadAhead(const fs::VirtualPath& path, std::future<fs::DirEnumerator>& pending) const;
+  bool LimitReached() const;
+  static void Readdir(const Context& context, const fs::VirtualPath& path, 
+                      fs::DirEnumerator& dirEnum);
   const std::string& UIDToName(acl::UserID uid) const;
   const std::string& GIDToName(acl::GroupID gid) const;
   
   static void SplitPath(const fs::Path& path, fs::VirtualPath& parent,
                         std::queue<std::string>& masks);
                         
-  static std::string Permissions(const util::path::Status& status);
-  std::string Timestamp(const util::path::Status& status) const;
+  // writes exactly 10 characters
+  static void Permissions(const util::path::Status& status, char* perms);
+  // timestampLength characters, valid for the life of the listing
+  const char* Timestamp(const util::path::Status& status) const;
 
 public:
   DirectoryList(ftp::Client& client,
                 ftp::Writeable& socket,
                 const fs::Path& path,
                 const ListOptions& options,
-                int maxRecursion);
+                int maxRecursion,
+                long long maxEntries = 0,
+                int maxSeconds = 0);
                 
   void Execute();
+  
+  // the listing stopped early on the entry or time limit
+  bool Truncated() const { return truncated; }
 };
 
 class LISTCommand : public Command
@@ -20,6 +20,7 @@
 #include "cmd/rfc/retr.hpp"
 #include "cmd/rfc/stor.hpp"
 #include "cmd/rfc/dirlist.hpp"
+#include "cmd/rfc/mlst.hpp"
 
 namespace cmd { namespace rfc
 {
@@ -82,18 +83,18 @@ Factory::Factory()
                   nullptr, "NOT IMPLEMENTED" }, },
     { "MKD",    { 1,  -1, ftp::ClientState::LoggedIn,         ftp::ActionNotOkay,
                   std::make_shared<Creator<MKDCommand>>(), "MKD <path>" }, },
-    { "MLSD",   { 0,  -1, ftp::ClientState::AnyState,         ftp::ActionNotOkay,
-                  nullptr, "NOT IMPLEMENTED" }, },
-    { "MLST",   { 0,  -1, ftp::ClientState::AnyState,         ftp::ActionNotOkay,
-                  nullptr, "NOT IMPLEMENTED" }, },
+    { "MLSD",   { 0,  -1, ftp::ClientState::LoggedIn,         ftp::ActionNotOkay,
+                  std::make_shared<Creator<MLSDCommand>>(), "MLSD [<path>]" }, },
+    { "MLST",   { 0,  -1, ftp::ClientState::LoggedIn,         ftp::ActionNotOkay,
+                  std::make_shared<Creator<MLSTCommand>>(), "MLST [<path>]" }, },
     { "MODE",   { 1,  1,  ftp::ClientState::LoggedIn,         ftp::ActionNotOkay,
                   std::make_shared<Creator<MODECommand>>(), "MODE S|B|C" }, },
     { "NLST",   { 0,  -1, ftp::ClientState::LoggedIn,         ftp::ActionNotOkay,
                   std::make_shared<Creator<NLSTCommand>>(), "NLST [-<options>] [<path>]" }, },
     { "NOOP",   { 0,  0,  ftp::ClientState::AnyState,         ftp::ActionNotOkay,
                   std::make_shared<Creator<NOOPCommand>>(), "NOOP" }, },
-    { "OPTS",   { 0,  -1, ftp::ClientState::AnyState,         ftp::ActionNotOkay,
-                  nullptr, "NOT IMPLEMENTED" }, },
+    { "OPTS",   { 1,  2,  ftp::ClientState::AnyState,         ftp::ActionNotOkay,
+                  std::make_shared<Creator<OPTSCommand>>(), "OPTS MLST [<fact>;..]" }, },
     { "PASS",   { 0,  -1, ftp::ClientState::WaitingPassword,  ftp::ActionNotOkay,
                   std::make_shared<Creator<PASSCommand>>(), "PASS <password>" }, },
     { "PASV",   { 0,  0,  ftp::ClientState::LoggedIn,         ftp::ActionNotOkay,
@@ -0,0 +1,325 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <ctime>
+#include <unordered_map>
+#include "cmd/rfc/mlst.hpp"
+#include "cmd/rfc/dirlist.hpp"
+#include "fs/direnumerator.hpp"
+#include "fs/owner.hpp"
+#include "fs/path.hpp"
+#include "ftp/client.hpp"
+#include "ftp/control.hpp"
+#include "ftp/data.hpp"
+#include "ftp/mlst.hpp"
+#include "acl/path.hpp"
+#include "acl/user.hpp"
+#include "acl/group.hpp"
+#include "cfg/get.hpp"
+#include "stats/util.hpp"
+#include "util/error.hpp"
+#include "util/path/status.hpp"
+#include "util/scopeguard.hpp"
+#include "util/string.hpp"
+
+namespace cmd { namespace rfc
+{
+
+namespace
+{
+
+namespace PP = acl::path;
+using ftp::mlst::Fact;
+using ftp::mlst::HasFact;
+
+// formats one fact line per entry, facts not selected with OPTS MLST
+// are skipped along with the acl checks and owner lookups they'd need
+class FactWriter
+{
+  const acl::User& user;
+  Fact facts;
+  std::unordered_map<acl::UserID, std::string> userNames;
+  std::unordered_map<acl::GroupID, std::string> groupNames;
+
+  const std::string& UserName(acl::UserID uid)
+  {
+    auto it = userNames.find(uid);
+    if (it != userNames.end()) return it->second;
+    return userNames[uid] = acl::UIDToName(uid);
+  }
+  
+  const std::string& GroupName(acl::GroupID gid)
+  {
+    auto it = groupNames.find(gid);
+    if (it != groupNames.end()) return it->second;
+    return groupNames[gid] = acl::GIDToName(gid);
+  }
+  
+  size_t Perm(const fs::VirtualPath& path, bool directory, char* perm)
+  {
+    size_t len = 0;
+    if (directory)
+    {
+      if (PP::DirAllowed<PP::View>(user, path))
+      {
+        perm[len++] = 'e';
+        perm[len++] = 'l';
+      }
+      if (PP::DirAllowed<PP::Upload>(user, path)) perm[len++] = 'c';
+      if (PP::DirAllowed<PP::Makedir>(user, path)) perm[len++] = 'm';
+      if (PP::DirAllowed<PP::Delete>(user, path))
+      {
+        perm[len++] = 'd';
+        perm[len++] = 'p';
+      }
+      if (PP::DirAllowed<PP::Rename>(user, path)) perm[len++] = 'f';
+    }
+    else
+    {
+      if (PP::FileAllowed<PP::Download>(user, path)) perm[len++] = 'r';
+      if (PP::FileAllowed<PP::Resume>(user, path)) perm[len++] = 'a';
+      if (PP::FileAllowed<PP::Overwrite>(user, path)) perm[len++] = 'w';
+      if (PP::FileAllowed<PP::Delete>(user, path)) perm[len++] = 'd';
+      if (PP::FileAllowed<PP::Rename>(user, path)) perm[len++] = 'f';
+    }
+    return len;
+  }
+  
+public:
+  FactWriter(const acl::User& user, Fact facts) :
+    user(user), facts(facts) { }
+  
+  bool NeedOwners() const
+  { return HasFact(facts, Fact::UnixOwner) || HasFact(facts, Fact::UnixGroup); }
+  
+  void Write(ListBuffer& buffer, const fs::VirtualPath& path, const std::string& name,
+             const util::path::Status& status, const fs::Owner& owner)
+  {
+    const struct stat& native = status.Native();
+    char buf[64];
+    int len;
+    
+    if (HasFact(facts, Fact::Type))
+    {
+      buffer.Append("type=", 5);
+      if (status.IsDirectory()) buffer.Append("dir;", 4);
+      else if (status.IsRegularFile()) buffer.Append("file;", 5);
+      else buffer.Append("OS.unix=special;", 16);
+    }
+    
+    if (HasFact(facts, Fact::Size))
+    {
+      buffer.Append("size=", 5);
+      buffer.AppendNumber(status.Size());
+      buffer.Append(';');
+    }
+    
+    if (HasFact(facts, Fact::Modify))
+    {
+      struct tm tm;
+      gmtime_r(&native.st_mtime, &tm);
+      len = snprintf(buf, sizeof(buf), "modify=%04d%02d%02d%02d%02d%02d;",
+                     tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                     tm.tm_hour, tm.tm_min, tm.tm_sec);
+      buffer.Append(buf, len);
+    }
+    
+    if (HasFact(facts, Fact::Perm))
+    {
+      char perm[8];
+      buffer.Append("perm=", 5);
+      buffer.Append(perm, Perm(path, status.IsDirectory(), perm));
+      buffer.Append(';');
+    }
+    
+    if (HasFact(facts, Fact::Unique))
+    {
+      len = snprintf(buf, sizeof(buf), "unique=%llxU%llx;", 
+                     static_cast<unsigned long long>(native.st_dev),
+                     static_cast<unsigned long long>(native.st_ino));
+      buffer.Append(buf, len);
+    }
+    
+    if (HasFact(facts, Fact::UnixMode))
+    {
+      len = snprintf(buf, sizeof(buf), "UNIX.mode=%04o;", native.st_mode & 07777);
+      buffer.Append(buf, len);
+    }
+    
+    if (HasFact(facts, Fact::UnixOwner))
+    {
+      buffer.Append("UNIX.owner=", 11);
+      buffer.Append(UserName(owner.UID()));
+      buffer.Append(';');
+    }
+    
+    if (HasFact(facts, Fact::UnixGroup))
+    {
+      buffer.Append("UNIX.group=", 11);
+      buffer.Append(GroupName(owner.GID()));
+      buffer.Append(';');
+    }
+    
+    buffer.Append(' ');
+    buffer.Append(name);
+    buffer.Append("\r\n", 2);
+  }
+};
+
+}
+
+void MLSDCommand::Execute()
+{
+  fs::VirtualPath path(fs::PathFromUser(argStr));
+  
+  util::Error e(PP::DirAllowed<PP::View>(client.User(), path));
+  if (!e)
+  {
+    control.Reply(ftp::ActionNotOkay, argStr + ": " + e.Message());
+    return;
+  }
+  
+  try
+  {
+    if (!util::path::Status(fs::MakeReal(path).ToString()).IsDirectory())
+    {
+      control.Reply(ftp::SyntaxError, argStr + ": Not a directory.");
+      return;
+    }
+  }
+  catch (const util::SystemError& e)
+  {
+    control.Reply(ftp::ActionNotOkay, argStr + ": " + e.Message());
+    return;
+  }
+
+  std::ostringstream os;
+  os << "Opening connection for machine directory listing";
+  if (data.Protection()) os << " using TLS/SSL";
+  os << ".";
+  control.Reply(ftp::TransferStatusOkay, os.str());
+
+  try
+  {
+    data.Open(ftp::TransferType::List);
+  }
+  catch (const util::net::NetworkError&e )
+  {
+    control.Reply(ftp::CantOpenDataConnection,
+                 "Unable to open data connection: " + e.Message());
+    return;
+  }
+  
+  if (!data.ProtectionOkay())
+  {
+    data.Close();
+    control.Reply(ftp::ProtocolNotSupported, 
+                  "TLS is enforced on directory listings.");
+    return;
+  }
+  
+  FactWriter writer(client.User(), client.MlstFacts());
+  bool all = ListOptions("", cfg::Get().Lslong().Options()).All();
+  
+  try
+  {
+    ListBuffer buffer(data);
+    fs::DirEnumerator dirEnum;
+    try
+    {
+      dirEnum.Readdir(client.User(), path, writer.NeedOwners());
+    }
+    catch (const util::SystemError&)
+    {
+      // silent failure - gives empty directory list
+    }
+    
+    for (const auto& de : dirEnum)
+    {
+      const std::string& name = de.Path().ToString();
+      if (name[0] == '.' && !all) continue;
+      writer.Write(buffer, path / de.Path(), name, de.Status(), de.Owner());
+    }
+    
+    buffer.Flush();
+  }
+  catch (const util::net::NetworkError& e)
+  {
+    data.Close();
+    control.Reply(ftp::DataCloseAborted,
+                "Error whiling writing to data connection: " + e.Message());
+    return;
+  }
+  
+  data.Close();
+  control.Reply(ftp::DataClosedOkay, "End of machine directory listing (" + 
+      stats::HighResSecondsString(data.State().StartTime(), data.State().EndTime()) + ")"); 
+}
+
+void MLSTCommand::Execute()
+{
+  fs::VirtualPath path(fs::PathFromUser(argStr));
+  
+  util::path::Status status;
+  try
+  {
+    status.Reset(fs::MakeReal(path).ToString());
+  }
+  catch (const util::SystemError& e)
+  {
+    control.Reply(ftp::ActionNotOkay, argStr + ": " + e.Message());
+    return;
+  }
+  
+  util::Error e = status.IsDirectory() ? PP::DirAllowed<PP::View>(client.User(), path) :
+                                         PP::FileAllowed<PP::View>(client.User(), path);
+  if (!e)
+  {
+    control.Reply(ftp::ActionNotOkay, argStr + ": " + e.Message());
+    return;
+  }
+  
+  FactWriter writer(client.User(), client.MlstFacts());
+  fs::Owner owner(0, 0);
+  if (writer.NeedOwners())
+  {
+    util::Error hideOwner = status.IsDirectory() ? 
+        PP::DirAllowed<PP::Hideowner>(client.User(), path) :
+        PP::FileAllowed<PP::Hideowner>(client.User(), path);
+    if (!hideOwner) owner = fs::GetOwner(fs::MakeReal(path));
+  }
+  
+  bool singleLineReplies = control.SingleLineReplies();
+  control.SetSingleLineReplies(false);
+  
+  auto singleLineGuard = util::MakeScopeExit([&]{ control.SetSingleLineReplies(singleLineReplies); });  
+
+  std::string pretty(fs::MakePretty(path).ToString());
+  control.PartReply(ftp::FileActionOkay, "Listing " + pretty);
+  
+  ListBuffer buffer(control);
+  buffer.Append(' ');
+  writer.Write(buffer, path, pretty, status, owner);
+  buffer.Flush();
+  
+  control.Reply(ftp::FileActionOkay, "End.");
+  
+  (void) singleLineReplies;
+  (void) singleLineGuard;
+}
+
+} /* rfc namespace */
+} /* cmd namespace */
@@ -18,6 +18,8 @@
 #include <boost/logic/tribool.hpp>
 #include "cmd/rfc/retr.hpp"
 #include "fs/file.hpp"
+#include "fs/follow.hpp"
+#include "ftp/fanout.hpp"
 #include "db/stats/stats.hpp"
 #include "stats/util.hpp"
 #include "util/scopeguard.hpp"
@@ -35,7 +37,7 @@
 #include "fs/path.hpp"
 #include "db/stats/stats.hpp"
 #include "stats/types.hpp"
-#include "stats/stat.hpp"
+#include "db/stats/weekly.hpp"
 #include "ftp/online.hpp"
 
 namespace cmd { namespace rfc
@@ -46,9 +48,8 @@ boost::tribool CheckWeeklyAllotment(const acl::User& user, const std::string& se
   long long allotment = user.SectionWeeklyAllotment(section);
   if (allotment <= 0) return boost::indeterminate;
   
-  auto downloaded = db::stats::CalculateSingleUser(user.ID(), section, 
-                        stats::Timeframe::Week, stats::Direction::Download);
-  return downloaded.KBytes() + (size / 1024) < allotment;
+  long long downloaded = db::stats::WeeklyCounters::Get().Downloaded(user.ID(), section);
+  return downloaded + (size / 1024) < allotment;
 }
 
 void RETRCommand::Execute()
@@ -177,19 +178,11 @@ void RETRCommand::Execute()
     if (boost::indeterminate(allotment))
     {
       assert(ratio != -1);
-      if (size > data.State().Bytes())
-      {
-        // download failed short, give the remaining credits back
-        client.User().IncrSectionCredits(section && section->SeparateCredits() ? 
-                section->Name() : "", (size - data.State().Bytes()) / 1024 * ratio);
-      }
-      else
-      if (data.State().Bytes() > size)
-      {
-        // final download size was larger than at start, take some more credits
-        client.User().DecrSectionCreditsForce(section && section->SeparateCredits() ? 
-                section->Name() : "", (data.State().Bytes() - size) * ratio);
-      }
+      // the full size was reserved up front, give back the remainder if the
+      // download fell short, or take more if the file grew since the start
+      client.User().SettleSectionCredits(section && section->SeparateCredits() ? 
+              section->Name() : "", size / 1024 * ratio, 
+              data.State().Bytes() / 1024 * ratio);
     }
   });  
 
@@ -218,24 +211,58 @@ void RETRCommand::Execute()
   {
     const size_t bufferSize = cfg::Get().DataBufferSize();
     ftp::DownloadSpeedControl speedControl(client, path);
-    ftp::OnlineTransferUpdater onlineUpdater(boost::this_thread::get_id(), stats::Direction::Download,
+    ftp::OnlineTransferUpdater onlineUpdater(client.OnlineSlot(), stats::Direction::Download,
                                              data.State().StartTime());
     
     bool dlIncomplete = cfg::Get().DlIncomplete();
+    fs::FollowedFilePtr followed;
+    bool follow = true;
+    ftp::FanoutRingPtr fanout;
+    if (dlIncomplete) fanout = ftp::Fanout::Get().Find(MakeReal(path).ToString());
+    off_t position = offset;
+    bool seekNeeded = false;
     std::vector<char> asciiBuffer;
     std::vector<char> buffer;
     buffer.resize(bufferSize);
     
     while (true)
     {
-      std::streamsize len = fin->read(&buffer[0], buffer.size());
+      unsigned long generation = followed ? followed->Generation() : 0;
+      
+      // served from the upload's fanout window while we're within it,
+      // otherwise back to the file from wherever we got up to
+      std::streamsize len = fanout ? fanout->Read(position, &buffer[0], buffer.size()) : 0;
+      if (len > 0) seekNeeded = true;
+      else
+      {
+        if (seekNeeded)
+        {
+          fin->seek(position, std::ios_base::beg);
+          seekNeeded = false;
+        }
+        len = fin->read(&buffer[0], buffer.size());
+      }
+      
       if (len < 0) 
       {
         if (!dlIncomplete || !fs::IsIncomplete(MakeReal(path))) break;
-        boost::this_thread::sleep(pt::microseconds(10000));
+        if (!followed && follow)
+        {
+          // read again before waiting, the file may have grown
+          // before the watch was added
+          followed = fs::FileFollower::Get().Follow(MakeReal(path));
+          follow = !!followed;
+          if (!fanout || fanout->Retired()) 
+            fanout = ftp::Fanout::Get().Find(MakeReal(path).ToString());
+          if (followed) continue;
+        }
+        
+        if (followed) followed->Wait(generation);
+        else boost::this_thread::sleep(pt::microseconds(10000));
         continue;
       }
       
+      position += len;
       data.State().Update(len);
       
       const char *bufp = buffer.data();
@@ -15,9 +15,11 @@
 
 #include <ios>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include "cmd/rfc/stor.hpp"
 #include "fs/file.hpp"
+#include "fs/dircache.hpp"
 #include "db/stats/stats.hpp"
 #include "stats/util.hpp"
 #include "ftp/counter.hpp"
@@ -32,6 +34,7 @@
 #include "exec/check.hpp"
 #include "cmd/error.hpp"
 #include "fs/owner.hpp"
+#include "fs/ledger.hpp"
 #include "util/asynccrc32.hpp"
 #include "util/crc32.hpp"
 #include "ftp/error.hpp"
@@ -41,6 +44,7 @@
 #include "acl/flags.hpp"
 #include "ftp/xdupe.hpp"
 #include "ftp/online.hpp"
+#include "ftp/fanout.hpp"
 
 namespace cmd { namespace rfc
 {
@@ -100,12 +104,7 @@ void STORCommand::DupeMessage(const fs::VirtualPath& path)
 
 bool STORCommand::CalcCRC(const fs::VirtualPath& path)
 {
-  for (auto& mask : cfg::Get().CalcCrc())
-  {
-    if (util::WildcardMatch(mask, path.ToString())) return true;
-  }
-  
-  return false;
+  return cfg::Get().CalcCrc().Match(path.ToString());
 }
 
 void STORCommand::Execute()
@@ -275,8 +274,10 @@ void STORCommand::Execute()
   try
   {
     ftp::UploadSpeedControl speedControl(client, path);
-    ftp::OnlineTransferUpdater onlineUpdater(boost::this_thread::get_id(), stats::Direction::Upload,
+    ftp::OnlineTransferUpdater onlineUpdater(client.OnlineSlot(), stats::Direction::Upload,
                                              data.State().StartTime());
+    ftp::FanoutRingPtr fanout = ftp::Fanout::Get().Create(fs::MakeReal(path).ToString(), 
+                                                          data.RestartOffset());
     std::vector<char> asciiBuffer;
     std::vector<char> buffer;
     buffer.resize(bufferSize);
@@ -296,6 +297,7 @@ void STORCommand::Execute()
       data.State().Update(len);
       
       fout->write(bufp, len);
+      if (fanout) fanout->Publish(bufp, len);
       
       if (calcCrc) crc32->Update(reinterpret_cast<const uint8_t*>(bufp), len);
       onlineUpdater.Update(data.State().Bytes());
@@ -331,6 +333,8 @@ void STORCommand::Execute()
 
   fout->close();
   data.Close();
+  // directory sizes must see the final size even if the chmod fails
+  fs::InvalidateListing(fs::MakeReal(path));
   
   e = fs::Chmod(fs::MakeReal(path), completeMode);
   if (!e) control.PartReply(ftp::DataClosedOkay, "Failed to chmod upload: " + e.Message());
@@ -349,6 +353,14 @@ void STORCommand::Execute()
                       section ? section->Name() : ""))
   {
     fileOkay = true;
+    // a resumed file was already counted at some earlier size
+    struct stat st;
+    if (data.RestartOffset() > 0 || lstat(fs::MakeReal(path).CString(), &st) < 0) 
+      fs::InvalidateLedger(fs::MakeReal(path).Dirname());
+    else 
+      fs::UpdateLedger(fs::MakeReal(path), client.User().ID(), data.State().Bytes() / 1024, 1,
+                       st.st_ino);
+    
     bool nostats = !section || acl::path::FileAllowed<acl::path::Nostats>(client.User(), path);
     db::stats::Upload(client.User(), data.State().Bytes() / 1024,
                       duration.total_milliseconds(),
@@ -19,6 +19,7 @@
 #include "cmd/site/chown.hpp"
 #include "fs/globiterator.hpp"
 #include "fs/dircontainer.hpp"
+#include "fs/ledger.hpp"
 #include "cmd/error.hpp"
 #include "util/path/status.hpp"
 #include "util/enumbitwise.hpp"
@@ -41,7 +42,11 @@ void CHOWNCommand::Process(fs::VirtualPath pathmask)
         util::path::Status status(fs::MakeReal(entryPath).ToString());
         fs::SetOwner(fs::MakeReal(entryPath), owner);
         if (status.IsDirectory()) ++dirs;
-        else ++files;
+        else
+        {
+          fs::InvalidateLedger(fs::MakeReal(entryPath).Dirname());
+          ++files;
+        }
       }
       catch (const util::SystemError& e)
       {
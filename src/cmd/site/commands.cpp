@@ -47,12 +47,15 @@
 #include "cfg/util.hpp"
 #include "cmd/error.hpp"
 #include "cmd/online.hpp"
+#include "db/connectionpool.hpp"
 #include "db/dupe/dupe.hpp"
 #include "db/index/index.hpp"
+#include "db/replicator.hpp"
 #include "db/stats/protocol.hpp"
 #include "db/stats/stats.hpp"
 #include "db/stats/traffic.hpp"
 #include "db/stats/transfers.hpp"
+#include "fs/dircache.hpp"
 #include "fs/dircontainer.hpp"
 #include "fs/directory.hpp"
 #include "fs/globiterator.hpp"
@@ -61,6 +64,7 @@
 #include "ftp/task/task.hpp"
 #include "ftp/task/types.hpp"
 #include "ftp/xdupe.hpp"
+#include "ftp/fairshare.hpp"
 #include "logs/logs.hpp"
 #include "main.hpp"
 #include "stats/compile.hpp"
@@ -149,6 +153,37 @@ void ADDIPCommand::Execute()
   
 } 
 
+void BANDWIDTHCommand::Execute()
+{
+  static const char* levels[] = { "Site", "Section", "Group", "User" };
+  
+  std::ostringstream os;
+  for (auto direction : ::stats::directions)
+  {
+    auto usage = ftp::FairShareScheduler::Get().Usage(direction);
+    if (direction != ::stats::directions.front()) os << "\n";
+    os << (direction == ::stats::Direction::Upload ? "Upload" : "Download") << " fair share:";
+    if (usage.size() == 1)
+    {
+      os << "\n  No active transfers.";
+      continue;
+    }
+    
+    for (const auto& node : usage)
+    {
+      os << "\n" << std::string(node.depth * 2 + 2, ' ')
+         << std::left << std::setw(8) << levels[node.depth] << " "
+         << std::setw(std::max(1, 20 - node.depth * 2)) << node.name
+         << std::right << " weight " << std::setw(3) << node.weight
+         << " allocated " << std::setw(12) << stats::AutoUnitSpeedString(node.allocated / 1024.0)
+         << " used " << std::setw(12) << stats::AutoUnitSpeedString(node.used / 1024.0)
+         << " transfers " << node.transfers;
+    }
+  }
+  
+  control.Reply(ftp::CommandOkay, os.str());
+}
+
 void CHGADMINCommand::Execute()
 {
   acl::GroupID gid = acl::NameToGID(args[2]);
@@ -399,6 +434,38 @@ void DELUSERCommand::Execute()
   logs::Siteop(client.User().Name(), "deleted user '%1%'", user->Name());
 }
 
+void DIRCACHECommand::Execute()
+{
+  auto stats = fs::DirCache::Get().Stats();
+  unsigned long long lookups = stats.hits + stats.misses;
+  
+  std::ostringstream os;
+  os << "Directory cache: " << stats.directories << " directories, " 
+     << stats.entries << " entries";
+  os << "\nLookups: " << lookups << " hits " << stats.hits << " misses " << stats.misses;
+  if (lookups > 0)
+    os << " (" << std::fixed << std::setprecision(1) 
+       << stats.hits * 100.0 / lookups << "% hit rate)";
+  control.Reply(ftp::CommandOkay, os.str());
+}
+
+void DBPOOLCommand::Execute()
+{
+  auto stats = db::ConnectionPool::Get().Stats();
+  
+  std::ostringstream os;
+  os << "Database connections: " << stats.size << " open, " << stats.inUse 
+     << " in use, " << stats.maximum << " maximum";
+  os << "\nCheckouts: " << stats.checkouts << " (" << stats.affine << " on the thread's own connection)";
+  os << "\nWaits: " << stats.waits;
+  if (stats.waits > 0)
+    os << " (" << std::fixed << std::setprecision(1) 
+       << stats.waitMicroseconds / 1000.0 / stats.waits << "ms average)";
+  os << "\nOver the limit for nested checkouts: " << stats.overflows;
+  os << "\nErrors: " << stats.errors;
+  control.Reply(ftp::CommandOkay, os.str());
+}
+
 void DISKFREECommand::Execute()
 {
   std::string pathStr = argStr.empty() ? "." : argStr;
@@ -1291,6 +1358,21 @@ void RELOADCommand::Execute()
   control.Reply(ftp::CommandOkay, os.str());
 }
 
+void REPLICATIONCommand::Execute()
+{
+  auto stats = db::Replicator::Get().Stats();
+  
+  std::ostringstream os;
+  os << "Cache replication: " << stats.entries << " updates in " << stats.batches 
+     << " batches, " << stats.replicated << " refreshed";
+  os << "\nBatch size: " << stats.lastBatch << " last, " << stats.largestBatch << " largest";
+  if (stats.batches > 0)
+    os << ", " << std::fixed << std::setprecision(1) 
+       << static_cast<double>(stats.entries) / stats.batches << " average";
+  os << "\nLag: " << stats.lag << "s last, " << stats.largestLag << "s largest";
+  control.Reply(ftp::CommandOkay, os.str());
+}
+
 void RENUSERCommand::Execute()
 {
   if (!acl::Validate(acl::ValidationType::Username, args[2]))
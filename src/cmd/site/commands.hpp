@@ -29,6 +29,15 @@ public:
 
   void Execute();
 };
+class BANDWIDTHCommand : public Command
+{
+public:
+  BANDWIDTHCommand(ftp::Client& client, const std::string& argStr, const Args& args) :
+    Command(client, client.Control(), client.Data(), argStr, args) { }
+
+  void Execute();
+};
+
 class CHGADMINCommand : public Command
 {
 public:
@@ -82,6 +91,24 @@ public:
   void Execute();
 };
 
+class DIRCACHECommand : public Command
+{
+public:
+  DIRCACHECommand(ftp::Client& client, const std::string& argStr, const Args& args) :
+    Command(client, client.Control(), client.Data(), argStr, args) { }
+
+  void Execute();
+};
+
+class DBPOOLCommand : public Command
+{
+public:
+  DBPOOLCommand(ftp::Client& client, const std::string& argStr, const Args& args) :
+    Command(client, client.Control(), client.Data(), argStr, args) { }
+
+  void Execute();
+};
+
 class DISKFREECommand : public Command
 {
 public:
@@ -255,6 +282,15 @@ public:
   void Execute();
 };
 
+class REPLICATIONCommand : public Command
+{
+public:
+  REPLICATIONCommand(ftp::Client& client, const std::string& argStr, const Args& args) :
+    Command(client, client.Control(), client.Data(), argStr, args) { }
+
+  void Execute();
+};
+
 class RENUSERCommand : public Command
 {
 public:
@@ -201,6 +201,22 @@ Factory::Factory()
                       nullptr,
                       "Syntax: SITE EMULATE <user>",
                       "Become another user by temporarily loading their userfile" }, },
+    { "BANDWIDTH",  { 0,  0,  "bandwidth",
+                      std::make_shared<Creator<BANDWIDTHCommand>>(),
+                      "Syntax: SITE BANDWIDTH",
+                      "Display fair share bandwidth usage" }, },
+    { "DIRCACHE",   { 0,  0,  "dircache",
+                      std::make_shared<Creator<DIRCACHECommand>>(),
+                      "Syntax: SITE DIRCACHE",
+                      "Display directory listing cache statistics" }, },
+    { "DBPOOL",     { 0,  0,  "dbpool",
+                      std::make_shared<Creator<DBPOOLCommand>>(),
+                      "Syntax: SITE DBPOOL",
+                      "Display database connection pool statistics" }, },
+    { "REPLICATION", { 0,  0,  "replication",
+                      std::make_shared<Creator<REPLICATIONCommand>>(),
+                      "Syntax: SITE REPLICATION",
+                      "Display cache replication statistics" }, },
     { "TRAFFIC",    { 0,  0,  "traffic",
                       std::make_shared<Creator<TRAFFICCommand>>(),
                       "Syntax: SITE TRAFFIC",
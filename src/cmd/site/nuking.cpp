@@ -39,6 +39,8 @@
 #include "fs/owner.hpp"
 #include "fs/file.hpp"
 #include "fs/directory.hpp"
+#include "fs/ledger.hpp"
+#include "fs/trash.hpp"
 #include "stats/util.hpp"
 
 namespace cmd { namespace site
@@ -204,63 +206,58 @@ db::nuking::Nuke Nuke(const fs::VirtualPath& path, int multiplier, bool isPercen
     time_t modTime;
     long long totalKBytes;
     std::map<acl::UserID, Nukee> nukees;
+    std::map<acl::UserID, acl::User> users;
     boost::optional<const cfg::Section&> section;
     boost::optional<db::nuking::Nuke> nuke;
     
     void CalculateNukees()
     {
-      using namespace util::path;
-      modTime = Status(real.ToString()).ModTime();
+      modTime = util::path::Status(real.ToString()).ModTime();
       
-      for (const std::string& entry : RecursiveDirContainer(real.ToString()))
+      for (const auto& kv : fs::LedgerTotals(real))
       {
-        if (Basename(entry).front() == '.') continue;
-        
-        Status status(entry);
-        if (!status.IsRegularFile()) continue;
-        
-        auto& nukee = nukees[fs::GetOwner(entry).UID()];
-        long long kBytes = status.Size() / 1024;
-        nukee.kBytes += kBytes;
-        nukee.files++;
-        totalKBytes += kBytes;
+        auto& nukee = nukees[kv.first];
+        nukee.kBytes = kv.second.kBytes;
+        nukee.files = kv.second.files;
+        totalKBytes += kv.second.kBytes;
       }
     }
     
-    void TakeCreditsEmpty(const std::string& sectionName)
+    // every nukee is loaded in a single query rather than one each
+    void LoadUsers()
     {
-      if (!nukees.empty())
+      std::vector<acl::UserID> uids;
+      uids.reserve(nukees.size());
+      for (const auto& kv : nukees)
       {
-        for (auto& kv : nukees)
-        {
-          kv.second.credits = config.NukeStyle().EmptyPenalty();
-          auto user = acl::User::Load(kv.first);
-          if (!user)
-          {
-            logs::Error("Unable to update user with uid %1% after nuke of: %2%", 
-                        kv.first, real);
-          }
-          else
-          {
-            user->DecrSectionCreditsForce(sectionName, kv.second.credits);
-          }
-        }
+        uids.emplace_back(kv.first);
       }
-      else // otherwise we penalise the directory owner
+      
+      for (auto& user : acl::User::GetUsers(uids))
       {
-        auto owner = fs::GetOwner(real);
-        auto& nukee = nukees[owner.UID()];
-        nukee.credits = config.NukeStyle().EmptyPenalty();
-        auto user = acl::User::Load(owner.UID());
-        if (!user)
-        {
-          logs::Error("Unable to update user with uid %1% after nuke of: %2%", 
-                      owner.UID(), real);
-        }
-        else
-        {
-          user->DecrSectionCreditsForce(sectionName, nukee.credits);
-        }
+        acl::UserID uid = user.ID();
+        users.insert(std::make_pair(uid, std::move(user)));
+      }
+    }
+    
+    acl::User* LoadedUser(acl::UserID uid)
+    {
+      auto it = users.find(uid);
+      if (it == users.end())
+      {
+        logs::Error("Unable to update user with uid %1% after nuke of: %2%", uid, real);
+        return nullptr;
+      }
+      return &it->second;
+    }
+    
+    void TakeCreditsEmpty(const std::string& sectionName)
+    {
+      for (auto& kv : nukees)
+      {
+        kv.second.credits = config.NukeStyle().EmptyPenalty();
+        auto user = LoadedUser(kv.first);
+        if (user) user->DecrSectionCreditsForce(sectionName, kv.second.credits);
       }
     }
     
@@ -269,7 +266,9 @@ db::nuking::Nuke Nuke(const fs::VirtualPath& path, int multiplier, bool isPercen
       double percent = multiplier / 100.0;
       for (auto& kv : nukees)
       {
-        auto user = acl::User::Load(kv.first);
+        auto user = LoadedUser(kv.first);
+        if (!user) continue;
+        
         if (isPercent)
         {
           kv.second.credits = user->SectionCredits(sectionName) * percent;
@@ -285,15 +284,7 @@ db::nuking::Nuke Nuke(const fs::VirtualPath& path, int multiplier, bool isPercen
                                 kv.second.kBytes * (multiplier - 1);
         }
 
-        if (!user)
-        {
-          logs::Error("Unable to update user with uid %1% after nuke of: %2%", 
-                      kv.first, real);
-        }
-        else
-        {
-          user->DecrSectionCreditsForce(sectionName, kv.second.credits);
-        }
+        user->DecrSectionCreditsForce(sectionName, kv.second.credits);
       }
     }
     
@@ -301,7 +292,13 @@ db::nuking::Nuke Nuke(const fs::VirtualPath& path, int multiplier, bool isPercen
     {
       if (multiplier == 0) return;
       std::string sectionName(section && section->SeparateCredits() ? section->Name() : "");
-      if (totalKBytes < config.NukeStyle().EmptyKBytes())
+      bool empty = totalKBytes < config.NukeStyle().EmptyKBytes();
+      
+      // with no uploaders we penalise the directory owner
+      if (empty && nukees.empty()) nukees[fs::GetOwner(real).UID()];
+      
+      LoadUsers();
+      if (empty)
       {
         TakeCreditsEmpty(sectionName);
       }
@@ -313,15 +310,19 @@ db::nuking::Nuke Nuke(const fs::VirtualPath& path, int multiplier, bool isPercen
     
     void TakeStats()
     {
-      std::string sectionName(section ? section->Name() : "");
+      std::vector<db::stats::UploadAdjustment> adjustments;
       for (const auto& kv : nukees)
       {
         if (kv.second.kBytes > 0)
         {
-          db::stats::UploadDecr(kv.first, kv.second.kBytes, modTime, 
-                                sectionName, kv.second.files);
+          adjustments.emplace_back(kv.first, kv.second.kBytes, kv.second.files, modTime);
         }
       }
+      
+      if (!adjustments.empty())
+      {
+        db::stats::UploadDecr(adjustments, section ? section->Name() : "");
+      }
     }
     
     boost::optional<db::nuking::Nuke> LookupUnnuke()
@@ -418,6 +419,8 @@ db::nuking::Nuke Nuke(const fs::VirtualPath& path, int multiplier, bool isPercen
     {
       assert(nuke);
       auto action = config.NukeStyle().GetAction();
+      if (action == cfg::NukeStyle::DeleteAll && fs::Trash(real)) return;
+      
       if (action != cfg::NukeStyle::Keep)
       {
         DeleteContents();
@@ -548,31 +551,49 @@ db::nuking::Nuke Unnuke(const fs::VirtualPath& path, const std::string& reason,
     void RestoreCredits()
     {
       std::string sectionName(SeparateCredits() ? nuke.Section() : "");
+      std::vector<acl::UserID> uids;
       for (const auto& nukee : nuke.Nukees())
       {
-        auto user = acl::User::Load(nukee.UID());
-        if (!user)
+        uids.emplace_back(nukee.UID());
+      }
+      
+      std::map<acl::UserID, acl::User> users;
+      for (auto& user : acl::User::GetUsers(uids))
+      {
+        acl::UserID uid = user.ID();
+        users.insert(std::make_pair(uid, std::move(user)));
+      }
+      
+      for (const auto& nukee : nuke.Nukees())
+      {
+        auto it = users.find(nukee.UID());
+        if (it == users.end())
         {
           logs::Error("Unable to update user with uid %1% after unnuke of: %2%", 
                       nukee.UID(), real);
         }
         else
         {
-          user->IncrSectionCredits(sectionName, nukee.Credits());
+          it->second.IncrSectionCredits(sectionName, nukee.Credits());
         }
       }
     }
     
     void RestoreStats()
     {
+      std::vector<db::stats::UploadAdjustment> adjustments;
       for (const auto& nukee : nuke.Nukees())
       {
         if (nukee.KBytes() > 0 || nukee.Files() > 0)
         {
-          db::stats::UploadIncr(nukee.UID(), nukee.KBytes(), nuke.ModTime(), 
-                                nuke.Section(), nuke.Files());
+          adjustments.emplace_back(nukee.UID(), nukee.KBytes(), nukee.Files(), nuke.ModTime());
         }
       }
+      
+      if (!adjustments.empty())
+      {
+        db::stats::UploadIncr(adjustments, nuke.Section());
+      }
     }
 
     void Rename()
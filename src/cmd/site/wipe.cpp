@@ -29,10 +29,71 @@
 #include "logs/logs.hpp"
 #include "util/string.hpp"
 #include "acl/user.hpp"
+#include "fs/trash.hpp"
+#include "util/path/dircontainer.hpp"
 
 namespace cmd { namespace site
 {
 
+// whether every entry below path would be removed by Process without a
+// failure, checked up front so the whole tree can go to the trash at once
+bool WIPECommand::Wipeable(const fs::VirtualPath& path, int& dirs, int& files, 
+                           std::vector<std::string>& indexed)
+{
+  const cfg::Config& config = cfg::Get();
+  std::string real(fs::MakeReal(path).ToString());
+  for (const std::string& name : util::path::DirContainer(real))
+  {
+    util::path::Status status(real + '/' + name);
+    // links to directories are followed by Process and can't be trashed
+    if (status.IsSymLink() && status.IsDirectory()) return false;
+    
+    fs::VirtualPath entryPath(path / name);
+    if (!acl::path::EntryAllowed<acl::path::View>(client.User(), path, fs::Path(name), 
+                                                 status.IsDirectory()))
+      return false;
+
+    if (status.IsDirectory())
+    {
+      if (!Wipeable(entryPath, dirs, files, indexed)) return false;
+    }
+    else
+    {
+      if (!acl::path::FileAllowed<acl::path::Delete>(client.User(), entryPath)) return false;
+      ++files;
+    }
+  }
+  
+  if (!acl::path::DirAllowed<acl::path::Delete>(client.User(), path)) return false;
+  if (config.IsIndexed(path.ToString())) indexed.emplace_back(path.ToString());
+  ++dirs;
+  return true;
+}
+
+// moves the directory to the trash and leaves the deleting to the reaper,
+// returns false if it has to be wiped entry by entry instead
+bool WIPECommand::Trash(const fs::VirtualPath& path)
+{
+  int dirs = 0;
+  int files = 0;
+  std::vector<std::string> indexed;
+  
+  try
+  {
+    if (!Wipeable(path, dirs, files, indexed)) return false;
+  }
+  catch (const util::SystemError&)
+  {
+    return false;
+  }
+
+  if (!fs::Trash(fs::MakeReal(path))) return false;
+  
+  this->dirs += dirs;
+  this->files += files;
+  unindexed.insert(unindexed.end(), indexed.begin(), indexed.end());
+  return true;
+}
 
 void WIPECommand::Process(const fs::VirtualPath& pathmask)
 {
@@ -46,6 +107,8 @@ void WIPECommand::Process(const fs::VirtualPath& pathmask)
         util::path::Status status(fs::MakeReal(entryPath).ToString());
         if (status.IsDirectory())
         {
+          if (!status.IsSymLink() && Trash(entryPath)) continue;
+          
           Process(entryPath / "*");
           util::Error e = fs::RemoveDirectory(client.User(), entryPath);
           if (!e)
@@ -124,6 +187,7 @@ void WIPECommand::Execute()
 
   auto path = fs::PathFromUser(patharg);
   Process(path);
+  db::index::Delete(unindexed);
   
   std::ostringstream os;
   os << "WIPE finished (okay on: "
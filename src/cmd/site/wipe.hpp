@@ -16,6 +16,8 @@
 #ifndef __CMD_SITE_WIPE_HPP
 #define __CMD_SITE_WIPE_HPP
 
+#include <string>
+#include <vector>
 #include "cmd/command.hpp"
 
 namespace cmd { namespace site
@@ -28,7 +30,11 @@ class WIPECommand : public Command
   int dirs;
   int files;
   int failed;
+  std::vector<std::string> unindexed;
   
+  bool Wipeable(const fs::VirtualPath& path, int& dirs, int& files, 
+                std::vector<std::string>& indexed);
+  bool Trash(const fs::VirtualPath& path);
   void Process(const fs::VirtualPath& pathmask);
   void ParseArgs();
   
@@ -41,81 +41,99 @@ std::string SimplifyJavascript(const std::string& javascript)
 
 }
 
-boost::once_flag Connection::once = BOOST_ONCE_INIT;
-
-void Connection::AuthenticateHook::onCreate(mongo::DBClientBase* conn)
-{
-  const auto& dbConfig = cfg::Get().Database();
-  if (dbConfig.NeedAuth())
-  {
-    std::string errmsg;
-    if (!conn->auth(dbConfig.Name(), dbConfig.Login(), dbConfig.Password(), errmsg))
-    {
-      throw db::DBError(errmsg);
-    }
-  }
-}
-
 Connection::Connection(ConnectionMode mode) :
   mode(mode),
-  database(cfg::Get().Database().Name())
+  database(cfg::Get().Database().Name()),
+  pipelined(false),
+  unacknowledged(false)
 {
   Create();
 }
 
-void Connection::Create()
+Connection::~Connection()
 {
-  boost::call_once(&InitialiseMongo, once);  
-  boost::this_thread::disable_interruption noInterrupt;
+  if (!slot) return;
   
-  try
+  if (unacknowledged)
   {
     try
     {
-      std::string errmsg;
-      auto connStr = mongo::ConnectionString::parse(cfg::Get().Database().URL(), errmsg);
-      scopedConn.reset(new mongo::ScopedDbConnection(connStr));
-      (void) errmsg;
+      Acknowledge();
     }
-    catch (const mongo::DBException& e)
+    catch (const DBError&)
     {
-      LogException("Connect", e);
-      if (mode == ConnectionMode::Safe)
-        throw DBError("Unable to connect to database");
+      // already logged
     }
   }
-  catch (const db::DBError& e)
+  
+  ConnectionPool::Get().Release(slot);
+}
+
+void Connection::Create()
+{
+  boost::this_thread::disable_interruption noInterrupt;
+  
+  try
+  {
+    slot = ConnectionPool::Get().Acquire();
+  }
+  catch (const mongo::DBException& e)
   {
     LogException("Connect", e);
     if (mode == ConnectionMode::Safe)
-      throw DBError("Unable to authenticate with database");
+      throw DBError("Unable to connect to database");
+  }
+  catch (const DBError& e)
+  {
+    LogException("Connect", e);
+    if (mode == ConnectionMode::Safe) throw;
   }
   
-  if (scopedConn && mode == ConnectionMode::Fast)
-    scopedConn->conn().setWriteConcern(mongo::W_NONE);
+  // connections are shared between modes
+  if (slot)
+  {
+    slot->Conn().setWriteConcern(mode == ConnectionMode::Fast ? 
+                                 mongo::W_NONE : mongo::W_NORMAL);
+  }
 }
 
-void Connection::InitialiseMongo()
+bool Connection::Acknowledge()
 {
-    /* TODO ...
-  FILE* nullLog = fopen("/dev/null", "w");
-  if (nullLog != nullptr) mongo::Logstream::setLogFile(nullLog);
-    */
-    
-  mongo::pool.addHook(new AuthenticateHook());
+  if (!slot || !unacknowledged) return true;
+  unacknowledged = false;
+  
+  boost::this_thread::disable_interruption noInterrupt;
+  
+  try
+  {
+    auto err = GetLastError();
+    if (!err.Okay())
+    {
+      LogLastError("Pipelined writes", err);
+      if (mode == ConnectionMode::Safe) throw DBWriteError();
+      return false;
+    }
+    return true;
+  }
+  catch (const mongo::DBException& e)
+  {
+    LogException("Pipelined writes", e);
+    if (mode == ConnectionMode::Safe) throw DBWriteError();
+  }
+  return false;
 }
 
 int Connection::Update(const std::string& collection, const mongo::Query& query, 
       const mongo::BSONObj& obj, bool upsert)
 {
-  if (scopedConn)
+  if (slot)
   {
     boost::this_thread::disable_interruption noInterrupt;
     
     try
     {
-      scopedConn->conn().update(Namespace(collection), query, obj, upsert);
-      if (mode != ConnectionMode::Fast)
+      slot->Conn().update(Namespace(collection), query, obj, upsert);
+      if (AcknowledgeEach())
       {
         auto err = GetLastError();
         if (!err.Okay())
@@ -140,14 +158,14 @@ int Connection::Update(const std::string& collection, const mongo::Query& query,
 
 int Connection::Remove(const std::string& collection, const mongo::Query& query)
 {
-  if (scopedConn)
+  if (slot)
   {
     boost::this_thread::disable_interruption noInterrupt;
     
     try
     {
-      scopedConn->conn().remove(Namespace(collection), query);
-      if (mode != ConnectionMode::Fast)
+      slot->Conn().remove(Namespace(collection), query);
+      if (AcknowledgeEach())
       {
         auto err = GetLastError();
         if (!err.Okay())
@@ -174,29 +192,20 @@ std::vector<mongo::BSONObj> Connection::Query(
       const mongo::BSONObj* fieldsToReturn)
 {
   std::vector<mongo::BSONObj> results;
-  if (scopedConn)
+  if (slot)
   {
     boost::this_thread::disable_interruption noInterrupt;
     
     try
     {
-      auto cursor = scopedConn->conn().query(Namespace(collection), 
+      auto cursor = slot->Conn().query(Namespace(collection), 
             query, nToReturn, nToSkip, fieldsToReturn);
       if (!cursor.get()) throw DBReadError();
       
-      if (mode != ConnectionMode::Fast)
-      {
-        auto err = GetLastError();
-        if (!err.Okay())
-        {
-          LogLastError("Query", err, collection, query, nToReturn, nToSkip, fieldsToReturn);
-          if (mode == ConnectionMode::Safe) throw DBReadError();
-        }
-      }
-      
+      // a failed query is reported in its reply, not by getLastError
       while (cursor->more())
       {
-        results.emplace_back(cursor->next().copy());
+        results.emplace_back(cursor->nextSafe().copy());
       }
     }
     catch (const mongo::DBException& e)
@@ -212,14 +221,14 @@ std::vector<mongo::BSONObj> Connection::Query(
 void Connection::EnsureIndex(const std::string& collection, 
       const mongo::BSONObj& keys, bool unique)
 {
-  if (!scopedConn) return;
+  if (!slot) return;
   
   try
   {
     boost::this_thread::disable_interruption noInterrupt;
 
-    scopedConn->conn().ensureIndex(Namespace(collection), keys, unique);
-    if (mode != ConnectionMode::Fast)
+    slot->Conn().ensureIndex(Namespace(collection), keys, unique);
+    if (AcknowledgeEach())
     {
       auto err = GetLastError();
       if (!err.Okay())
@@ -240,23 +249,13 @@ void Connection::EnsureIndex(const std::string& collection,
 long long Connection::Count(const std::string& collection, const mongo::BSONObj& query)
 {
   long long count = -1;
-  if (scopedConn) 
+  if (slot) 
   {
     boost::this_thread::disable_interruption noInterrupt;
 
     try
     {
-      count = scopedConn->conn().count(Namespace(collection), query);
-      if (mode != ConnectionMode::Fast)
-      {
-        auto err = GetLastError();
-        if (!err.Okay())
-        {
-          LogLastError("Count", err, collection, query);
-          if (mode == ConnectionMode::Safe) throw DBReadError();
-          count = -1;
-        }
-      }
+      count = slot->Conn().count(Namespace(collection), query);
     }
     catch (const mongo::DBException& e)
     {
@@ -272,22 +271,13 @@ long long Connection::Count(const std::string& collection, const mongo::BSONObj&
 bool Connection::RunCommand(const mongo::BSONObj& command, mongo::BSONObj& info, int options)
 {
   bool ret = false;
-  if (scopedConn)
+  if (slot)
   {
     boost::this_thread::disable_interruption noInterrupt;
     
     try
     {
-      ret = scopedConn->conn().runCommand(database, command, info, options);
-      if (mode != ConnectionMode::Fast)
-      {
-        auto err = GetLastError();
-        if (!err.Okay())
-        {
-          LogLastError("Run command", err, command, "output ref", options);
-          if (mode == ConnectionMode::Safe) throw DBError();
-        }
-      }
+      ret = slot->Conn().runCommand(database, command, info, options);
     }
     catch (const mongo::DBException& e)
     {
@@ -303,13 +293,13 @@ bool Connection::Eval(const std::string& javascript, mongo::BSONObj& info, mongo
       mongo::BSONObj* args)
 {
   bool ret = false;
-  if (scopedConn)
+  if (slot)
   {
     boost::this_thread::disable_interruption noInterrupt;
 
     try
     {
-      ret = scopedConn->conn().eval(database, javascript, info, retval, args);
+      ret = slot->Conn().eval(database, javascript, info, retval, args);
       if (!ret && mode != ConnectionMode::Fast)
       {
         auto err = GetLastError();
@@ -330,7 +320,7 @@ bool Connection::Eval(const std::string& javascript, mongo::BSONObj& info, mongo
 int Connection::InsertAutoIncrement(const std::string& collection, 
       const mongo::BSONObj& obj, const std::string& autoIncField)
 {
-  if (!scopedConn) return -1;
+  if (!slot) return -1;
 
   std::string ns = Namespace(collection);
   while (true)
@@ -352,14 +342,14 @@ int Connection::InsertAutoIncrement(const std::string& collection,
     {
       boost::this_thread::disable_interruption noInterrupt;
       
-      scopedConn->conn().insert(ns, bab.obj());
+      slot->Conn().insert(ns, bab.obj());
       auto err = GetLastError();
       if (!err.Okay())
       {
         if (err["code"].Number() == 11000)
         {
           auto fields = BSON(autoIncField << 1);
-          auto cursor = scopedConn->conn().query(ns, QUERY(autoIncField << id), 1, 0, &fields);
+          auto cursor = slot->Conn().query(ns, QUERY(autoIncField << id), 1, 0, &fields);
           if (cursor.get() && cursor->more())
             continue;
           else
@@ -383,7 +373,7 @@ int Connection::InsertAutoIncrement(const std::string& collection,
 
 int Connection::NextAutoIncrement(const std::string& collection, const std::string& autoIncField)
 {
-  if (!scopedConn) return -1;
+  if (!slot) return -1;
   
   static const char* javascript =
     "function autoIncInsert(colName, field) {\n"
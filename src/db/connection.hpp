@@ -17,7 +17,6 @@
 #define __DB_CONNECTION_HPP
 
 #include <mongo/client/dbclient.h>
-#include <boost/thread/once.hpp>
 #include <boost/thread/thread.hpp>
 #include <boost/optional.hpp>
 #include "util/string.hpp"
@@ -29,6 +28,7 @@
 #include "logs/logs.hpp"
 #include "db/serialization.hpp"
 #include "db/error.hpp"
+#include "db/connectionpool.hpp"
 
 namespace db
 {
@@ -42,16 +42,11 @@ enum class ConnectionMode
 
 class Connection
 {
-  struct AuthenticateHook : mongo::DBConnectionHook
-  {
-    void onCreate(mongo::DBClientBase* conn);
-    void onHandedOut(mongo::DBClientBase*) { }
-    void onDestroy(mongo::DBClientBase*) { }
-  };
-
-  std::unique_ptr<mongo::ScopedDbConnection> scopedConn;
+  std::shared_ptr<ConnectionPool::Slot> slot;
   ConnectionMode mode;
   std::string database;
+  bool pipelined;
+  bool unacknowledged;
   
   void Create();
   
@@ -63,23 +58,35 @@ class Connection
     return ns;
   }
   
-  static boost::once_flag once;
-  
-  static void InitialiseMongo();
+  // whether a write needs its own acknowledgement now
+  bool AcknowledgeEach()
+  {
+    if (mode == ConnectionMode::Fast) return false;
+    if (pipelined)
+    {
+      unacknowledged = true;
+      return false;
+    }
+    return true;
+  }
   
 public:
   Connection(ConnectionMode mode);
-  ~Connection()
-  {
-    if (scopedConn) scopedConn->done();
-  }
+  ~Connection();
   
-  mongo::DBClientBase& BaseConn() { return scopedConn->conn(); }
+  mongo::DBClientBase& BaseConn() { return slot->Conn(); }
   
   LastError GetLastError()
   {
-    return LastError(scopedConn->conn().getLastErrorDetailed());
+    return LastError(slot->Conn().getLastErrorDetailed());
   }
+  
+  // writes from here on are sent without waiting for each to be
+  // acknowledged, Acknowledge or the destructor then waits once for all
+  // of them. the server only reports the error of the last write, so
+  // only pipeline writes where that is enough
+  void Pipeline() { pipelined = true; }
+  bool Acknowledge();
 
   int Update(const std::string& collection, const mongo::Query& query, 
           const mongo::BSONObj& obj, bool upsert = false);
@@ -116,14 +123,14 @@ public:
   template <typename BSONObject>
   void Insert(const std::string& collection, const BSONObject& obj)
   {
-    if (!scopedConn) return;
+    if (!slot) return;
     
     boost::this_thread::disable_interruption noInterrupt;
     
     try
     {
-      scopedConn->conn().insert(Namespace(collection), obj);
-      if (mode != ConnectionMode::Fast)
+      slot->Conn().insert(Namespace(collection), obj);
+      if (AcknowledgeEach())
       {
         auto err = GetLastError();
         if (!err.Okay())
@@ -143,7 +150,7 @@ public:
   template <typename T>
   void InsertMulti(const std::string& collection, const std::vector<T>& objects)
   {
-    if (!scopedConn || objects.empty()) return;
+    if (!slot || objects.empty()) return;
     
     try
     {
@@ -165,7 +172,7 @@ public:
   template <typename T>
   void InsertOne(const std::string& collection, const T& obj)
   {
-    if (!scopedConn) return;
+    if (!slot) return;
     try
     {
       Insert(collection, Serialize(obj));
@@ -189,7 +196,7 @@ public:
                             const mongo::BSONObj* fieldsToReturn = nullptr)
   {
     std::vector<T> results;
-    if (!scopedConn) return results;
+    if (!slot) return results;
     
     auto objects = Query(collection, query, nToReturn, nToSkip, fieldsToReturn);
     try
@@ -213,7 +220,7 @@ public:
   boost::optional<T> QueryOne(const std::string& collection, const mongo::Query& query, 
                               const mongo::BSONObj* fieldsToReturn = nullptr)
   {
-    if (scopedConn)
+    if (slot)
     {
       auto results = QueryMulti<T>(collection, query, 1, 0, fieldsToReturn);
       if (!results.empty()) return boost::optional<T>(results.front());
@@ -235,7 +242,7 @@ public:
   int InsertAutoIncrement(const std::string& collection, const T& obj, 
         const std::string& autoIncField)
   {
-    if (scopedConn)
+    if (slot)
     {
       try
       {
@@ -0,0 +1,211 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <chrono>
+#include <mongo/client/dbclient.h>
+#include "db/connectionpool.hpp"
+#include "db/error.hpp"
+#include "cfg/get.hpp"
+
+namespace db
+{
+
+std::unique_ptr<ConnectionPool> ConnectionPool::instance;
+
+ConnectionPool::Slot::Slot(mongo::DBClientBase* conn) :
+  conn(conn),
+  inUse(true)
+{
+}
+
+ConnectionPool::Slot::~Slot()
+{
+}
+
+ConnectionPool::ConnectionPool() :
+  configVersion(-1),
+  maximum(0),
+  opening(0),
+  stats()
+{
+}
+
+mongo::DBClientBase* ConnectionPool::Open()
+{
+  const auto& dbConfig = cfg::Get().Database();
+  std::string errmsg;
+  auto connStr = mongo::ConnectionString::parse(dbConfig.URL(), errmsg);
+  if (!connStr.isValid()) throw DBError("Unable to connect to database: " + errmsg);
+  
+  std::unique_ptr<mongo::DBClientBase> conn(connStr.connect(errmsg));
+  if (!conn) throw DBError("Unable to connect to database: " + errmsg);
+  
+  if (dbConfig.NeedAuth())
+  {
+    if (!conn->auth(dbConfig.Name(), dbConfig.Login(), dbConfig.Password(), errmsg))
+    {
+      throw DBError("Unable to authenticate with database: " + errmsg);
+    }
+  }
+  
+  return conn.release();
+}
+
+void ConnectionPool::Discard(const std::shared_ptr<Slot>& slot)
+{
+  auto it = std::find(slots.begin(), slots.end(), slot);
+  if (it != slots.end()) slots.erase(it);
+}
+
+std::shared_ptr<ConnectionPool::Slot> ConnectionPool::Take(boost::unique_lock<boost::mutex>& lock,
+                                                           bool nested)
+{
+  while (true)
+  {
+    std::shared_ptr<Slot> idle;
+    for (auto& slot : slots)
+    {
+      if (slot->inUse) continue;
+      if (slot->owner == boost::thread::id())
+      {
+        idle = slot;
+        break;
+      }
+      
+      if (!idle) idle = slot;
+    }
+    
+    // a connection no thread is holding on to is preferred, then a
+    // new one if there's room, and only then another thread's
+    if (idle && idle->owner == boost::thread::id()) return idle;
+    if (static_cast<int>(slots.size()) + opening < maximum) return nullptr;
+    if (idle) return idle;
+    
+    // a thread already holding a connection must not wait for another,
+    // if every thread at the limit did that none would ever be released.
+    // it goes over the limit instead and the extra is closed on release
+    if (nested)
+    {
+      ++stats.overflows;
+      return nullptr;
+    }
+    
+    ++stats.waits;
+    auto start = std::chrono::steady_clock::now();
+    released.wait(lock);
+    stats.waitMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(
+                                std::chrono::steady_clock::now() - start).count();
+  }
+}
+
+std::shared_ptr<ConnectionPool::Slot> ConnectionPool::Acquire()
+{
+  const cfg::Config& config = cfg::Get();
+  boost::thread::id self = boost::this_thread::get_id();
+  
+  boost::unique_lock<boost::mutex> lock(mutex);
+  ++stats.checkouts;
+  
+  if (config.Version() != configVersion)
+  {
+    configVersion = config.Version();
+    maximum = config.Database().PoolSize();
+  }
+  
+  std::shared_ptr<Slot> pinned;
+  if (affinity.get()) pinned = affinity->lock();
+  if (pinned && pinned->owner == self && !pinned->inUse)
+  {
+    pinned->inUse = true;
+    ++stats.affine;
+    return pinned;
+  }
+  
+  bool nested = pinned && pinned->owner == self && pinned->inUse;
+  auto slot = Take(lock, nested);
+  if (slot)
+  {
+    slot->inUse = true;
+  }
+  else
+  {
+    ++opening;
+    lock.unlock();
+    
+    mongo::DBClientBase* conn;
+    try
+    {
+      conn = Open();
+    }
+    catch (...)
+    {
+      lock.lock();
+      --opening;
+      ++stats.errors;
+      released.notify_one();
+      throw;
+    }
+    
+    lock.lock();
+    --opening;
+    slot.reset(new Slot(conn));
+    slots.emplace_back(slot);
+  }
+  
+  // a nested checkout leaves the thread pinned to the outer connection
+  if (!pinned || pinned->owner != self)
+  {
+    slot->owner = self;
+    affinity.reset(new std::weak_ptr<Slot>(slot));
+  }
+  else
+  {
+    slot->owner = boost::thread::id();
+  }
+  
+  return slot;
+}
+
+void ConnectionPool::Release(const std::shared_ptr<Slot>& slot)
+{
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    slot->inUse = false;
+    if (slot->conn->isFailed())
+    {
+      ++stats.errors;
+      Discard(slot);
+    }
+    else if (static_cast<int>(slots.size()) > maximum)
+    {
+      Discard(slot);
+    }
+  }
+  released.notify_one();
+}
+
+ConnectionPoolStats ConnectionPool::Stats()
+{
+  boost::lock_guard<boost::mutex> lock(mutex);
+  ConnectionPoolStats stats(this->stats);
+  stats.size = slots.size();
+  stats.inUse = std::count_if(slots.begin(), slots.end(), 
+                  [](const std::shared_ptr<Slot>& slot) { return slot->inUse; });
+  stats.maximum = maximum;
+  return stats;
+}
+
+} /* db namespace */
@@ -0,0 +1,108 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __DB_CONNECTIONPOOL_HPP
+#define __DB_CONNECTIONPOOL_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/tss.hpp>
+
+namespace mongo
+{
+class DBClientBase;
+}
+
+namespace db
+{
+
+struct ConnectionPoolStats
+{
+  int size;
+  int inUse;
+  int maximum;
+  unsigned long long checkouts;
+  unsigned long long affine;            // served by the thread's own connection
+  unsigned long long waits;
+  unsigned long long waitMicroseconds;
+  unsigned long long overflows;         // nested checkouts opened over the limit
+  unsigned long long errors;            // failed connects and broken connections dropped
+};
+
+// bounded set of database connections shared by all threads
+//
+// a thread keeps the connection it last checked out, so consecutive calls
+// from one thread skip the free list and their requests go out in order
+// on the same socket. when the pool is at its limit an idle connection
+// held by another thread is taken over, and only if every connection is
+// in use does a checkout wait, the limit follows config reloads. a thread
+// that already holds a connection never waits, it goes over the limit
+class ConnectionPool
+{
+public:
+  class Slot
+  {
+    std::unique_ptr<mongo::DBClientBase> conn;
+    boost::thread::id owner;
+    bool inUse;
+    
+    Slot(mongo::DBClientBase* conn);
+    
+    friend class ConnectionPool;
+    
+  public:
+    ~Slot();
+    mongo::DBClientBase& Conn() { return *conn; }
+  };
+  
+private:
+  boost::mutex mutex;
+  boost::condition_variable released;
+  std::vector<std::shared_ptr<Slot>> slots;
+  boost::thread_specific_ptr<std::weak_ptr<Slot>> affinity;
+  int configVersion;
+  int maximum;
+  int opening;
+  ConnectionPoolStats stats;
+  
+  static std::unique_ptr<ConnectionPool> instance;
+  
+  ConnectionPool();
+  
+  std::shared_ptr<Slot> Take(boost::unique_lock<boost::mutex>& lock, bool nested);
+  void Discard(const std::shared_ptr<Slot>& slot);
+  static mongo::DBClientBase* Open();
+  
+public:
+  // throws mongo::DBException or DBError if a new connection can't be made
+  std::shared_ptr<Slot> Acquire();
+  void Release(const std::shared_ptr<Slot>& slot);
+  
+  ConnectionPoolStats Stats();
+  
+  static ConnectionPool& Get()
+  {
+    if (!instance) instance.reset(new ConnectionPool());
+    return *instance;
+  }
+};
+
+} /* db namespace */
+
+#endif
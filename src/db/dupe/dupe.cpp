@@ -17,6 +17,7 @@
 #include <future>
 #include "db/dupe/dupe.hpp"
 #include "db/connection.hpp"
+#include "db/writebehind.hpp"
 #include "db/serialization.hpp"
 #include "util/misc.hpp"
 
@@ -45,10 +46,9 @@ namespace dupe
 
 void Add(const std::string& directory, const std::string& section)
 {
-  FastConnection conn;
-  conn.Insert("dupe", BSON("directory" << directory << 
-                           "section" << section <<
-                           "nuked" << false));
+  WriteBehind::Get().Insert("dupe", BSON("directory" << directory << 
+                                         "section" << section <<
+                                         "nuked" << false));
 }
 
 std::vector<DupeResult> Search(const std::vector<std::string>& terms, int limit)
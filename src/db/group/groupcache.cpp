@@ -13,12 +13,14 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <unordered_set>
 #include "db/group/groupcache.hpp"
 #include "db/connection.hpp"
 #include "util/string.hpp"
 #include "db/group/group.hpp"
 #include "acl/groupdata.hpp"
 #include "db/group/serialization.hpp"
+#include "acl/decisioncache.hpp"
 
 namespace db
 {
@@ -40,49 +42,68 @@ acl::GroupID GroupCache::NameToGID(const std::string& name)
   return it->second;
 }
 
-bool GroupCache::Replicate(const mongo::BSONElement& id)
+bool GroupCache::Replicate(const std::vector<int>& ids)
 {
-  if (id.type() != 16) return true;
-  acl::GroupID gid = id.Int();
-
+  std::vector<mongo::BSONObj> results;
   try
   {
-    SafeConnection conn;  
+    mongo::BSONArrayBuilder bab;
+    for (acl::GroupID gid : ids)
+    {
+      bab.append(gid);
+    }
+    
+    SafeConnection conn;
     auto fields = BSON("gid" << 1 << "name" << 1);
-    auto data = conn.QueryOne<GroupPair>("groups", QUERY("gid" << gid), &fields);
-    if (data)
+    results = conn.Query("groups", QUERY("gid" << BSON("$in" << bab.arr())), 0, 0, &fields);
+  }
+  catch (const DBError&)
+  {
+    return false;
+  }
+  
+  std::lock(namesMutex, gidsMutex);
+  std::lock_guard<std::mutex> namesLock(namesMutex, std::adopt_lock);
+  std::lock_guard<std::mutex> gidsLock(gidsMutex, std::adopt_lock);
+  
+  // groups found, refresh cached data
+  std::unordered_set<acl::GroupID> found;
+  for (const auto& obj : results)
+  {
+    GroupPair data;
+    try
     {
-      // group found, refresh cached data
-      {
-        std::lock_guard<std::mutex> lock(gidsMutex);
-        gids[data->name] = data->gid;
-      }
-      
-      {
-        std::lock_guard<std::mutex> lock(namesMutex);
-        names[data->gid] = data->name;
-      }
+      data = Unserialize<GroupPair>(obj);
     }
-    else
+    catch (const mongo::DBException& e)
     {
-      // group not found, must be deleted, remove from cache
-      std::lock(gidsMutex, namesMutex);
-      std::lock_guard<std::mutex> gidsLock(gidsMutex, std::adopt_lock);
-      std::lock_guard<std::mutex> namesLock(namesMutex, std::adopt_lock);
-      
-      auto it = names.find(gid);
-      if (it != names.end())
-      {
-        gids.erase(it->second);
-        names.erase(it);
-      }
+      LogException("Unserialize group", e, obj);
+      continue;
     }
+    
+    auto it = names.find(data.gid);
+    if (it != names.end() && it->second != data.name) gids.erase(it->second);
+    
+    gids[data.name] = data.gid;
+    names[data.gid] = data.name;
+    found.insert(data.gid);
   }
-  catch (const DBError&)
+  
+  // groups not found, must be deleted, remove from cache
+  for (acl::GroupID gid : ids)
   {
-    return false;
+    if (found.find(gid) != found.end()) continue;
+    
+    auto it = names.find(gid);
+    if (it != names.end())
+    {
+      gids.erase(it->second);
+      names.erase(it);
+    }
   }
   
+  // path decisions made with the old names
+  acl::path::DecisionCache::Invalidate();
   return true;
 }
 
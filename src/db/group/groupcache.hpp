@@ -23,11 +23,6 @@
 #include "db/replicable.hpp"
 #include "db/group/groupcachebase.hpp"
 
-namespace mongo
-{
-class BSONElement;
-}
-
 namespace db
 {
 
@@ -46,7 +41,7 @@ public:
   std::string GIDToName(acl::GroupID gid);
   acl::GroupID NameToGID(const std::string& name);
 
-  bool Replicate(const mongo::BSONElement& id);
+  bool Replicate(const std::vector<int>& ids);
   bool Populate();
 };
 
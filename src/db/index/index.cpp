@@ -18,6 +18,7 @@
 #include "db/index/index.hpp"
 #include "util/misc.hpp"
 #include "db/connection.hpp"
+#include "db/writebehind.hpp"
 
 namespace db
 {
@@ -37,16 +38,31 @@ namespace index
 
 void Add(const std::string& path, const std::string& section)
 {
-  FastConnection conn;
-  conn.Insert("index", BSON("path" << path << "section" << section));
+  WriteBehind::Get().Insert("index", BSON("path" << path << "section" << section));
 }
 
 void Delete(const std::string& path)
 {
+  WriteBehind::Get().Sync("index");
   NoErrorConnection conn;
   conn.Remove("index", QUERY("path" << path));
 }
 
+void Delete(const std::vector<std::string>& paths)
+{
+  if (paths.empty()) return;
+  
+  mongo::BSONArrayBuilder bab;
+  for (const std::string& path : paths)
+  {
+    bab.append(path);
+  }
+  
+  WriteBehind::Get().Sync("index");
+  NoErrorConnection conn;
+  conn.Remove("index", QUERY("path" << BSON("$in" << bab.arr())));
+}
+
 std::vector<SearchResult> Search(const std::vector<std::string>& terms, int limit)
 {
   mongo::BSONObjBuilder bob;
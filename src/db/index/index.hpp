@@ -25,6 +25,7 @@ namespace db { namespace index
 
 void Add(const std::string& path, const std::string& section);
 void Delete(const std::string& path);
+void Delete(const std::vector<std::string>& paths);
 
 struct SearchResult
 {
@@ -17,11 +17,7 @@
 #define __DB_REPLICABLE_HPP
 
 #include <string>
-
-namespace mongo
-{
-class BSONElement;
-}
+#include <vector>
 
 namespace db
 {
@@ -48,7 +44,8 @@ public:
   
   virtual ~Replicable() { }
 
-  virtual bool Replicate(const mongo::BSONElement& id) = 0;
+  // refreshes the cached entries for ids, each id appears once
+  virtual bool Replicate(const std::vector<int>& ids) = 0;
   virtual bool Populate() = 0;
   
   const std::string& Collection() const { return collection; }
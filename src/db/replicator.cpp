@@ -13,6 +13,10 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
+#include <ctime>
+#include <map>
+#include <set>
 #include <boost/optional.hpp>
 #include <list>
 #include <csignal>
@@ -60,49 +64,53 @@ public:
     InitialiseLastOID();
   }
   
-  mongo::BSONObj Next()
+  // blocks until there is at least one new entry, then also takes
+  // whatever the cursor already holds, up to limit entries
+  std::vector<mongo::BSONObj> Next(size_t limit)
   {
+    std::vector<mongo::BSONObj> entries;
     while (true)
     {
+      boost::this_thread::interruption_point();
+      
       if (!cursor.get())
       {
         mongo::Query query;
         if (lastOID) query = QUERY("_id" << BSON("$gt" << *lastOID));
 
-        boost::this_thread::interruption_point();
-        
-        {
-          boost::this_thread::disable_interruption noInterrupt;
-          cursor = conn.query(ns, query.sort(BSON("$natural" << 1)), 0, 0, nullptr, 
-                              mongo::QueryOption_CursorTailable | 
-                              mongo::QueryOption_AwaitData);
-        }
-        
-        boost::this_thread::interruption_point();
+        boost::this_thread::disable_interruption noInterrupt;
+        cursor = conn.query(ns, query.sort(BSON("$natural" << 1)), 0, 0, nullptr, 
+                            mongo::QueryOption_CursorTailable | 
+                            mongo::QueryOption_AwaitData);
+        if (!cursor.get()) throw mongo::DBException("cursor error", 0);
+      }
+      
+      bool more;
+      {
+        boost::this_thread::disable_interruption noInterrupt;
+        more = cursor->more();
       }
       
-      while (true)
+      if (!more)
       {
+        // a live cursor has already waited on the server for new data,
+        // a dead one found nothing past the last entry and is requeried
+        if (cursor->isDead())
         {
-          boost::this_thread::disable_interruption noInterrupt;
-          if (!cursor->more())
-          {
-            boost::this_thread::restore_interruption restoreInterrupt(noInterrupt);
-            boost::this_thread::sleep(boost::posix_time::milliseconds(100));
-            if (cursor->isDead())
-            {
-              cursor.reset();
-              break;
-            }
-            
-            continue;
-          }
+          cursor.reset();
+          boost::this_thread::sleep(boost::posix_time::milliseconds(100));
         }
-        
-        auto entry = cursor->next();
-        SetLastOID(entry);
-        return entry;
+        continue;
       }
+      
+      do
+      {
+        entries.emplace_back(cursor->next().getOwned());
+      }
+      while (entries.size() < limit && cursor->moreInCurrentBatch());
+      
+      SetLastOID(entries.back());
+      return entries;
     }
   }
 };
@@ -123,22 +131,59 @@ void Replicator::LogFailed(const std::list<std::shared_ptr<Replicable>>& failed)
   logs::Database(os.str());
 }
 
-void Replicator::Replicate(const mongo::BSONObj& entry)
+void Replicator::Replicate(const std::vector<mongo::BSONObj>& entries)
 {
-  try
+  // a bulk change logs the same ids over and over,
+  // each is only refreshed once per batch
+  std::map<std::string, std::set<int>> changed;
+  for (const auto& entry : entries)
+  {
+    try
+    {
+      auto id = entry["id"];
+      if (id.type() != mongo::NumberInt) continue;
+      changed[entry["collection"].String()].insert(id.Int());
+    }
+    catch (const mongo::DBException& e)
+    {
+      LogException("Replicate unserialize", e, entry);
+    }
+  }
+  
+  size_t replicated = 0;
+  for (const auto& kv : changed)
   {
-    std::string collection = entry["collection"].String();
-    auto id = entry["id"];
+    std::vector<int> ids(kv.second.begin(), kv.second.end());
     for (auto& cache : caches)
     {
-      if (cache->Collection() == collection)
-        cache->Replicate(id);
+      if (cache->Collection() == kv.first && !cache->Replicate(ids))
+      {
+        logs::Database("Error while replicating %1% cache.", cache->Collection());
+      }
     }
+    replicated += ids.size();
+  }
+  
+  long lag = 0;
+  try
+  {
+    mongo::BSONElement oid;
+    if (entries.back().getObjectID(oid))
+      lag = std::max<long>(0, std::time(nullptr) - oid.OID().asTimeT());
   }
   catch (const mongo::DBException& e)
   {
-    LogException("Replicate unserialize", e, entry);
+    LogException("Replicate unserialize", e, entries.back());
   }
+  
+  std::lock_guard<std::mutex> lock(statsMutex);
+  ++stats.batches;
+  stats.entries += entries.size();
+  stats.replicated += replicated;
+  stats.lastBatch = entries.size();
+  stats.largestBatch = std::max<int>(stats.largestBatch, entries.size());
+  stats.lag = lag;
+  stats.largestLag = std::max(stats.largestLag, lag);
 }
 
 void Replicator::Populate()
@@ -170,8 +215,7 @@ void Replicator::Run()
         Tail tail(cfg::Get().Database().Name() + ".updatelog", conn.BaseConn());
         while (true)
         {
-          auto entry = tail.Next();
-          Replicate(entry);
+          Replicate(tail.Next(maximumBatch));
         }
       }
       catch (const mongo::DBException& e)
@@ -195,6 +239,12 @@ bool Replicator::Register(const std::shared_ptr<Replicable>& cache)
   return true;
 }
 
+ReplicationStats Replicator::Stats()
+{
+  std::lock_guard<std::mutex> lock(statsMutex);
+  return stats;
+}
+
 void Replicator::Start()
 {
   verify(!thread.joinable());
@@ -21,6 +21,7 @@
 #include <memory>
 #include <boost/thread/thread.hpp>
 #include <mutex>
+#include <vector>
 #include "db/replicable.hpp"
 
 namespace mongo
@@ -31,20 +32,36 @@ class BSONObj;
 namespace db
 {
 
+struct ReplicationStats
+{
+  unsigned long long batches;
+  unsigned long long entries;    // updatelog entries read
+  unsigned long long replicated; // distinct ids refreshed
+  int lastBatch;
+  int largestBatch;
+  long lag;                      // seconds from logged to replicated
+  long largestLag;
+};
+
+// tails the updatelog and refreshes the registered caches, entries are
+// taken in batches and each changed id is refreshed once per batch
 class Replicator
 {
   boost::thread thread;
   std::vector<std::shared_ptr<Replicable>> caches;
+  std::mutex statsMutex;
+  ReplicationStats stats;
 
   static std::unique_ptr<Replicator> instance;
   static const int maximumRetries = 20;
   static const long retryInterval = 10;
+  static const size_t maximumBatch = 1000;
   
-  Replicator() = default;
+  Replicator() : stats() { }
   
   void Run();  
   void LogFailed(const std::list<std::shared_ptr<Replicable>>& failed);
-  void Replicate(const mongo::BSONObj& entry);
+  void Replicate(const std::vector<mongo::BSONObj>& entries);
   void Populate();
   
 public:
@@ -52,6 +69,7 @@ public:
   void Stop();
   
   bool Register(const std::shared_ptr<Replicable>& cache);
+  ReplicationStats Stats();
 
   static Replicator& Get()
   {
@@ -0,0 +1,251 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <mongo/client/dbclient.h>
+#include "db/stats/aggregator.hpp"
+#include "db/stats/weekly.hpp"
+#include "db/connection.hpp"
+#include "db/error.hpp"
+#include "stats/date.hpp"
+#include "logs/logs.hpp"
+#include "util/enumstrings.hpp"
+#include "util/misc.hpp"
+#include "util/verify.hpp"
+
+namespace db { namespace stats
+{
+
+namespace
+{
+
+template <typename Key>
+mongo::BSONObj Query(const Key& key)
+{
+  mongo::BSONObjBuilder query;
+  query.append("uid", key.uid);
+  query.append("day", key.day);
+  query.append("week", key.week);
+  query.append("month", key.month);
+  query.append("year", key.year);
+  query.append("direction", util::EnumToString(key.direction));
+  query.append("section", key.section);
+  return query.obj();
+}
+
+template <typename Value>
+mongo::BSONObj Update(const Value& value)
+{
+  return BSON("$inc" << BSON("files" << value.files) <<
+              "$inc" << BSON("kbytes" << value.kBytes) <<
+              "$inc" << BSON("xfertime" << value.xfertime));
+}
+
+}
+
+std::unique_ptr<Aggregator> Aggregator::instance;
+
+bool Aggregator::Merge(const Key& key, const Value& value)
+{
+  auto it = pending.find(key);
+  if (it != pending.end())
+  {
+    it->second += value;
+    return true;
+  }
+  
+  if (pending.size() >= maximumBacklog)
+  {
+    ++dropped;
+    return false;
+  }
+  
+  pending.insert(std::make_pair(key, value));
+  return true;
+}
+
+void Aggregator::Add(acl::UserID uid, long long kBytes, long long xfertime, int files, 
+                     const std::string& section, ::stats::Direction direction)
+{
+  ::stats::Date date;
+  Key key { uid, date.Day(), date.Week(), date.Month(), date.Year(), direction, section };
+  Value value;
+  value.files = files;
+  value.kBytes = kBytes;
+  value.xfertime = xfertime;
+  
+  if (!started)
+  {
+    // no writer thread, as in the standalone tools
+    WeeklyCounters::Get().Add(uid, section, direction, kBytes);
+    FastConnection conn;
+    conn.Update("transfers", Query(key), Update(value), true);
+    return;
+  }
+  
+  // counted together with the merge, so a weekly rebuild sees each
+  // transfer either in the collection or in pending
+  boost::lock_guard<boost::mutex> lock(mutex);
+  WeeklyCounters::Get().Add(uid, section, direction, kBytes);
+  Merge(key, value);
+  if (pending.size() >= flushThreshold) flushNeeded.notify_one();
+}
+
+void Aggregator::Requeue(const Batch& batch, const Batch& failed)
+{
+  boost::lock_guard<boost::mutex> lock(mutex);
+  for (const auto& kv : batch)
+  {
+    if (failed.find(kv.first) == failed.end())
+    {
+      if (!failures.empty()) failures.erase(kv.first);
+      continue;
+    }
+    
+    int& attempts = failures[kv.first];
+    if (++attempts >= maximumAttempts)
+    {
+      logs::Database("Dropping transfer stats update after %1% failed writes: "
+                     "uid %2% %3% section '%4%' on %5%-%6%-%7%, "
+                     "%8% files %9% kbytes %10% xfertime",
+                     attempts, kv.first.uid, util::EnumToString(kv.first.direction), 
+                     kv.first.section, kv.first.year, kv.first.month, kv.first.day, 
+                     kv.second.files, kv.second.kBytes, kv.second.xfertime);
+      failures.erase(kv.first);
+      continue;
+    }
+    
+    Merge(kv.first, kv.second);
+  }
+}
+
+bool Aggregator::Write(const Batch& batch, Batch& failed)
+{
+  // each upsert is acknowledged on its own, getLastError only reports
+  // the last write so a pipelined batch can't tell which of its writes
+  // were rejected. the coalescing per key is where the saving is
+  auto it = batch.cbegin();
+  try
+  {
+    SafeConnection conn;
+    for (; it != batch.cend(); ++it)
+    {
+      if (it->second.Empty()) continue;
+      try
+      {
+        conn.Update("transfers", Query(it->first), Update(it->second), true);
+      }
+      catch (const DBWriteError&)
+      {
+        // already logged, on a broken connection this and the rest
+        // are requeued below
+        if (conn.BaseConn().isFailed()) throw;
+        failed.insert(*it);
+      }
+    }
+    return failed.empty();
+  }
+  catch (const mongo::DBException& e)
+  {
+    LogException("Flush transfer stats", e, batch.size());
+  }
+  catch (const DBError&)
+  {
+    // failed connection
+  }
+  
+  // no telling whether the write in flight arrived
+  failed.insert(it, batch.cend());
+  return false;
+}
+
+bool Aggregator::Flush()
+{
+  boost::lock_guard<boost::mutex> flushLock(flushMutex);
+  return FlushLocked();
+}
+
+bool Aggregator::FlushLocked()
+{
+  Batch batch;
+  long long discarded;
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    batch.swap(pending);
+    discarded = dropped;
+    dropped = 0;
+  }
+  
+  if (discarded > 0)
+  {
+    logs::Database("Transfer stats backlog full, discarded %1% updates", discarded);
+  }
+  
+  if (batch.empty()) return true;
+  
+  Batch failed;
+  bool okay = Write(batch, failed);
+  if (!okay)
+  {
+    logs::Database("Failed to write %1% of %2% transfer stats updates, will retry", 
+                   failed.size(), batch.size());
+  }
+  
+  Requeue(batch, failed);
+  return okay;
+}
+
+void Aggregator::Run()
+{
+  util::SetProcessTitle("STATS");
+  logs::SetThreadIDPrefix('T' /* transfer stats */);
+  
+  while (true)
+  {
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      flushNeeded.timed_wait(lock, boost::posix_time::seconds(flushInterval),
+                             [this]() { return pending.size() >= flushThreshold; });
+    }
+    
+    if (!Flush())
+    {
+      boost::this_thread::sleep(boost::posix_time::seconds(retryInterval));
+    }
+  }
+}
+
+void Aggregator::Start()
+{
+  verify(!thread.joinable());
+  logs::Debug("Starting transfer stats writer..");
+  started = true;
+  thread = boost::thread(&Aggregator::Run, this);
+}
+
+void Aggregator::Stop()
+{
+  if (thread.joinable())
+  {
+    logs::Debug("Stopping transfer stats writer..");
+    thread.interrupt();
+    thread.join();
+  }
+  
+  started = false;
+  Flush();
+}
+
+} /* stats namespace */
+} /* db namespace */
@@ -0,0 +1,123 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __DB_STATS_AGGREGATOR_HPP
+#define __DB_STATS_AGGREGATOR_HPP
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include "acl/types.hpp"
+#include "stats/types.hpp"
+
+namespace db { namespace stats
+{
+
+// coalesces transfer stat increments in memory and writes them out as
+// one upsert per uid / day / direction / section every flush, rather
+// than one upsert per transfer. a failed write is merged back in and
+// retried, up to maximumBacklog distinct keys, and dropped once it has
+// failed maximumAttempts times
+class Aggregator
+{
+  struct Key
+  {
+    acl::UserID uid;
+    int day;
+    int week;
+    int month;
+    int year;
+    ::stats::Direction direction;
+    std::string section;
+    
+    bool operator<(const Key& rhs) const
+    {
+      return std::tie(uid, year, month, week, day, direction, section) <
+             std::tie(rhs.uid, rhs.year, rhs.month, rhs.week, rhs.day, rhs.direction, rhs.section);
+    }
+  };
+  
+  struct Value
+  {
+    int files;
+    long long kBytes;
+    long long xfertime;
+    
+    Value() : files(0), kBytes(0), xfertime(0) { }
+    
+    Value& operator+=(const Value& rhs)
+    {
+      files += rhs.files;
+      kBytes += rhs.kBytes;
+      xfertime += rhs.xfertime;
+      return *this;
+    }
+    
+    bool Empty() const { return files == 0 && kBytes == 0 && xfertime == 0; }
+  };
+  
+  typedef std::map<Key, Value> Batch;
+
+  boost::thread thread;
+  boost::mutex mutex;
+  boost::mutex flushMutex;
+  boost::condition_variable flushNeeded;
+  Batch pending;
+  std::map<Key, int> failures;
+  std::atomic<bool> started;
+  long long dropped;
+  
+  static std::unique_ptr<Aggregator> instance;
+  static const size_t flushThreshold = 1000;
+  static const size_t maximumBacklog = 100000;
+  static const long flushInterval = 5;
+  static const long retryInterval = 10;
+  static const int maximumAttempts = 30;
+  
+  Aggregator() : started(false), dropped(0) { }
+  
+  void Run();
+  bool Flush();
+  bool FlushLocked();
+  void Requeue(const Batch& batch, const Batch& failed);
+  bool Merge(const Key& key, const Value& value);
+  static bool Write(const Batch& batch, Batch& failed);
+  
+  // rebuilds its totals from the collection and what's still pending
+  friend class WeeklyCounters;
+  
+public:
+  void Start();
+  void Stop();
+  
+  void Add(acl::UserID uid, long long kBytes, long long xfertime, int files, 
+           const std::string& section, ::stats::Direction direction);
+  
+  static Aggregator& Get()
+  {
+    if (!instance) instance.reset(new Aggregator());
+    return *instance;
+  }
+};
+
+} /* stats namespace */
+} /* db namespace */
+
+#endif
@@ -16,9 +16,13 @@
 #include <algorithm>
 #include <functional>
 #include <cmath>
+#include <map>
+#include <tuple>
+#include <utility>
 #include <mongo/client/dbclient.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include "db/stats/stats.hpp"
+#include "db/stats/aggregator.hpp"
 #include "acl/user.hpp"
 #include "stats/date.hpp"
 #include "cfg/get.hpp"
@@ -47,33 +51,13 @@ void Update(acl::UserID         uid,
     xfertime *= -1;
   }
 
-  ::stats::Date date;
-  mongo::BSONObjBuilder query;
-  query.append("uid", uid);
-  query.append("day", date.Day());
-  query.append("week", date.Week());
-  query.append("month", date.Month());
-  query.append("year", date.Year());
-  query.append("direction", util::EnumToString(direction));
-  query.append("section", section);
-
-  mongo::BSONObj update = BSON(
-    "$inc" << BSON("files" << files) <<
-    "$inc" << BSON("kbytes" << kBytes) <<
-    "$inc" << BSON("xfertime" << xfertime));
-  
-  FastConnection conn;
-  conn.Update("transfers", query.obj(), update, true);
+  Aggregator::Get().Add(uid, kBytes, xfertime, files, section, direction);
 }
 
-long long XfertimeCorrection(acl::UserID          uid, 
-                             long long            kBytes,
-                             time_t               modTime, 
-                             ::stats::Direction   direction)
+// the site's average transfer speed on a day, as total kbytes and xfertime,
+// negative if it couldn't be looked up
+std::pair<long long, long long> DayTotals(const util::Time& t, ::stats::Direction direction)
 {
-  long long xfertime = -1; 
-  util::Time t(modTime);
-
   auto cmd = BSON("aggregate" << "transfers" << "pipeline" << 
     BSON_ARRAY(
         BSON("$match" << 
@@ -81,7 +65,7 @@ long long XfertimeCorrection(acl::UserID          uid,
                "week" << t.Week() << "day" << t.Day() <<
                "direction" << util::EnumToString(direction))) <<
         BSON("$group" << 
-          BSON("_id" << uid << 
+          BSON("_id" << 0 << 
             "total kbytes" << BSON("$sum" << "$kbytes") <<
             "total xfertime" << BSON("$sum" << "$xfertime")
       ))));
@@ -95,11 +79,8 @@ long long XfertimeCorrection(acl::UserID          uid,
     {
       try
       {
-        long long totalXfertime = elems[0]["total xfertime"].Long();
-        if (totalXfertime > 0)
-          xfertime = std::ceil(static_cast<double>(totalXfertime) / elems[0]["total kbytes"].Long() * kBytes);
-        else
-          xfertime = 0;
+        return std::make_pair(elems[0]["total kbytes"].Long(), 
+                              elems[0]["total xfertime"].Long());
       }
       catch (const mongo::DBException& e)
       {
@@ -108,49 +89,78 @@ long long XfertimeCorrection(acl::UserID          uid,
     }
   }
   
-  return xfertime;
+  return std::make_pair(-1LL, -1LL);
 }
 
-void UploadIncr(acl::UserID         uid, 
-                long long           kBytes, 
-                time_t              modTime, 
-                const std::string&  section, 
-                int                 files)
+long long XfertimeCorrection(long long kBytes, const std::pair<long long, long long>& day)
+{
+  if (day.second < 0) return -1;
+  if (day.second == 0) return 0;
+  return std::ceil(static_cast<double>(day.second) / day.first * kBytes);
+}
+
+void UploadAdjust(const std::vector<UploadAdjustment>&  adjustments,
+                  const std::string&                    section,
+                  bool                                  increment)
 {
   if (section.empty()) return; // non stat section not affected by nukes / deleting
   
-  long long xfertime = XfertimeCorrection(uid, kBytes, modTime, ::stats::Direction::Upload);
-  if (xfertime < 0)
+  std::map<std::tuple<int, int, int, int>, std::pair<long long, long long>> days;
+  for (const auto& adjustment : adjustments)
   {
-    namespace pt = boost::posix_time;
-    logs::Database("Failed to adjust xfertime when incrementing upload stats for date: %1%",
-                   pt::to_simple_string(pt::from_time_t(modTime)));
-    xfertime = 0;
+    util::Time t(adjustment.modTime);
+    auto key = std::make_tuple(t.Year(), t.Month(), t.Week(), t.Day());
+    auto it = days.find(key);
+    if (it == days.end())
+    {
+      it = days.insert(std::make_pair(key, DayTotals(t, ::stats::Direction::Upload))).first;
+    }
+    
+    long long xfertime = XfertimeCorrection(adjustment.kBytes, it->second);
+    if (xfertime < 0)
+    {
+      namespace pt = boost::posix_time;
+      logs::Database("Failed to adjust xfertime when %1% upload stats for date: %2%",
+                     increment ? "incrementing" : "decrementing",
+                     pt::to_simple_string(pt::from_time_t(adjustment.modTime)));
+      xfertime = 0;
+    }
+    
+    Update(adjustment.uid, adjustment.kBytes, xfertime, adjustment.files, 
+           increment ? "" : section, ::stats::Direction::Upload, true);
+    Update(adjustment.uid, adjustment.kBytes, xfertime, adjustment.files, 
+           increment ? section : "", ::stats::Direction::Upload, false);
   }
+}
 
-  Update(uid, kBytes, xfertime, files, "", ::stats::Direction::Upload, true);
-  Update(uid, kBytes, xfertime, files, section, ::stats::Direction::Upload, false);
+void UploadIncr(const std::vector<UploadAdjustment>&  adjustments,
+                const std::string&                    section)
+{
+  UploadAdjust(adjustments, section, true);
 }
 
-void UploadDecr(acl::UserID         uid, 
+void UploadDecr(const std::vector<UploadAdjustment>&  adjustments,
+                const std::string&                    section)
+{
+  UploadAdjust(adjustments, section, false);
+}
+
+void UploadIncr(acl::UserID         uid, 
                 long long           kBytes, 
                 time_t              modTime, 
                 const std::string&  section, 
                 int                 files)
 {
-  if (section.empty()) return; // non stat section not affected by nukes / deleting
-  
-  long long xfertime = XfertimeCorrection(uid, kBytes, modTime, ::stats::Direction::Upload);
-  if (xfertime < 0)
-  {
-    namespace pt = boost::posix_time;
-    logs::Database("Failed to adjust xfertime when decrementing upload stats for date: %1%",
-                   pt::to_simple_string(pt::from_time_t(modTime)));
-    xfertime = 0;
-  }
+  UploadIncr({ UploadAdjustment(uid, kBytes, files, modTime) }, section);
+}
 
-  Update(uid, kBytes, xfertime, files, section, ::stats::Direction::Upload, true);
-  Update(uid, kBytes, xfertime, files, "", ::stats::Direction::Upload, false);
+void UploadDecr(acl::UserID         uid, 
+                long long           kBytes, 
+                time_t              modTime, 
+                const std::string&  section, 
+                int                 files)
+{
+  UploadDecr({ UploadAdjustment(uid, kBytes, files, modTime) }, section);
 }
 
 void UploadDecr(const acl::User&    user, 
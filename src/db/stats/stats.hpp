@@ -47,6 +47,17 @@ void Download(const acl::User&    user,
               long long           xfertime, 
               const std::string&  section = "");
 
+struct UploadAdjustment
+{
+  acl::UserID uid;
+  long long kBytes;
+  int files;
+  time_t modTime;
+  
+  UploadAdjustment(acl::UserID uid, long long kBytes, int files, time_t modTime) :
+    uid(uid), kBytes(kBytes), files(files), modTime(modTime) { }
+};
+
 void UploadIncr(acl::UserID         uid, 
                 long long           kBytes,
                 time_t              modTime, 
@@ -65,6 +76,14 @@ void UploadDecr(const acl::User&    user,
                 const std::string&  section = "", 
                 int                 files = 1);
 
+// as above for many users at once, such as everyone in a nuke, with
+// the xfertime correction for each day looked up once for all of them
+void UploadIncr(const std::vector<UploadAdjustment>&  adjustments,
+                const std::string&                    section);
+
+void UploadDecr(const std::vector<UploadAdjustment>&  adjustments,
+                const std::string&                    section);
+
 void Nuke(acl::UserID         uid, 
           long long           kBytes, 
           int                 files, 
@@ -0,0 +1,176 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <mongo/client/dbclient.h>
+#include "db/stats/weekly.hpp"
+#include "db/stats/aggregator.hpp"
+#include "db/stats/stats.hpp"
+#include "db/stats/serialization.hpp"
+#include "db/connection.hpp"
+#include "db/error.hpp"
+#include "stats/date.hpp"
+#include "stats/stat.hpp"
+#include "cfg/get.hpp"
+#include "util/enumstrings.hpp"
+#include "logs/logs.hpp"
+
+namespace db { namespace stats
+{
+
+std::unique_ptr<WeeklyCounters> WeeklyCounters::instance;
+const std::chrono::seconds WeeklyCounters::retryInterval(60);
+
+WeeklyCounters::WeeklyCounters() : 
+  loaded(false), 
+  rebuilding(false),
+  year(-1), 
+  week(-1),
+  lastAttempt(std::chrono::steady_clock::now() - retryInterval)
+{
+}
+
+bool WeeklyCounters::Rebuild(int year, int week)
+{
+  auto cmd = BSON("aggregate" << "transfers" << "pipeline" << 
+    BSON_ARRAY(
+      BSON("$match" << 
+        BSON("year" << year << "week" << week <<
+             "direction" << util::EnumToString(::stats::Direction::Download))) <<
+      BSON("$group" << 
+        BSON("_id" << BSON("uid" << "$uid" << "section" << "$section") << 
+             "total kbytes" << BSON("$sum" << "$kbytes")))));
+
+  // everything added so far is written first, and no other flush can
+  // start until the totals are installed, so each transfer is either in
+  // the collection or still pending below, never both
+  Aggregator& aggregator = Aggregator::Get();
+  boost::lock_guard<boost::mutex> flushLock(aggregator.flushMutex);
+  aggregator.FlushLocked();
+  
+  NoErrorConnection conn;
+  mongo::BSONObj result;
+  if (!conn.RunCommand(cmd, result)) return false;
+  
+  decltype(downloaded) totals;
+  try
+  {
+    for (const auto& elem : result["result"].Array())
+    {
+      auto id = elem["_id"].Obj();
+      totals[std::make_pair(id["uid"].Int(), id["section"].String())] = 
+          elem["total kbytes"].Long();
+    }
+  }
+  catch (const mongo::DBException& e)
+  {
+    LogException("Unserialize weekly download totals", e, result);
+    return false;
+  }
+  
+  // blocks Add until the totals are swapped in, so none are missed
+  boost::lock_guard<boost::mutex> pendingLock(aggregator.mutex);
+  for (const auto& kv : aggregator.pending)
+  {
+    if (kv.first.year == year && kv.first.week == week &&
+        kv.first.direction == ::stats::Direction::Download)
+      totals[std::make_pair(kv.first.uid, kv.first.section)] += kv.second.kBytes;
+  }
+  
+  std::lock_guard<std::mutex> lock(mutex);
+  downloaded.swap(totals);
+  this->year = year;
+  this->week = week;
+  loaded = true;
+  return true;
+}
+
+bool WeeklyCounters::Current()
+{
+  ::stats::Date date;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (loaded && date.Year() == year && date.Week() == week) return true;
+    if (rebuilding) return false;
+    
+    // don't hammer an unavailable database on every transfer
+    auto now = std::chrono::steady_clock::now();
+    if (!loaded && now - lastAttempt < retryInterval) return false;
+    lastAttempt = now;
+    
+    loaded = false;
+    downloaded.clear();
+    rebuilding = true;
+  }
+  
+  // built without holding the lock, meanwhile everyone falls back to
+  // aggregating directly
+  bool rebuilt = Rebuild(date.Year(), date.Week());
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    rebuilding = false;
+  }
+  
+  if (!rebuilt) logs::Database("Failed to rebuild weekly download totals");
+  return rebuilt;
+}
+
+void WeeklyCounters::Load()
+{
+  Current();
+}
+
+void WeeklyCounters::Add(acl::UserID uid, const std::string& section, 
+                         ::stats::Direction direction, long long kBytes)
+{
+  if (direction != ::stats::Direction::Download) return;
+  
+  // called with the aggregator's lock held so this can't rebuild, a
+  // rebuild that's due picks this transfer up from pending instead
+  ::stats::Date date;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!loaded || date.Year() != year || date.Week() != week) return;
+  downloaded[std::make_pair(uid, section)] += kBytes;
+}
+
+long long WeeklyCounters::Downloaded(acl::UserID uid, const std::string& section)
+{
+  if (Current())
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (loaded)
+    {
+      if (!section.empty())
+      {
+        auto it = downloaded.find(std::make_pair(uid, section));
+        return it != downloaded.end() ? it->second : 0;
+      }
+      
+      long long total = 0;
+      for (const auto& kv : cfg::Get().Sections())
+      {
+        auto it = downloaded.find(std::make_pair(uid, kv.first));
+        if (it != downloaded.end()) total += it->second;
+      }
+      return total;
+    }
+  }
+  
+  // counters couldn't be rebuilt, fall back to aggregating directly
+  return CalculateSingleUser(uid, section, ::stats::Timeframe::Week, 
+                             ::stats::Direction::Download).KBytes();
+}
+
+} /* stats namespace */
+} /* db namespace */
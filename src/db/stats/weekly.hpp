@@ -0,0 +1,73 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __DB_STATS_WEEKLY_HPP
+#define __DB_STATS_WEEKLY_HPP
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include "acl/types.hpp"
+#include "stats/types.hpp"
+
+namespace db { namespace stats
+{
+
+// running download totals for the current week per user and section,
+// so weekly allotment checks don't have to aggregate the transfers
+// collection. rebuilt from the database the first time they're needed
+// and again whenever the week rolls over, transfers added while that
+// runs are picked up from the aggregator's pending updates
+class WeeklyCounters
+{
+  std::mutex mutex;
+  std::map<std::pair<acl::UserID, std::string>, long long> downloaded;
+  bool loaded;
+  bool rebuilding;
+  int year;
+  int week;
+  std::chrono::steady_clock::time_point lastAttempt;
+  
+  static std::unique_ptr<WeeklyCounters> instance;
+  static const std::chrono::seconds retryInterval;
+  
+  WeeklyCounters();
+  
+  bool Current();
+  bool Rebuild(int year, int week);
+  
+public:
+  void Load();
+  void Add(acl::UserID uid, const std::string& section, 
+           ::stats::Direction direction, long long kBytes);
+  
+  // kbytes downloaded this week, an empty section totals every
+  // configured section as CalculateSingleUser does
+  long long Downloaded(acl::UserID uid, const std::string& section);
+  
+  static WeeklyCounters& Get()
+  {
+    if (!instance) instance.reset(new WeeklyCounters());
+    return *instance;
+  }
+};
+
+} /* stats namespace */
+} /* db namespace */
+
+#endif
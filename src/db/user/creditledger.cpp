@@ -0,0 +1,304 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <vector>
+#include <mongo/client/dbclient.h>
+#include "db/user/creditledger.hpp"
+#include "db/connection.hpp"
+#include "logs/logs.hpp"
+#include "util/verify.hpp"
+
+namespace db
+{
+
+std::unique_ptr<CreditLedger> CreditLedger::instance;
+
+CreditLedger::Account& CreditLedger::Lookup(acl::UserID uid, const std::string& section, 
+                                            long long seed)
+{
+  auto key = std::make_pair(uid, section);
+  auto it = accounts.find(key);
+  if (it == accounts.end()) it = accounts.insert(std::make_pair(key, Account(seed))).first;
+  else
+  if (!it->second.seeded)
+  {
+    Account& account = it->second;
+    account.balance = seed + account.unflushed + account.inflight;
+    account.seeded = true;
+  }
+  return it->second;
+}
+
+void CreditLedger::Apply(Account& account, long long kBytes)
+{
+  account.balance += kBytes;
+  account.unflushed += kBytes;
+}
+
+long long CreditLedger::Balance(acl::UserID uid, const std::string& section, long long seed)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return Lookup(uid, section, seed).balance;
+}
+
+void CreditLedger::Credit(acl::UserID uid, const std::string& section, 
+                          long long seed, long long kBytes)
+{
+  if (!kBytes) return;
+  
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    Apply(Lookup(uid, section, seed), kBytes);
+  }
+  
+  if (!started) Flush();
+}
+
+bool CreditLedger::Debit(acl::UserID uid, const std::string& section, long long seed, 
+                         long long kBytes, bool force)
+{
+  if (!kBytes) return true;
+  
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    Account& account = Lookup(uid, section, seed);
+    if (!force && account.balance < kBytes) return false;
+    Apply(account, -kBytes);
+  }
+  
+  if (!started) Flush();
+  return true;
+}
+
+void CreditLedger::Settle(acl::UserID uid, const std::string& section, long long seed,
+                          long long reserved, long long actual)
+{
+  if (reserved == actual) return;
+  
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    Apply(Lookup(uid, section, seed), reserved - actual);
+  }
+  
+  if (!started) Flush();
+}
+
+void CreditLedger::Forget(acl::UserID uid)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = accounts.lower_bound(std::make_pair(uid, std::string()));
+  while (it != accounts.end() && it->first.first == uid)
+  {
+    it = accounts.erase(it);
+  }
+}
+
+unsigned long long CreditLedger::Generation()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return generation;
+}
+
+void CreditLedger::Reconcile(acl::UserID uid, 
+                             const std::unordered_map<std::string, long long>& credits,
+                             unsigned long long since)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = accounts.lower_bound(std::make_pair(uid, std::string()));
+  for (; it != accounts.end() && it->first.first == uid; ++it)
+  {
+    Account& account = it->second;
+    
+    // a write in progress or since the read reconciles from its own result
+    if (account.inflight != 0 || account.reconciled > since) continue;
+    
+    auto cit = credits.find(it->first.second);
+    long long stored = cit != credits.end() ? cit->second : 0;
+    account.balance = stored + account.unflushed;
+    account.seeded = true;
+  }
+}
+
+CreditLedger::WriteResult CreditLedger::Write(acl::UserID uid, const std::string& section, 
+                                              long long kBytes, boost::optional<long long>& stored)
+{
+  NoErrorConnection conn;
+  auto updateExisting = [&]() -> bool
+    {
+      auto query = BSON("uid" << uid << 
+                        "credits" << BSON("$elemMatch" << BSON("section" << section)));
+                        
+      auto update = BSON("$inc" << BSON("credits.$.value" << kBytes));
+                        
+      auto cmd = BSON("findandmodify" << "users" <<
+                      "query" << query <<
+                      "update" << update <<
+                      "new" << true <<
+                      "fields" << BSON("credits" << 1));
+                      
+      mongo::BSONObj result;
+      if (!conn.RunCommand(cmd, result) || result["value"].type() == mongo::jstNULL)
+        return false;
+      
+      try
+      {
+        for (const auto& elem : result["value"]["credits"].Array())
+        {
+          auto credit = elem.Obj();
+          if (credit["section"].String() == section) 
+          {
+            stored.reset(credit["value"].numberLong());
+            break;
+          }
+        }
+      }
+      catch (const mongo::DBException& e)
+      {
+        LogException("Unserialize credits", e, result);
+      }
+      
+      return true;
+    };
+
+  auto doInsert = [&]() -> bool
+  {
+    auto query = QUERY("uid" << uid << "credits" << BSON("$not" << 
+                       BSON("$elemMatch" << BSON("section" << section))));
+    auto update = BSON("$push" << BSON("credits" << BSON("section" << section << "value" << kBytes)));
+    if (conn.Update("users", query, update, false) <= 0) return false;
+    stored.reset(kBytes);
+    return true;
+  };
+  
+  if (updateExisting() || doInsert() || updateExisting()) return WriteResult::Written;
+  
+  // neither matched, retrying is pointless if the user has been deleted
+  if (conn.Count("users", BSON("uid" << uid)) == 0) return WriteResult::NoSuchUser;
+  return WriteResult::Failed;
+}
+
+void CreditLedger::Flush()
+{
+  std::vector<std::pair<AccountKey, long long>> deltas;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& kv : accounts)
+    {
+      if (kv.second.unflushed == 0) continue;
+      deltas.emplace_back(kv.first, kv.second.unflushed);
+      kv.second.inflight += kv.second.unflushed;
+      kv.second.unflushed = 0;
+    }
+  }
+  
+  if (deltas.empty()) return;
+
+  boost::this_thread::disable_interruption noInterrupt;
+  std::vector<acl::UserID> updated;
+  for (const auto& delta : deltas)
+  {
+    acl::UserID uid = delta.first.first;
+    const std::string& section = delta.first.second;
+    boost::optional<long long> stored;
+    auto result = Write(uid, section, delta.second, stored);
+    
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = accounts.find(delta.first);
+      if (it == accounts.end() && result == WriteResult::Failed)
+      {
+        // forgotten while being written, kept until the retry so the
+        // delta isn't lost. reseeded if the user is touched again
+        it = accounts.insert(std::make_pair(delta.first, Account(0))).first;
+        it->second.inflight = delta.second;
+        it->second.seeded = false;
+      }
+      
+      if (it != accounts.end())
+      {
+        Account& account = it->second;
+        account.inflight -= delta.second;
+        if (result == WriteResult::Failed) account.unflushed += delta.second;
+        else
+        if (result == WriteResult::Written)
+        {
+          // the stored balance includes anything changed elsewhere
+          if (stored) account.balance = *stored + account.unflushed + account.inflight;
+          account.reconciled = ++generation;
+        }
+        else
+        if (!account.seeded && account.unflushed == 0 && account.inflight == 0)
+        {
+          accounts.erase(it);
+        }
+      }
+    }
+    
+    if (result == WriteResult::Written)
+    {
+      if (updated.empty() || updated.back() != uid) updated.emplace_back(uid);
+      continue;
+    }
+    
+    if (result == WriteResult::NoSuchUser)
+    {
+      logs::Database("Dropping %1% kbytes of credits for UID %2%%3%, user no longer exists", 
+                     delta.second, uid,
+                     !section.empty() ? " in section " + section : std::string(""));
+      continue;
+    }
+    
+    logs::Database("Unable to write credits for UID %1%%2%, will retry", uid,
+                   !section.empty() ? " in section " + section : std::string(""));
+  }
+  
+  FastConnection conn;
+  for (acl::UserID uid : updated)
+  {
+    conn.Insert("updatelog", BSON("collection" << "users" << "id" << uid));
+  }
+}
+
+void CreditLedger::Run()
+{
+  while (true)
+  {
+    boost::this_thread::sleep(boost::posix_time::seconds(flushInterval));
+    Flush();
+  }
+}
+
+void CreditLedger::Start()
+{
+  verify(!thread.joinable());
+  logs::Debug("Starting credit ledger writer..");
+  started = true;
+  thread = boost::thread(&CreditLedger::Run, this);
+}
+
+void CreditLedger::Stop()
+{
+  if (thread.joinable())
+  {
+    logs::Debug("Stopping credit ledger writer..");
+    thread.interrupt();
+    thread.join();
+  }
+  
+  started = false;
+  Flush();
+}
+
+} /* db namespace */
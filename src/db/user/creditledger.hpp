@@ -0,0 +1,119 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __DB_USER_CREDITLEDGER_HPP
+#define __DB_USER_CREDITLEDGER_HPP
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <boost/optional.hpp>
+#include <boost/thread/thread.hpp>
+#include "acl/types.hpp"
+
+namespace db
+{
+
+// authoritative in memory credit balances, so crediting and debiting
+// never waits on the database. an account is seeded from the user's
+// loaded credits the first time it is touched, changes are applied
+// immediately and the deltas are written out in the background, followed
+// by an updatelog entry so other caches pick them up.
+//
+// changes made elsewhere (other nodes, the tools, direct edits) are
+// picked up by reconciling with the stored balance, both from the result
+// of each write and whenever the user is replicated
+class CreditLedger
+{
+  struct Account
+  {
+    long long balance;
+    long long unflushed;
+    long long inflight;           // taken by a flush, not yet written
+    unsigned long long reconciled; // generation of the last write
+    bool seeded;                  // false if only kept to retry a write
+    
+    Account(long long balance) : 
+      balance(balance), unflushed(0), inflight(0), reconciled(0), seeded(true) { }
+  };
+  
+  enum class WriteResult
+  {
+    Written,
+    Failed,
+    NoSuchUser
+  };
+  
+  typedef std::pair<acl::UserID, std::string> AccountKey;
+  
+  boost::thread thread;
+  std::mutex mutex;
+  std::map<AccountKey, Account> accounts;
+  std::atomic<bool> started;
+  unsigned long long generation;
+  
+  static std::unique_ptr<CreditLedger> instance;
+  static const long flushInterval = 1;
+  
+  CreditLedger() : started(false), generation(0) { }
+  
+  Account& Lookup(acl::UserID uid, const std::string& section, long long seed);
+  void Apply(Account& account, long long kBytes);
+  void Run();
+  void Flush();
+  static WriteResult Write(acl::UserID uid, const std::string& section, long long kBytes,
+                           boost::optional<long long>& stored);
+  
+public:
+  void Start();
+  void Stop();
+  
+  // seed is the user's loaded balance, used if the account isn't in the ledger yet
+  long long Balance(acl::UserID uid, const std::string& section, long long seed);
+  void Credit(acl::UserID uid, const std::string& section, long long seed, long long kBytes);
+  bool Debit(acl::UserID uid, const std::string& section, long long seed, 
+             long long kBytes, bool force);
+  
+  // a reservation is a debit of the full amount up front, settling
+  // credits back or debits further once the actual amount is known
+  void Settle(acl::UserID uid, const std::string& section, long long seed,
+              long long reserved, long long actual);
+  
+  void Forget(acl::UserID uid);
+  
+  // call before reading a user's stored credits, and pass the result to
+  // Reconcile with them. accounts written since then are left alone as
+  // the read may predate that write
+  unsigned long long Generation();
+  
+  // replaces the cached balances of a user with the stored ones,
+  // keeping any changes not yet written
+  void Reconcile(acl::UserID uid, const std::unordered_map<std::string, long long>& credits,
+                 unsigned long long since);
+  
+  static CreditLedger& Get()
+  {
+    if (!instance) instance.reset(new CreditLedger());
+    return *instance;
+  }
+};
+
+} /* db namespace */
+
+#endif
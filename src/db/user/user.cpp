@@ -13,15 +13,14 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-#include <future>
 #include "db/user/user.hpp"
+#include "db/user/creditledger.hpp"
 #include "db/connection.hpp"
 #include "acl/user.hpp"
 #include "db/serialization.hpp"
 #include "db/error.hpp"
 #include "db/user/util.hpp"
 #include "db/group/util.hpp"
-#include "util/futureminder.hpp"
 #include "acl/userdata.hpp"
 
 namespace db
@@ -165,78 +164,37 @@ void User::SaveRatio()
   SaveField("ratio");
 }
 
-namespace
+long long User::Credits(const std::string& section) const
 {
-util::FutureMinder asyncTasks;
+  return CreditLedger::Get().Balance(user.id, section, SeedCredits(section));
 }
 
 void User::IncrCredits(const std::string& section, long long kBytes)
 {
-  auto doIncrement = [section, kBytes](acl::UserID uid)
-    {
-      NoErrorConnection conn;
-      auto updateExisting = [&]() -> bool
-        {
-          auto query = BSON("uid" << uid << 
-                            "credits" << BSON("$elemMatch" << BSON("section" << section)));
-                            
-          auto update = BSON("$inc" << BSON("credits.$.value" << kBytes));
-                            
-          auto cmd = BSON("findandmodify" << "users" <<
-                          "query" << query <<
-                          "update" << update);
-                          
-          mongo::BSONObj result;
-          return conn.RunCommand(cmd, result) && 
-                 result["value"].type() != mongo::jstNULL;
-        };
-
-      auto doInsert = [&]() -> bool
-      {
-        auto query = QUERY("uid" << uid << "credits" << BSON("$not" << 
-                           BSON("$elemMatch" << BSON("section" << section))));
-        auto update = BSON("$push" << BSON("credits" << BSON("section" << section << "value" << kBytes)));
-        return conn.Update("users", query, update, false) > 0;
-      };
-      
-      if (updateExisting()) return;
-      if (doInsert()) return;
-      if (updateExisting()) return;
-
-      logs::Database("Unable to increment credits for UID %1%%2%", uid,
-                     !section.empty() ? " in section " + section : 
-                     std::string(""));
-    };
-  
-  asyncTasks.Assign(std::async(std::launch::async, doIncrement, user.id));
+  CreditLedger::Get().Credit(user.id, section, SeedCredits(section), kBytes);
 }
 
 bool User::DecrCredits(const std::string& section, long long kBytes, bool force)
 {
-  if (!kBytes) return true;
-  
-  mongo::BSONObjBuilder elemQuery;
-  elemQuery.append("section", section);
-  if (!force) elemQuery.append("value", BSON("$gte" << kBytes));
-  
-  auto query = BSON("uid" << user.id << 
-                    "credits" << BSON("$elemMatch" << elemQuery.obj()));
-                    
-  auto update = BSON("$inc" << BSON("credits.$.value" << -kBytes));
-                    
-  auto cmd = BSON("findandmodify" << "users" <<
-                  "query" << query <<
-                  "update" << update);
-  NoErrorConnection conn;                  
-  mongo::BSONObj result;
-  bool ret = conn.RunCommand(cmd, result);
-  return force || (ret && result["value"].type() != mongo::jstNULL);
+  return CreditLedger::Get().Debit(user.id, section, SeedCredits(section), kBytes, force);
+}
+
+void User::SettleCredits(const std::string& section, long long reserved, long long actual)
+{
+  CreditLedger::Get().Settle(user.id, section, SeedCredits(section), reserved, actual);
+}
+
+long long User::SeedCredits(const std::string& section) const
+{
+  auto it = user.credits.find(section);
+  return it != user.credits.end() ? it->second : 0;
 }
 
 void User::Purge() const
 {
   NoErrorConnection conn;
   conn.Remove("users", QUERY("uid" << user.id));
+  CreditLedger::Get().Forget(user.id);
   UpdateLog();
 }
 
@@ -403,4 +361,18 @@ std::vector<acl::UserData> GetUsers(const std::string& multiStr)
   return GetUsersGeneric<acl::UserData>(multiStr, nullptr);
 }
 
+std::vector<acl::UserData> GetUsers(const std::vector<acl::UserID>& uids)
+{
+  if (uids.empty()) return std::vector<acl::UserData>();
+  
+  mongo::BSONArrayBuilder uidsBab;
+  for (auto uid : uids)
+  {
+    uidsBab.append(uid);
+  }
+  
+  NoErrorConnection conn;
+  return conn.QueryMulti<acl::UserData>("users", QUERY("uid" << BSON("$in" << uidsBab.arr())));
+}
+
 } /* db namespace */
@@ -44,6 +44,7 @@ class User
 
   void UpdateLog() const;
   void SaveField(const std::string& field, bool updateLog = true) const;
+  long long SeedCredits(const std::string& section) const;
   
 public:
   User(acl::UserData& user) :  user(user) { }
@@ -69,8 +70,10 @@ public:
   void SaveMaxSimUp();
   void SaveLoggedIn();
   void SaveRatio();
+  long long Credits(const std::string& section) const;
   void IncrCredits(const std::string& section, long long kBytes);
   bool DecrCredits(const std::string& section, long long kBytes, bool force);
+  void SettleCredits(const std::string& section, long long reserved, long long actual);
   
   void Purge() const;
   
@@ -80,6 +83,7 @@ public:
 
 std::vector<acl::UserID> GetUIDs(const std::string& multiStr = "*");
 std::vector<acl::UserData> GetUsers(const std::string& multiStr = "*");
+std::vector<acl::UserData> GetUsers(const std::vector<acl::UserID>& uids);
 
 } /* db namespace */
 
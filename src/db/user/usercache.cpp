@@ -13,7 +13,9 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <unordered_set>
 #include "db/user/usercache.hpp"
+#include "db/user/creditledger.hpp"
 #include "db/connection.hpp"
 #include "util/string.hpp"
 #include "db/user/user.hpp"
@@ -66,75 +68,104 @@ bool UserCache::IdentIPAllowed(const std::string& identAddress, acl::UserID uid)
   return util::WildcardMatch(it->second, identAddress, true);
 }
 
-bool UserCache::Replicate(const mongo::BSONElement& id)
+bool UserCache::Replicate(const std::vector<int>& ids)
 {
-  if (id.type() != 16) return true;
-  acl::UserID uid = id.Int();
-
-  updatedCallback(uid);
+  for (acl::UserID uid : ids)
+  {
+    updatedCallback(uid);
+  }
   
+  std::vector<mongo::BSONObj> results;
+  auto& ledger = CreditLedger::Get();
+  auto since = ledger.Generation();
   try
   {
-    SafeConnection conn;  
-    auto fields = BSON("uid" << 1 << "name" << 1 << "primary gid" << 1);
-    auto data = conn.QueryOne<UserTriple>("users", QUERY("uid" << uid), &fields);
-    if (data)
-    {
-      // user found, refresh cached data
-      {
-        std::lock_guard<std::mutex> lock(uidsMutex);
-        uids[data->name] = data->uid;
-      }
-      
-      {
-        std::lock_guard<std::mutex> lock(namesMutex);
-        names[data->uid] = data->name;
-      }
-      
-      {
-        std::lock_guard<std::mutex> lock(primaryGidsMutex);
-        primaryGids[data->uid] = data->primaryGid;
-      }
-      
-      auto masks = LookupIPMasks(conn, uid);
-      
-      {
-        std::lock_guard<std::mutex> lock(ipMasksMutex);
-        ipMasks[data->uid] = std::move(masks);
-      }
-    }
-    else
+    mongo::BSONArrayBuilder bab;
+    for (acl::UserID uid : ids)
     {
-      // user not found, must be deleted, remove from cache
-      {
-        std::lock(uidsMutex, namesMutex);
-        std::lock_guard<std::mutex> uidsLock(uidsMutex, std::adopt_lock);
-        std::lock_guard<std::mutex> namesLock(namesMutex, std::adopt_lock);
-        
-        auto it = names.find(uid);
-        if (it != names.end())
-        {
-          uids.erase(it->second);
-          names.erase(it);
-        }
-      }
-      
-      {
-        std::lock_guard<std::mutex> lock(primaryGidsMutex);
-        primaryGids.erase(uid);
-      }
-      
-      {
-        std::lock_guard<std::mutex> lock(ipMasksMutex);
-        ipMasks.erase(uid);
-      }
+      bab.append(uid);
     }
+    
+    SafeConnection conn;
+    auto fields = BSON("uid" << 1 << "name" << 1 << "primary gid" << 1 << 
+                       "ip masks" << 1 << "credits" << 1);
+    results = conn.Query("users", QUERY("uid" << BSON("$in" << bab.arr())), 0, 0, &fields);
   }
   catch (const DBError&)
   {
     return false;
   }
   
+  std::lock(namesMutex, uidsMutex, primaryGidsMutex, ipMasksMutex);
+  std::lock_guard<std::mutex> namesLock(namesMutex, std::adopt_lock);
+  std::lock_guard<std::mutex> uidsLock(uidsMutex, std::adopt_lock);
+  std::lock_guard<std::mutex> primaryGidsLock(primaryGidsMutex, std::adopt_lock);
+  std::lock_guard<std::mutex> ipMasksLock(ipMasksMutex, std::adopt_lock);
+  
+  // users found, refresh cached data
+  std::unordered_set<acl::UserID> found;
+  for (const auto& obj : results)
+  {
+    UserTriple data;
+    try
+    {
+      data = Unserialize<UserTriple>(obj);
+    }
+    catch (const mongo::DBException& e)
+    {
+      LogException("Unserialize user", e, obj);
+      continue;
+    }
+    
+    std::vector<std::string> masks;
+    try
+    {
+      UnserializeContainer(obj["ip masks"].Array(), masks);
+    }
+    catch (const mongo::DBException& e)
+    {
+      LogException("Unserialize ip masks", e, obj);
+    }
+    
+    // credits may have been changed by another node or the tools
+    try
+    {
+      std::unordered_map<std::string, long long> credits;
+      UnserializeMap(obj["credits"].Array(), "section", "value", credits);
+      ledger.Reconcile(data.uid, credits, since);
+    }
+    catch (const mongo::DBException& e)
+    {
+      LogException("Unserialize credits", e, obj);
+    }
+    
+    auto it = names.find(data.uid);
+    if (it != names.end() && it->second != data.name) uids.erase(it->second);
+    
+    uids[data.name] = data.uid;
+    names[data.uid] = data.name;
+    primaryGids[data.uid] = data.primaryGid;
+    ipMasks[data.uid] = std::move(masks);
+    found.insert(data.uid);
+  }
+  
+  // users not found, must be deleted, remove from cache
+  for (acl::UserID uid : ids)
+  {
+    if (found.find(uid) != found.end()) continue;
+    
+    auto it = names.find(uid);
+    if (it != names.end())
+    {
+      uids.erase(it->second);
+      names.erase(it);
+    }
+    
+    primaryGids.erase(uid);
+    ipMasks.erase(uid);
+    ledger.Forget(uid);
+  }
+  
   return true;
 }
 
@@ -25,11 +25,6 @@
 #include "db/replicable.hpp"
 #include "db/user/usercachebase.hpp"
 
-namespace mongo
-{
-class BSONElement;
-}
-
 namespace db
 {
 
@@ -63,7 +58,7 @@ public:
   bool IdentIPAllowed(const std::string& identAddress);
   bool IdentIPAllowed(const std::string& identAddress, acl::UserID uid);
 
-  bool Replicate(const mongo::BSONElement& id);
+  bool Replicate(const std::vector<int>& ids);
   bool Populate();  
 };
 
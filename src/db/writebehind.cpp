@@ -0,0 +1,243 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <algorithm>
+#include <vector>
+#include "db/writebehind.hpp"
+#include "db/connection.hpp"
+#include "db/error.hpp"
+#include "cfg/get.hpp"
+#include "logs/logs.hpp"
+#include "util/misc.hpp"
+#include "util/verify.hpp"
+
+namespace db
+{
+
+namespace
+{
+
+// a unique index already holding the entry, as the direct
+// unacknowledged inserts these replace would have silently hit
+bool DuplicateKey(const LastError& err)
+{
+  int code = err["code"].numberInt();
+  return code == 11000 || code == 11001;
+}
+
+}
+
+std::unique_ptr<WriteBehind> WriteBehind::instance;
+
+void WriteBehind::Insert(const std::string& collection, const mongo::BSONObj& obj)
+{
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    if (started)
+    {
+      if (pendingBytes + obj.objsize() > maximumBacklog)
+      {
+        ++dropped[collection];
+        return;
+      }
+      
+      pending[collection].emplace_back(obj.getOwned());
+      pendingBytes += obj.objsize();
+      if (++pendingCount >= flushThreshold) flushNeeded.notify_one();
+      return;
+    }
+  }
+  
+  // no writer thread, as in the standalone tools
+  FastConnection conn;
+  conn.Insert(collection, obj);
+}
+
+WriteBehind::Queue WriteBehind::Take(Batch::iterator it)
+{
+  Queue queue;
+  queue.swap(it->second);
+  pending.erase(it);
+  
+  pendingCount -= queue.size();
+  for (const auto& obj : queue)
+  {
+    pendingBytes -= obj.objsize();
+  }
+  
+  return queue;
+}
+
+void WriteBehind::Requeue(const std::string& collection, Queue& queue)
+{
+  boost::lock_guard<boost::mutex> lock(mutex);
+  
+  // the oldest entries give way first if the backlog has filled meanwhile
+  while (!queue.empty() && pendingBytes + queue.front().objsize() > maximumBacklog)
+  {
+    queue.pop_front();
+    ++dropped[collection];
+  }
+
+  Queue& requeued = pending[collection];
+  for (const auto& obj : queue)
+  {
+    pendingBytes += obj.objsize();
+  }
+  pendingCount += queue.size();
+  requeued.insert(requeued.begin(), queue.begin(), queue.end());
+}
+
+bool WriteBehind::Write(const std::string& collection, Queue& queue)
+{
+  try
+  {
+    SafeConnection conn;
+    const std::string ns = cfg::Get().Database().Name() + "." + collection;
+    
+    // each batch is acknowledged once, so a lost connection is noticed and
+    // the batch requeued rather than silently dropped with the socket
+    while (!queue.empty())
+    {
+      size_t count = std::min(queue.size(), maximumBatch);
+      std::vector<mongo::BSONObj> batch(queue.begin(), queue.begin() + count);
+      
+      {
+        boost::this_thread::disable_interruption noInterrupt;
+        conn.BaseConn().insert(ns, batch, mongo::InsertOption_ContinueOnError);
+        auto err = conn.GetLastError();
+        if (!err.Okay() && !DuplicateKey(err))
+        {
+          LogLastError("Write behind insert", err, collection, count);
+        }
+      }
+      
+      queue.erase(queue.begin(), queue.begin() + count);
+    }
+    
+    return true;
+  }
+  catch (const mongo::DBException& e)
+  {
+    LogException("Write behind insert", e, collection, queue.size());
+  }
+  catch (const DBError&)
+  {
+    // failed connection
+  }
+  
+  return false;
+}
+
+bool WriteBehind::Flush()
+{
+  boost::lock_guard<boost::mutex> writeLock(writeMutex);
+  
+  Batch batch;
+  std::map<std::string, long long> discarded;
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    batch.swap(pending);
+    discarded.swap(dropped);
+    pendingCount = 0;
+    pendingBytes = 0;
+  }
+  
+  for (const auto& kv : discarded)
+  {
+    logs::Database("Write behind queue full, discarded %1% %2% inserts", kv.second, kv.first);
+  }
+  
+  bool okay = true;
+  for (auto& kv : batch)
+  {
+    if (!Write(kv.first, kv.second))
+    {
+      logs::Database("Failed to write %1% %2% inserts, will retry", kv.second.size(), kv.first);
+      Requeue(kv.first, kv.second);
+      okay = false;
+    }
+  }
+  
+  return okay;
+}
+
+void WriteBehind::Sync(const std::string& collection)
+{
+  boost::lock_guard<boost::mutex> writeLock(writeMutex);
+  
+  Queue queue;
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    auto it = pending.find(collection);
+    if (it == pending.end()) return;
+    queue = Take(it);
+  }
+  
+  if (!Write(collection, queue)) Requeue(collection, queue);
+}
+
+void WriteBehind::Run()
+{
+  util::SetProcessTitle("WRITEBEHIND");
+  logs::SetThreadIDPrefix('B' /* write behind */);
+  
+  while (true)
+  {
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      flushNeeded.timed_wait(lock, boost::posix_time::seconds(flushInterval),
+                             [this]() { return pendingCount >= flushThreshold; });
+    }
+    
+    if (!Flush())
+    {
+      boost::this_thread::sleep(boost::posix_time::seconds(retryInterval));
+    }
+  }
+}
+
+void WriteBehind::Start()
+{
+  verify(!thread.joinable());
+  logs::Debug("Starting database write behind queue..");
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    started = true;
+  }
+  thread = boost::thread(&WriteBehind::Run, this);
+}
+
+void WriteBehind::Stop()
+{
+  // inserts from here on are written directly, so everything
+  // queued before this is covered by the final flush
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    started = false;
+  }
+  
+  if (thread.joinable())
+  {
+    logs::Debug("Stopping database write behind queue..");
+    thread.interrupt();
+    thread.join();
+  }
+  
+  Flush();
+}
+
+} /* db namespace */
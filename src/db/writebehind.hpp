@@ -0,0 +1,85 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __DB_WRITEBEHIND_HPP
+#define __DB_WRITEBEHIND_HPP
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <mongo/client/dbclient.h>
+
+namespace db
+{
+
+// queues inserts that are allowed to be lost and writes them from a
+// background thread as one multi document insert per collection, so
+// client threads never wait on the database for them. the queue is
+// bounded by maximumBacklog bytes, inserts beyond that are discarded
+// and counted. Stop writes out everything still queued
+class WriteBehind
+{
+  typedef std::deque<mongo::BSONObj> Queue;
+  typedef std::map<std::string, Queue> Batch;
+
+  boost::thread thread;
+  boost::mutex mutex;
+  boost::mutex writeMutex; // held while writing, keeps writes in order
+  boost::condition_variable flushNeeded;
+  Batch pending;
+  size_t pendingCount;
+  size_t pendingBytes;
+  std::map<std::string, long long> dropped;
+  bool started;
+  
+  static std::unique_ptr<WriteBehind> instance;
+  static const size_t flushThreshold = 1000;
+  static const size_t maximumBatch = 1000;
+  static const size_t maximumBacklog = 16 * 1024 * 1024;
+  static const long flushInterval = 1;
+  static const long retryInterval = 10;
+  
+  WriteBehind() : pendingCount(0), pendingBytes(0), started(false) { }
+  
+  void Run();
+  bool Flush();
+  Queue Take(Batch::iterator it);
+  void Requeue(const std::string& collection, Queue& queue);
+  static bool Write(const std::string& collection, Queue& queue);
+  
+public:
+  void Start();
+  void Stop();
+  
+  void Insert(const std::string& collection, const mongo::BSONObj& obj);
+  
+  // writes out anything queued for the collection on the calling thread,
+  // for when a synchronous write to it must not overtake a queued insert
+  void Sync(const std::string& collection);
+  
+  static WriteBehind& Get()
+  {
+    if (!instance) instance.reset(new WriteBehind());
+    return *instance;
+  }
+};
+
+} /* db namespace */
+
+#endif
@@ -33,7 +33,7 @@ LookupCheck(const std::vector<cfg::CheckScript>& checks, const fs::VirtualPath&
 {
   for (const auto& check : checks)
   {
-    if (util::WildcardMatch(check.Mask(), path.ToString()))
+    if (check.Mask().Match(path.ToString()))
     {
       if (check.Disabled()) break;
       return boost::optional<const fs::Path>(check.Path());
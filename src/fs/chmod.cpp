@@ -18,6 +18,7 @@
 #include <bitset>
 #include <sys/stat.h>
 #include "fs/chmod.hpp"
+#include "fs/dircache.hpp"
 #include "acl/user.hpp"
 #include "fs/mode.hpp"
 #include "util/path/status.hpp"
@@ -41,6 +42,7 @@ util::Error Chmod(const RealPath& path, const Mode& mode)
   catch (const util::SystemError& e)
   { return util::Error::Failure(e.Errno()); }
   
+  InvalidateListing(path);
   return util::Error::Success();
 }
 
@@ -73,6 +75,7 @@ util::Error Chmod(const acl::User& user, const VirtualPath& path, const Mode& mo
     return util::Error::Failure(e.Errno());
   }
   
+  InvalidateListing(MakeReal(path));
   return util::Error::Success();
 }
 
@@ -0,0 +1,312 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cerrno>
+#include <unordered_set>
+#include <poll.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+#include "fs/dircache.hpp"
+#include "fs/dirsize.hpp"
+#include "fs/path.hpp"
+#include "cfg/get.hpp"
+#include "logs/logs.hpp"
+#include "util/error.hpp"
+#include "util/path/path.hpp"
+#include "util/verify.hpp"
+
+namespace fs
+{
+
+std::unique_ptr<DirCache> DirCache::instance;
+const boost::posix_time::milliseconds DirCache::pollInterval(100);
+const std::chrono::milliseconds DirCache::modifyInterval(1000);
+
+DirCache::~DirCache()
+{
+  Stop();
+}
+
+void DirCache::Invalidate(Directory& directory)
+{
+  ++directory.version;
+  if (directory.snapshot)
+  {
+    totalEntries -= directory.snapshot->entries.size();
+    directory.snapshot.reset();
+  }
+}
+
+void DirCache::Invalidate(const RealPath& path)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = directories.find(path.ToString());
+  if (it != directories.end()) Invalidate(it->second);
+}
+
+void DirCache::Evict(size_t capacity)
+{
+  while (!lru.empty() && (totalEntries > capacity || directories.size() > maximumDirectories))
+  {
+    Remove(directories.find(lru.back()), true);
+  }
+}
+
+DirCacheStats DirCache::Stats()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  DirCacheStats stats;
+  stats.hits = hits;
+  stats.misses = misses;
+  stats.directories = 0;
+  for (const auto& kv : directories)
+  {
+    if (kv.second.snapshot) ++stats.directories;
+  }
+  stats.entries = totalEntries;
+  return stats;
+}
+
+#if defined(__linux__)
+
+void DirCache::Remove(std::unordered_map<std::string, Directory>::iterator it, bool watched)
+{
+  verify(it != directories.end());
+  // no longer watched, so changes to it would go unnoticed
+  DirSizeIndex::Get().Invalidate(RealPath(it->first));
+  if (it->second.snapshot) totalEntries -= it->second.snapshot->entries.size();
+  if (watched && fd >= 0) inotify_rm_watch(fd, it->second.wd);
+  watches.erase(it->second.wd);
+  lru.erase(it->second.lru);
+  directories.erase(it);
+}
+
+DirSnapshotPtr DirCache::Snapshot(const RealPath& path, bool owners)
+{
+  long long capacity = cfg::Get().DirCache();
+  if (capacity <= 0 || fd < 0) return ReadSnapshot(path, owners);
+  
+  std::string key(path.ToString());
+  unsigned long version;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = directories.find(key);
+    if (it != directories.end())
+    {
+      lru.splice(lru.begin(), lru, it->second.lru);
+      auto& snapshot = it->second.snapshot;
+      if (snapshot && (!owners || snapshot->owners))
+      {
+        ++hits;
+        return snapshot;
+      }
+    }
+    else
+    {
+      // watch before reading so nothing changing in between is missed
+      int wd = inotify_add_watch(fd, key.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | 
+                                 IN_MOVED_TO | IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE | 
+                                 IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+      if (wd < 0 || watches.count(wd))
+      {
+        // not watchable or the same directory by another path, 
+        // caching it under both would miss invalidations
+        ++misses;
+        return ReadSnapshot(path, owners);
+      }
+      
+      lru.push_front(key);
+      Directory directory;
+      directory.wd = wd;
+      directory.version = 0;
+      directory.lru = lru.begin();
+      it = directories.insert(std::make_pair(key, directory)).first;
+      watches[wd] = key;
+    }
+    
+    ++misses;
+    version = it->second.version;
+  }
+  
+  auto snapshot = ReadSnapshot(path, owners);
+  
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = directories.find(key);
+  if (it != directories.end() && it->second.version == version)
+  {
+    Invalidate(it->second);
+    it->second.snapshot = snapshot;
+    totalEntries += snapshot->entries.size();
+    Evict(capacity);
+  }
+  return snapshot;
+}
+
+void DirCache::Run()
+{
+  std::vector<char> buffer(64 * (sizeof(struct inotify_event) + NAME_MAX + 1));
+  std::unordered_set<std::string> modified;
+  auto modifiedDue = std::chrono::steady_clock::now();
+  while (true)
+  {
+    boost::this_thread::interruption_point();
+    
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    int n = poll(&pfd, 1, pollInterval.total_milliseconds());
+    if (n < 0 && errno != EINTR)
+    {
+      logs::Error("Error while polling inotify descriptor: %1%", util::Error::Failure(errno).Message());
+      boost::this_thread::sleep(pollInterval);
+      continue;
+    }
+    
+    if (!modified.empty() && std::chrono::steady_clock::now() >= modifiedDue)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (const std::string& key : modified)
+      {
+        auto it = directories.find(key);
+        if (it == directories.end()) continue;
+        Invalidate(it->second);
+        DirSizeIndex::Get().Invalidate(RealPath(key));
+      }
+      modified.clear();
+    }
+    
+    if (n <= 0) continue;
+    
+    ssize_t len = read(fd, buffer.data(), buffer.size());
+    if (len <= 0) continue;
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const char* p = buffer.data(); p < buffer.data() + len; )
+    {
+      auto event = reinterpret_cast<const struct inotify_event*>(p);
+      p += sizeof(struct inotify_event) + event->len;
+      
+      if (event->mask & IN_Q_OVERFLOW)
+      {
+        for (auto& kv : directories)
+        {
+          Invalidate(kv.second);
+        }
+        DirSizeIndex::Get().Invalidate();
+        continue;
+      }
+      
+      auto wit = watches.find(event->wd);
+      if (wit == watches.end()) continue;
+      auto dit = directories.find(wit->second);
+      verify(dit != directories.end());
+      
+      if (event->mask & IN_IGNORED) 
+      {
+        Remove(dit, false);
+        continue;
+      }
+      
+      if (event->mask == IN_MODIFY)
+      {
+        // fires for every write during an upload, so the growing size
+        // is picked up at most once per modifyInterval
+        if (modified.empty()) modifiedDue = std::chrono::steady_clock::now() + modifyInterval;
+        modified.insert(dit->first);
+        continue;
+      }
+      
+      Invalidate(dit->second);
+      DirSizeIndex::Get().Invalidate(RealPath(dit->first));
+      // the directory's own mtime changed, which its parent lists
+      if (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))
+      {
+        auto pit = directories.find(util::path::Dirname(dit->first));
+        if (pit != directories.end()) Invalidate(pit->second);
+      }
+    }
+  }
+}
+
+void DirCache::Start()
+{
+  verify(!thread.joinable());
+  fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0)
+  {
+    logs::Error("Unable to initialise inotify, directory cache disabled: %1%",
+                util::Error::Failure(errno).Message());
+    return;
+  }
+  
+  logs::Debug("Starting directory cache..");
+  thread = boost::thread(&DirCache::Run, this);
+}
+
+#else
+
+void DirCache::Remove(std::unordered_map<std::string, Directory>::iterator /* it */, 
+                      bool /* watched */)
+{
+}
+
+DirSnapshotPtr DirCache::Snapshot(const RealPath& path, bool owners)
+{
+  return ReadSnapshot(path, owners);
+}
+
+void DirCache::Run()
+{
+}
+
+void DirCache::Start()
+{
+}
+
+#endif
+
+void DirCache::Stop()
+{
+  if (thread.joinable())
+  {
+    logs::Debug("Stopping directory cache..");
+    thread.interrupt();
+    thread.join();
+  }
+  
+  std::lock_guard<std::mutex> lock(mutex);
+  directories.clear();
+  watches.clear();
+  lru.clear();
+  totalEntries = 0;
+  
+  if (fd >= 0)
+  {
+    close(fd);
+    fd = -1;
+  }
+}
+
+void InvalidateListing(const RealPath& path)
+{
+  // the parent's listing of the directory changed shows its new mtime
+  DirCache::Get().Invalidate(path.Dirname());
+  DirCache::Get().Invalidate(path.Dirname().Dirname());
+  DirSizeIndex::Get().Invalidate(path.Dirname());
+}
+
+} /* fs namespace */
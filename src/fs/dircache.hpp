@@ -0,0 +1,103 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __FS_DIRCACHE_HPP
+#define __FS_DIRCACHE_HPP
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include "fs/direnumerator.hpp"
+
+namespace fs
+{
+
+class RealPath;
+
+struct DirCacheStats
+{
+  unsigned long long hits;
+  unsigned long long misses;
+  size_t directories;
+  size_t entries;
+};
+
+// least recently used directory snapshots shared by all clients, bounded
+// by the total number of entries held. each cached directory is watched
+// with inotify and dropped when anything in it changes, or at most once
+// per modifyInterval for writes to files in it. the fs functions that
+// modify directories also invalidate them directly so our own changes
+// are visible straight away
+class DirCache
+{
+  struct Directory
+  {
+    DirSnapshotPtr snapshot;
+    int wd;
+    unsigned long version;
+    std::list<std::string>::iterator lru;
+  };
+  
+  int fd;
+  boost::thread thread;
+  std::mutex mutex;
+  std::unordered_map<std::string, Directory> directories;
+  std::unordered_map<int, std::string> watches;
+  std::list<std::string> lru;
+  size_t totalEntries;
+  unsigned long long hits;
+  unsigned long long misses;
+  
+  static std::unique_ptr<DirCache> instance;
+  static const size_t maximumDirectories = 4096;
+  static const boost::posix_time::milliseconds pollInterval;
+  static const std::chrono::milliseconds modifyInterval;
+  
+  DirCache() : fd(-1), totalEntries(0), hits(0), misses(0) { }
+  
+  void Run();
+  void Invalidate(Directory& directory);
+  void Remove(std::unordered_map<std::string, Directory>::iterator it, bool watched);
+  void Evict(size_t capacity);
+  
+public:
+  ~DirCache();
+  
+  void Start();
+  void Stop();
+  
+  DirSnapshotPtr Snapshot(const RealPath& path, bool owners);
+  void Invalidate(const RealPath& path);
+  DirCacheStats Stats();
+  
+  static DirCache& Get()
+  {
+    if (!instance) instance.reset(new DirCache());
+    return *instance;
+  }
+};
+
+// invalidates the cached listing and size of the directory containing path,
+// and the listing of the directory above that
+void InvalidateListing(const RealPath& path);
+
+} /* fs namespace */
+
+#endif
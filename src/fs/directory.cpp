@@ -18,6 +18,10 @@
 #include <cassert>
 #include <boost/thread/tss.hpp>
 #include "fs/directory.hpp"
+#include "fs/dircache.hpp"
+#include "fs/dirsize.hpp"
+#include "fs/realpathcache.hpp"
+#include "fs/ledger.hpp"
 #include "util/path/status.hpp"
 #include "acl/user.hpp"
 #include "fs/owner.hpp"
@@ -134,6 +138,7 @@ util::Error ChangeCdpath(const acl::User& user, const fs::Path& path, VirtualPat
 util::Error CreateDirectory(const RealPath& path)
 {
   if (mkdir(MakeReal(path).CString(), 0777) < 0) return util::Error::Failure(errno);
+  InvalidateListing(path);
   return util::Error::Success();
 }
 
@@ -143,13 +148,20 @@ util::Error CreateDirectory(const acl::User& user, const VirtualPath& path)
   if (!e) return e;
 
   e = CreateDirectory(MakeReal(path));  
-  if (e) SetOwner(MakeReal(path), Owner(user.ID(), user.PrimaryGID()));
+  if (e)
+  {
+    SetOwner(MakeReal(path), Owner(user.ID(), user.PrimaryGID()));
+    CreateLedger(MakeReal(path));
+  }
   return e;
 }
 
 util::Error RemoveDirectory(const RealPath& path)
 {
   if (rmdir(MakeReal(path).CString()) < 0) return util::Error::Failure(errno);
+  DirSizeIndex::Get().Remove(path);
+  RealpathCache::Get().Invalidate();
+  InvalidateListing(path);
   return util::Error::Success();
 }
 
@@ -191,49 +203,17 @@ util::Error RenameDirectory(const RealPath& oldPath, const RealPath& newPath)
   if (rename(oldPath.CString(), newPath.CString()) < 0) 
     return util::Error::Failure(errno);
     
+  DirSizeIndex::Get().Remove(oldPath);
+  RealpathCache::Get().Invalidate();
+  InvalidateListing(oldPath);
+  InvalidateListing(newPath);
   return util::Error::Success();
 }
 
-util::Error DirectorySize(const RealPath& path, int depth, long long& kBytes, bool ignoreHidden)
+util::Error DirectorySize(const RealPath& path, int depth, long long& kBytes, 
+                          bool ignoreHidden, bool verify)
 {
-  kBytes = 0;
-  if (depth < 0) return util::Error::Failure(EINVAL);
-  if (depth == 0) return util::Error::Success();
-  
-  try
-  {
-    for (auto& entry : util::path::DirContainer(path.ToString()))
-    {
-      if (ignoreHidden && entry[0] == '.') continue;
-      try
-      {
-        auto entryPath = path / entry;
-        util::path::Status status(entryPath.ToString());
-        if (status.IsDirectory())
-        {
-          if (!status.IsSymLink())
-          {
-            long long subKBytes;
-            if (DirectorySize(entryPath, depth - 1, subKBytes, ignoreHidden))
-              kBytes += subKBytes;
-          }
-        }
-        else
-        if (status.IsRegularFile())
-        {
-          kBytes += status.Size() / 1024;
-        }
-      }
-      catch (const util::SystemError& e)
-      { }
-    }
-  }
-  catch (const util::SystemError& e)
-  {
-    return util::Error::Failure(e.Errno());
-  }
-  
-  return util::Error::Success();
+  return DirSizeIndex::Get().Lookup(path, depth, ignoreHidden, verify, kBytes);
 }
 
 } /* fs namespace */
@@ -48,8 +48,10 @@ util::Error ChangeMatch(const acl::User& user, const VirtualPath& path, VirtualP
 util::Error ChangeCdpath(const acl::User& user, const Path& path, VirtualPath& match);
 util::Error ChangeDirectory(const acl::User& user, const VirtualPath& path);
 
+// served from the directory size index, verify rescans every
+// directory counted instead of trusting the index
 util::Error DirectorySize(const RealPath& path, int depth, long long& kBytes, 
-                          bool ignoreHidden);
+                          bool ignoreHidden, bool verify = false);
 
 const VirtualPath& WorkDirectory();
 void SetWorkDirectory(const VirtualPath& path);
@@ -16,13 +16,22 @@
 #include <cassert>
 #include <memory>
 #include <cstring>
+#include <atomic>
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <sys/sysmacros.h>
+#endif
 #include "fs/direnumerator.hpp"
+#include "fs/dircache.hpp"
 #include "acl/user.hpp"
 #include "acl/path.hpp"
 #include "cfg/config.hpp"
 #include "cfg/get.hpp"
 #include "logs/logs.hpp"
+#include "util/scopeguard.hpp"
 
 namespace fs
 {
@@ -67,19 +76,109 @@ void DirEnumerator::Readdir(const acl::User& user, const fs::VirtualPath& path,
   Readdir();
 }
 
-void DirEnumerator::Readdir()
+#if defined(__linux__)
+
+namespace
 {
-  namespace PP = acl::path;
 
-  if (user && !PP::DirAllowed<PP::View>(*user, MakeVirtual(path))) 
+const size_t direntBufferSize = 64 * 1024;
+
+#if defined(STATX_TYPE)
+// only what a listing uses, the rest of struct stat is left zeroed
+const unsigned statxMask = STATX_TYPE | STATX_MODE | STATX_NLINK | STATX_UID |
+                           STATX_GID | STATX_SIZE | STATX_MTIME | STATX_INO;
+std::atomic<bool> statxMissing(false);
+#endif
+
+bool StatAt(int dirfd, const char* name, struct stat& st)
+{
+#if defined(STATX_TYPE)
+  if (!statxMissing.load(std::memory_order_relaxed))
   {
-    return;
+    struct statx stx;
+    if (statx(dirfd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, statxMask, &stx) == 0)
+    {
+      memset(&st, 0, sizeof(st));
+      st.st_dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+      st.st_ino = stx.stx_ino;
+      st.st_mode = stx.stx_mode;
+      st.st_nlink = stx.stx_nlink;
+      st.st_uid = stx.stx_uid;
+      st.st_gid = stx.stx_gid;
+      st.st_size = stx.stx_size;
+      st.st_mtim.tv_sec = stx.stx_mtime.tv_sec;
+      st.st_mtim.tv_nsec = stx.stx_mtime.tv_nsec;
+      return true;
+    }
+    
+    if (errno != ENOSYS) return false;
+    statxMissing = true;
+  }
+#endif
+  return fstatat(dirfd, name, &st, AT_SYMLINK_NOFOLLOW) == 0;
+}
+
+}
+
+// the directory is opened once and everything else is relative to its fd,
+// so the kernel only has to look up the final component for each entry
+DirSnapshotPtr ReadSnapshot(const fs::RealPath& path, bool loadOwners)
+{
+  int fd = open(path.CString(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) throw util::SystemError(errno);
+  auto fdGuard = util::MakeScopeExit([fd]{ close(fd); });
+  
+  auto snapshot = std::make_shared<DirSnapshot>(loadOwners);
+  std::unique_ptr<char[]> buffer(new char[direntBufferSize]);
+  while (true)
+  {
+    ssize_t len = getdents64(fd, buffer.get(), direntBufferSize);
+    if (len < 0)
+    {
+      if (errno == EINTR) continue;
+      throw util::SystemError(errno);
+    }
+    if (len == 0) break;
+    
+    for (ssize_t pos = 0; pos < len;)
+    {
+      const struct dirent64* de = reinterpret_cast<const struct dirent64*>(buffer.get() + pos);
+      pos += de->d_reclen;
+      
+      const char* name = de->d_name;
+      if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+      struct stat native;
+      if (!StatAt(fd, name, native)) continue;
+      
+      mode_t linkMode = 0;
+      if (S_ISLNK(native.st_mode))
+      {
+        struct stat target;
+        if (fstatat(fd, name, &target, 0) == 0) linkMode = target.st_mode;
+      }
+      
+      util::path::Status status(native, linkMode);
+      snapshot->totalBytes += status.Size();
+      
+      Owner owner(0, 0);
+      if (loadOwners) owner = GetOwnerAt(fd, path, name);
+      snapshot->entries.emplace_back(fs::Path(name), status, owner);
+    }
   }
+  
+  return snapshot;
+}
 
+#else
+
+DirSnapshotPtr ReadSnapshot(const fs::RealPath& path, bool loadOwners)
+{
   DIR* dp = opendir(path.CString());
   if (!dp) throw util::SystemError(errno);
   std::shared_ptr<DIR> dpGuard(dp, closedir);
   
+  auto snapshot = std::make_shared<DirSnapshot>(loadOwners);
   struct dirent de;
   struct dirent* dep;
   while (true)
@@ -94,39 +193,57 @@ void DirEnumerator::Readdir()
     try
     {
       util::path::Status status(entryPath.ToString());
-      totalBytes += status.Size();
+      snapshot->totalBytes += status.Size();
       
-      if (user)
-      {
-        fs::VirtualPath virtPath(MakeVirtual(entryPath));
-        util::Error hideOwner;
-        if (status.IsDirectory())
-        {
-          if (!PP::DirAllowed<PP::View>(*user, virtPath)) continue;
-          hideOwner = PP::DirAllowed<PP::Hideowner>(*user, virtPath);
-        }
-        else
-        {
-          if (!PP::FileAllowed<PP::View>(*user, virtPath)) continue;
-          hideOwner = PP::FileAllowed<PP::Hideowner>(*user, virtPath);
-        }
-        
-        Owner owner(0, 0);
-        if (!hideOwner && loadOwners) owner = GetOwner(entryPath);
-        entries.emplace_back(fs::Path(de.d_name), status, owner);
-      }
-      else
-      {
-        Owner owner(0, 0);
-        if (loadOwners) owner = GetOwner(entryPath);
-        entries.emplace_back(fs::Path(de.d_name), status, owner);
-      }
+      Owner owner(0, 0);
+      if (loadOwners) owner = GetOwner(entryPath);
+      snapshot->entries.emplace_back(fs::Path(de.d_name), status, owner);
     }
     catch (const util::SystemError&)
     {
       continue;
     }
   }
+  
+  return snapshot;
+}
+
+#endif
+
+void DirEnumerator::Readdir()
+{
+  namespace PP = acl::path;
+
+  if (user && !PP::DirAllowed<PP::View>(*user, MakeVirtual(path))) 
+  {
+    return;
+  }
+
+  auto snapshot = DirCache::Get().Snapshot(path, loadOwners);
+  totalBytes += snapshot->totalBytes;
+  
+  fs::VirtualPath virtPath;
+  if (user) virtPath = MakeVirtual(path);
+  
+  for (const auto& entry : snapshot->entries)
+  {
+    if (user)
+    {
+      bool isDirectory = entry.Status().IsDirectory();
+      if (!PP::EntryAllowed<PP::View>(*user, virtPath, entry.Path(), isDirectory)) continue;
+      util::Error hideOwner = PP::EntryAllowed<PP::Hideowner>(*user, virtPath, entry.Path(), 
+                                                              isDirectory);
+      
+      Owner owner(0, 0);
+      if (!hideOwner && loadOwners) owner = entry.Owner();
+      entries.emplace_back(entry.Path(), entry.Status(), owner);
+    }
+    else
+    {
+      entries.emplace_back(entry.Path(), entry.Status(), 
+                           loadOwners ? entry.Owner() : Owner(0, 0));
+    }
+  }
 }
 
 } /* fs namespace */
@@ -16,6 +16,7 @@
 #ifndef __UTIL_FS_DIRENUMERATOR_HPP
 #define __UTIL_FS_DIRENUMERATOR_HPP
 
+#include <memory>
 #include <string>
 #include <vector>
 #include "fs/path.hpp"
@@ -46,6 +47,20 @@ public:
   const fs::Owner& Owner() const { return owner; }
 };
 
+// everything in a directory as read from disk, before any acl filtering
+struct DirSnapshot
+{
+  std::vector<DirEntry> entries;
+  unsigned long long totalBytes;
+  bool owners;
+  
+  DirSnapshot(bool owners) : totalBytes(0), owners(owners) { }
+};
+
+typedef std::shared_ptr<const DirSnapshot> DirSnapshotPtr;
+
+DirSnapshotPtr ReadSnapshot(const fs::RealPath& path, bool loadOwners);
+
 class DirEnumerator
 {
   const acl::User* user;
@@ -0,0 +1,161 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cerrno>
+#include "fs/dirsize.hpp"
+#include "fs/direnumerator.hpp"
+#include "fs/dircache.hpp"
+#include "fs/path.hpp"
+#include "util/path/status.hpp"
+
+namespace fs
+{
+
+std::unique_ptr<DirSizeIndex> DirSizeIndex::instance;
+const std::chrono::minutes DirSizeIndex::reconcileInterval(10);
+
+util::Error DirSizeIndex::Scan(const std::string& path, Node& node, bool fromDisk)
+{
+  DirSnapshotPtr snapshot;
+  try
+  {
+    // through the directory cache so the directory is watched, its
+    // inotify events then mark this node stale as well. a verify or
+    // reconcile drops the cached snapshot first so it reads the disk
+    RealPath real(path);
+    if (fromDisk) DirCache::Get().Invalidate(real);
+    snapshot = DirCache::Get().Snapshot(real, false);
+  }
+  catch (const util::SystemError& e)
+  {
+    return util::Error::Failure(e.Errno());
+  }
+  
+  node = Node();
+  for (const auto& entry : snapshot->entries)
+  {
+    const std::string& name = entry.Path().ToString();
+    const util::path::Status& status = entry.Status();
+    bool hidden = name[0] == '.';
+    if (status.IsDirectory())
+    {
+      if (!status.IsSymLink()) node.subdirs.emplace_back(name, hidden);
+    }
+    else
+    if (status.IsRegularFile())
+    {
+      (hidden ? node.hiddenKBytes : node.kBytes) += status.Size() / 1024;
+    }
+  }
+  
+  node.scanned = std::chrono::steady_clock::now();
+  node.stale = false;
+  return util::Error::Success();
+}
+
+util::Error DirSizeIndex::Size(const std::string& path, int depth, bool ignoreHidden, 
+                               bool verify, long long& kBytes)
+{
+  kBytes = 0;
+  
+  Node node;
+  bool found = false;
+  bool fromDisk = verify;
+  unsigned long long scanGeneration;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = nodes.find(path);
+    if (it != nodes.end())
+    {
+      if (std::chrono::steady_clock::now() - it->second.scanned >= reconcileInterval)
+        fromDisk = true;
+      else
+      if (!verify && !it->second.stale)
+      {
+        node = it->second;
+        found = true;
+      }
+    }
+    scanGeneration = generation;
+  }
+  
+  if (!found)
+  {
+    auto e = Scan(path, node, fromDisk);
+    if (!e)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      nodes.erase(path);
+      return e;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    if (nodes.size() >= maximumNodes) nodes.clear();
+    Node& stored = nodes[path];
+    stored = node;
+    // a mutation during the scan may not be reflected in it
+    if (generation != scanGeneration) stored.stale = true;
+  }
+  
+  kBytes = node.kBytes;
+  if (!ignoreHidden) kBytes += node.hiddenKBytes;
+  if (depth <= 1) return util::Error::Success();
+  
+  for (const auto& subdir : node.subdirs)
+  {
+    if (ignoreHidden && subdir.second) continue;
+    long long subKBytes;
+    if (Size(path + "/" + subdir.first, depth - 1, ignoreHidden, verify, subKBytes))
+      kBytes += subKBytes;
+  }
+  
+  return util::Error::Success();
+}
+
+util::Error DirSizeIndex::Lookup(const RealPath& path, int depth, bool ignoreHidden, 
+                                 bool verify, long long& kBytes)
+{
+  kBytes = 0;
+  if (depth < 0) return util::Error::Failure(EINVAL);
+  if (depth == 0) return util::Error::Success();
+  return Size(path.ToString(), depth, ignoreHidden, verify, kBytes);
+}
+
+void DirSizeIndex::Invalidate(const RealPath& directory)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  ++generation;
+  auto it = nodes.find(directory.ToString());
+  if (it != nodes.end()) it->second.stale = true;
+}
+
+void DirSizeIndex::Invalidate()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  ++generation;
+  for (auto& kv : nodes) kv.second.stale = true;
+}
+
+void DirSizeIndex::Remove(const RealPath& path)
+{
+  const std::string& prefix = path.ToString();
+  std::lock_guard<std::mutex> lock(mutex);
+  ++generation;
+  nodes.erase(prefix);
+  // every descendant sorts between "prefix/" and "prefix0"
+  nodes.erase(nodes.lower_bound(prefix + '/'), nodes.lower_bound(prefix + '0'));
+}
+
+} /* fs namespace */
@@ -0,0 +1,92 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __FS_DIRSIZE_HPP
+#define __FS_DIRSIZE_HPP
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "util/error.hpp"
+
+namespace fs
+{
+
+class RealPath;
+
+// sizes of the regular files directly inside each directory, so that
+// totals for a release or a whole section are sums over cached nodes
+// instead of a stat of every file below it
+//
+// a node is rescanned when a mutation inside the directory marks it
+// stale, when it is older than the reconcile interval, or when the
+// caller asks for the result to be verified against disk. directories
+// are read through DirCache, whose inotify watch marks the node stale
+// on changes made outside the daemon too, and evicting it from the
+// cache marks it stale. verifying and reconciling drop the cached
+// snapshot first so they always read the disk, in case an event was
+// missed or the directory cache is disabled
+class DirSizeIndex
+{
+  struct Node
+  {
+    long long kBytes;       // files not starting with a dot
+    long long hiddenKBytes; // files starting with a dot
+    std::vector<std::pair<std::string, bool>> subdirs; // name, hidden
+    std::chrono::steady_clock::time_point scanned;
+    bool stale;
+    
+    Node() : kBytes(0), hiddenKBytes(0), stale(true) { }
+  };
+
+  std::mutex mutex;
+  std::map<std::string, Node> nodes;
+  unsigned long long generation;
+  
+  static std::unique_ptr<DirSizeIndex> instance;
+  static const size_t maximumNodes = 262144;
+  static const std::chrono::minutes reconcileInterval;
+  
+  DirSizeIndex() : generation(0) { }
+  
+  static util::Error Scan(const std::string& path, Node& node, bool fromDisk);
+  util::Error Size(const std::string& path, int depth, bool ignoreHidden, 
+                   bool verify, long long& kBytes);
+  
+public:
+  util::Error Lookup(const RealPath& path, int depth, bool ignoreHidden, 
+                     bool verify, long long& kBytes);
+  
+  // the contents of directory have changed
+  void Invalidate(const RealPath& directory);
+  // anything may have changed
+  void Invalidate();
+  
+  // path and everything below it no longer exists
+  void Remove(const RealPath& path);
+  
+  static DirSizeIndex& Get()
+  {
+    if (!instance) instance.reset(new DirSizeIndex());
+    return *instance;
+  }
+};
+
+} /* fs namespace */
+
+#endif
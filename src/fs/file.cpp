@@ -18,6 +18,10 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include "fs/file.hpp"
+#include "fs/dircache.hpp"
+#include "fs/dirsize.hpp"
+#include "fs/realpathcache.hpp"
+#include "fs/ledger.hpp"
 #include "acl/user.hpp"
 #include "fs/path.hpp"
 #include "fs/owner.hpp"
@@ -37,7 +41,12 @@ namespace fs
 
 util::Error DeleteFile(const RealPath& path)
 {
+  // only directories and symlinks are held in the realpath cache
+  struct stat st;
+  bool symlink = lstat(path.CString(), &st) == 0 && S_ISLNK(st.st_mode);
   if (unlink(path.CString()) < 0) return util::Error::Failure(errno);
+  if (symlink) RealpathCache::Get().Invalidate();
+  InvalidateListing(path);
   return util::Error::Success();
 }
 
@@ -47,27 +56,44 @@ util::Error DeleteFile(const acl::User& user, const VirtualPath& path,
   util::Error e = PP::FileAllowed<PP::Delete>(user, path);
   if (!e) return e;
   
-  if (size)
+  auto real = MakeReal(path);
+  off_t fileSize;
+  ino_t ino;
+  try
   {
-    try
+    util::path::Status status(real.ToString());
+    fileSize = status.Size();
+    ino = status.Native().st_ino;
+    if (size)
     {
-      util::path::Status status(MakeReal(path).ToString());
-      *size = status.Size();
+      *size = fileSize;
       *modTime = status.Native().st_mtime;
     }
-    catch (const util::SystemError& e)
-    {
-      return util::Error::Failure(e.Errno());
-    }
   }
-
-  return DeleteFile(MakeReal(path));
+  catch (const util::SystemError& e)
+  {
+    return util::Error::Failure(e.Errno());
+  }
+  
+  Owner owner = GetOwner(real);
+  e = DeleteFile(real);
+  if (e) UpdateLedger(real, owner.UID(), -(fileSize / 1024), -1, ino);
+  return e;
 }
 
 util::Error Rename(const RealPath& oldPath, const RealPath& newPath)
 {
   if (rename(oldPath.CString(), newPath.CString()) < 0) 
     return util::Error::Failure(errno);
+  DirSizeIndex::Get().Remove(oldPath);
+  RealpathCache::Get().Invalidate();
+  if (oldPath.Dirname() != newPath.Dirname())
+  {
+    InvalidateLedger(oldPath.Dirname());
+    InvalidateLedger(newPath.Dirname());
+  }
+  InvalidateListing(oldPath);
+  InvalidateListing(newPath);
   return util::Error::Success();
 }
 
@@ -96,6 +122,8 @@ FileSinkPtr CreateFile(const acl::User& user, const VirtualPath& path)
     fd = open(MakeReal(path).CString(), O_WRONLY | O_TRUNC);
     if (fd < 0) throw util::SystemError(errno);
   }
+  
+  InvalidateListing(MakeReal(path));
 
   SetOwner(MakeReal(path), Owner(user.ID(), user.PrimaryGID()));
 
@@ -142,6 +170,8 @@ FileSinkPtr AppendFile(const acl::User& user, const VirtualPath& path, off_t off
     throw util::SystemError(errno);
   }
   
+  InvalidateListing(real);
+  
   return fout;
 }
 
@@ -0,0 +1,189 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+#include "fs/follow.hpp"
+#include "fs/path.hpp"
+#include "logs/logs.hpp"
+#include "util/error.hpp"
+#include "util/verify.hpp"
+
+namespace fs
+{
+
+std::unique_ptr<FileFollower> FileFollower::instance;
+const boost::posix_time::milliseconds FileFollower::pollInterval(100);
+const boost::posix_time::seconds FollowedFile::waitTimeout(1);
+
+FollowedFile::~FollowedFile()
+{
+  FileFollower::Get().Release(wd);
+}
+
+void FollowedFile::Notify()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    ++generation;
+  }
+  changed.notify_all();
+}
+
+void FollowedFile::Wait(unsigned long generation)
+{
+  boost::unique_lock<boost::mutex> lock(mutex);
+  changed.timed_wait(lock, waitTimeout, [&]() { return this->generation != generation; });
+}
+
+FileFollower::~FileFollower()
+{
+  Stop();
+}
+
+#if defined(__linux__)
+
+void FileFollower::Run()
+{
+  std::vector<char> buffer(64 * (sizeof(struct inotify_event) + NAME_MAX + 1));
+  while (true)
+  {
+    boost::this_thread::interruption_point();
+    
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    int n = poll(&pfd, 1, pollInterval.total_milliseconds());
+    if (n < 0 && errno != EINTR)
+    {
+      logs::Error("Error while polling inotify descriptor: %1%", util::Error::Failure(errno).Message());
+      boost::this_thread::sleep(pollInterval);
+      continue;
+    }
+    if (n <= 0) continue;
+    
+    ssize_t len = read(fd, buffer.data(), buffer.size());
+    if (len <= 0) continue;
+    
+    std::vector<FollowedFilePtr> notify;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (const char* p = buffer.data(); p < buffer.data() + len; )
+      {
+        auto event = reinterpret_cast<const struct inotify_event*>(p);
+        auto it = files.find(event->wd);
+        if (it != files.end())
+        {
+          auto file = it->second.lock();
+          if (file) notify.emplace_back(file);
+        }
+        p += sizeof(struct inotify_event) + event->len;
+      }
+    }
+    
+    for (auto& file : notify)
+    {
+      file->Notify();
+    }
+  }
+}
+
+void FileFollower::Start()
+{
+  verify(!thread.joinable());
+  fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0)
+  {
+    logs::Error("Unable to initialise inotify, incomplete downloads will poll: %1%",
+                util::Error::Failure(errno).Message());
+    return;
+  }
+  
+  logs::Debug("Starting incomplete download follower..");
+  thread = boost::thread(&FileFollower::Run, this);
+}
+
+FollowedFilePtr FileFollower::Follow(const RealPath& path)
+{
+  if (fd < 0) return nullptr;
+  
+  std::lock_guard<std::mutex> lock(mutex);
+  int wd = inotify_add_watch(fd, path.CString(), IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | 
+                                                 IN_DELETE_SELF | IN_MOVE_SELF);
+  if (wd < 0) return nullptr;
+  
+  // the same inode always has the same watch descriptor, so every
+  // downloader of the file shares one watch whatever path they used
+  auto& weak = files[wd];
+  auto file = weak.lock();
+  if (!file)
+  {
+    file = std::make_shared<FollowedFile>(wd);
+    weak = file;
+  }
+  return file;
+}
+
+void FileFollower::Release(int wd)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = files.find(wd);
+  if (it == files.end() || !it->second.expired()) return;
+  files.erase(it);
+  if (fd >= 0) inotify_rm_watch(fd, wd);
+}
+
+#else
+
+void FileFollower::Run()
+{
+}
+
+void FileFollower::Start()
+{
+}
+
+FollowedFilePtr FileFollower::Follow(const RealPath& /* path */)
+{
+  return nullptr;
+}
+
+void FileFollower::Release(int /* wd */)
+{
+}
+
+#endif
+
+void FileFollower::Stop()
+{
+  if (thread.joinable())
+  {
+    logs::Debug("Stopping incomplete download follower..");
+    thread.interrupt();
+    thread.join();
+  }
+  
+  if (fd >= 0)
+  {
+    close(fd);
+    fd = -1;
+  }
+}
+
+} /* fs namespace */
@@ -0,0 +1,101 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __FS_FOLLOW_HPP
+#define __FS_FOLLOW_HPP
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace fs
+{
+
+class RealPath;
+
+// a file being downloaded while it's still being uploaded, shared by
+// every downloader following it. the generation is bumped whenever the
+// file is written to, closed, has its mode changed or goes away
+class FollowedFile
+{
+  int wd;
+  boost::mutex mutex;
+  boost::condition_variable changed;
+  unsigned long generation;
+  
+  static const boost::posix_time::seconds waitTimeout;
+  
+  void Notify();
+  
+public:
+  FollowedFile(int wd) : wd(wd), generation(0) { }
+  ~FollowedFile();
+  
+  unsigned long Generation()
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    return generation;
+  }
+  
+  // blocks until the generation moves on from the one passed or the
+  // timeout expires, take the generation before reading to not miss
+  // data appended in between
+  void Wait(unsigned long generation);
+  
+  friend class FileFollower;
+};
+
+typedef std::shared_ptr<FollowedFile> FollowedFilePtr;
+
+// single inotify descriptor and thread waking downloaders of growing files
+class FileFollower
+{
+  int fd;
+  boost::thread thread;
+  std::mutex mutex;
+  std::unordered_map<int, std::weak_ptr<FollowedFile>> files;
+
+  static std::unique_ptr<FileFollower> instance;
+  static const boost::posix_time::milliseconds pollInterval;
+  
+  FileFollower() : fd(-1) { }
+  
+  void Run();
+  void Release(int wd);
+  
+public:
+  ~FileFollower();
+
+  void Start();
+  void Stop();
+  
+  // returns nullptr if the file can't be watched, callers must poll instead
+  FollowedFilePtr Follow(const RealPath& path);
+  
+  static FileFollower& Get()
+  {
+    if (!instance) instance.reset(new FileFollower());
+    return *instance;
+  }
+  
+  friend class FollowedFile;
+};
+
+} /* fs namespace */
+
+#endif
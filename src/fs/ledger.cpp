@@ -0,0 +1,318 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "fs/ledger.hpp"
+#include "fs/path.hpp"
+#include "fs/owner.hpp"
+#include "util/path/extattr.hpp"
+#include "util/path/status.hpp"
+#include "util/error.hpp"
+#include "logs/logs.hpp"
+
+namespace fs
+{
+
+namespace
+{
+
+// the ledger is a header followed by one entry per uploader, all fields 
+// little endian:
+//
+//   0  u8   version
+//   1  u8   reserved
+//   2  u16  entry length
+//   4  u32  entry count
+//   8  u64  inode fingerprint
+//
+//   0  i32  uid
+//   4  i32  files
+//   8  i64  kbytes
+//
+// the fingerprint is the sum of InodeHash over the files counted, so a
+// file replaced or swapped for another outside the daemon, which leaves
+// the count alone, still shows up as a mismatch against the directory
+const char* ledgerAttributeName = "user.ebftpd.ledger";
+const uint8_t ledgerVersion = 2;
+const size_t ledgerHeaderLength = 16;
+const size_t ledgerEntryLength = 16;
+const size_t ledgerMaximum = 4096;
+
+// uploads into the same directory from different clients update the
+// same attribute, so each read modify write holds the directory's stripe
+const size_t lockStripes = 64;
+std::mutex ledgerMutexes[lockStripes];
+
+std::mutex& LedgerMutex(const std::string& directory)
+{
+  return ledgerMutexes[std::hash<std::string>()(directory) % lockStripes];
+}
+
+void EncodeInt(unsigned char* buf, uint64_t value, int bytes)
+{
+  for (int i = 0; i < bytes; ++i)
+  {
+    buf[i] = value & 0xff;
+    value >>= 8;
+  }
+}
+
+uint64_t DecodeInt(const unsigned char* buf, int bytes)
+{
+  uint64_t value = 0;
+  for (int i = bytes - 1; i >= 0; --i)
+  {
+    value = (value << 8) | buf[i];
+  }
+  return value;
+}
+
+uint64_t InodeHash(uint64_t ino)
+{
+  // splitmix64's finaliser, so nearby inode numbers don't cancel out
+  ino = (ino ^ (ino >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  ino = (ino ^ (ino >> 27)) * 0x94d049bb133111ebULL;
+  return ino ^ (ino >> 31);
+}
+
+bool ReadLedger(const std::string& directory, UploaderTotals& totals, uint64_t& fingerprint)
+{
+  unsigned char buf[ledgerMaximum];
+#if defined(__APPLE__)
+  ssize_t len = getxattr(directory.c_str(), ledgerAttributeName, buf, sizeof(buf), 0, 0);
+#else
+  ssize_t len = getxattr(directory.c_str(), ledgerAttributeName, buf, sizeof(buf));
+#endif
+  // earlier versions have no fingerprint and are never trusted
+  if (len < static_cast<ssize_t>(ledgerHeaderLength) || buf[0] < ledgerVersion) return false;
+  
+  size_t entryLength = DecodeInt(buf + 2, 2);
+  size_t count = DecodeInt(buf + 4, 4);
+  fingerprint = DecodeInt(buf + 8, 8);
+  if (entryLength < ledgerEntryLength || 
+      ledgerHeaderLength + count * entryLength > static_cast<size_t>(len))
+    return false;
+  
+  totals.clear();
+  for (size_t i = 0; i < count; ++i)
+  {
+    const unsigned char* entry = buf + ledgerHeaderLength + i * entryLength;
+    UploaderTotal& total = totals[static_cast<int32_t>(DecodeInt(entry, 4))];
+    total.files = static_cast<int32_t>(DecodeInt(entry + 4, 4));
+    total.kBytes = static_cast<int64_t>(DecodeInt(entry + 8, 8));
+  }
+  return true;
+}
+
+void RemoveLedger(const std::string& directory)
+{
+#if defined(__APPLE__)
+  if (removexattr(directory.c_str(), ledgerAttributeName, 0) < 0 &&
+#else
+  if (removexattr(directory.c_str(), ledgerAttributeName) < 0 &&
+#endif
+      errno != ENOENT && errno != ENODATA && errno != ENOATTR)
+  {
+    logs::Error("Error while removing filesystem attribute %1%: %2%: %3%", 
+                ledgerAttributeName, directory, util::Error::Failure(errno).Message());
+  }
+}
+
+void WriteLedger(const std::string& directory, const UploaderTotals& totals, 
+                 uint64_t fingerprint)
+{
+  size_t len = ledgerHeaderLength + totals.size() * ledgerEntryLength;
+  if (len > ledgerMaximum)
+  {
+    RemoveLedger(directory);
+    return;
+  }
+  
+  unsigned char buf[ledgerMaximum];
+  buf[0] = ledgerVersion;
+  buf[1] = 0;
+  EncodeInt(buf + 2, ledgerEntryLength, 2);
+  EncodeInt(buf + 4, totals.size(), 4);
+  EncodeInt(buf + 8, fingerprint, 8);
+  unsigned char* entry = buf + ledgerHeaderLength;
+  for (const auto& kv : totals)
+  {
+    EncodeInt(entry, static_cast<uint32_t>(kv.first), 4);
+    EncodeInt(entry + 4, static_cast<uint32_t>(kv.second.files), 4);
+    EncodeInt(entry + 8, static_cast<uint64_t>(kv.second.kBytes), 8);
+    entry += ledgerEntryLength;
+  }
+  
+#if defined(__APPLE__)
+  if (setxattr(directory.c_str(), ledgerAttributeName, buf, len, 0, 0) < 0)
+#else
+  if (setxattr(directory.c_str(), ledgerAttributeName, buf, len, 0) < 0)
+#endif
+  {
+    logs::Error("Error while writing filesystem attribute %1%: %2%: %3%", 
+                ledgerAttributeName, directory, util::Error::Failure(errno).Message());
+    // an old ledger left behind would be missing this change
+    RemoveLedger(directory);
+  }
+}
+
+void Scan(const std::string& directory, const std::vector<std::string>& names, 
+          UploaderTotals& totals)
+{
+  for (const std::string& name : names)
+  {
+    std::string path(directory + "/" + name);
+    util::path::Status status(path);
+    if (!status.IsRegularFile()) continue;
+    
+    UploaderTotal& total = totals[GetOwner(path).UID()];
+    total.kBytes += status.Size() / 1024;
+    ++total.files;
+  }
+}
+
+void Totals(const std::string& directory, UploaderTotals& totals)
+{
+  DIR* dp = opendir(directory.c_str());
+  if (!dp) throw util::SystemError(errno);
+  std::shared_ptr<DIR> dpGuard(dp, closedir);
+  
+  std::vector<std::string> subdirs;
+  std::vector<std::string> names;
+  int regularFiles = 0;
+  uint64_t fingerprint = 0;
+  bool exact = true;
+  
+  struct dirent* de;
+  while ((errno = 0, de = readdir(dp)))
+  {
+    const char* name = de->d_name;
+    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+    
+    unsigned char type = de->d_type;
+    uint64_t ino = de->d_ino;
+    if (type == DT_UNKNOWN)
+    {
+      struct stat st;
+      if (lstat((directory + "/" + name).c_str(), &st) < 0) throw util::SystemError(errno);
+      type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : 
+             S_ISLNK(st.st_mode) ? DT_LNK : DT_UNKNOWN;
+      ino = st.st_ino;
+    }
+    
+    if (type == DT_DIR)
+    {
+      subdirs.emplace_back(name);
+      continue;
+    }
+    
+    if (name[0] == '.') continue;
+    names.emplace_back(name);
+    // links count as what they point to, which the ledger can't follow
+    if (type == DT_REG)
+    {
+      ++regularFiles;
+      fingerprint += InodeHash(ino);
+    }
+    else if (type == DT_LNK) exact = false;
+  }
+  if (errno != 0) throw util::SystemError(errno);
+  
+  UploaderTotals ledger;
+  int ledgerFiles = 0;
+  uint64_t ledgerFingerprint = 0;
+  if (exact)
+  {
+    std::lock_guard<std::mutex> lock(LedgerMutex(directory));
+    if (!ReadLedger(directory, ledger, ledgerFingerprint)) exact = false;
+  }
+  
+  for (const auto& kv : ledger) ledgerFiles += kv.second.files;
+  if (exact && ledgerFiles == regularFiles && ledgerFingerprint == fingerprint)
+  {
+    for (const auto& kv : ledger)
+    {
+      UploaderTotal& total = totals[kv.first];
+      total.kBytes += kv.second.kBytes;
+      total.files += kv.second.files;
+    }
+  }
+  else
+  {
+    Scan(directory, names, totals);
+  }
+  
+  for (const std::string& subdir : subdirs)
+  {
+    Totals(directory + "/" + subdir, totals);
+  }
+}
+
+}
+
+void UpdateLedger(const RealPath& file, acl::UserID uid, long long kBytes, int files,
+                  ino_t ino)
+{
+  if (file.Basename().ToString()[0] == '.') return;
+  
+  const std::string& directory = file.Dirname().ToString();
+  std::lock_guard<std::mutex> lock(LedgerMutex(directory));
+  UploaderTotals totals;
+  uint64_t fingerprint;
+  if (!ReadLedger(directory, totals, fingerprint)) return;
+  fingerprint += static_cast<uint64_t>(files) * InodeHash(ino);
+  
+  UploaderTotal& total = totals[uid];
+  total.kBytes += kBytes;
+  total.files += files;
+  if (total.kBytes < 0 || total.files < 0)
+  {
+    // whatever was removed was never in the ledger
+    RemoveLedger(directory);
+    return;
+  }
+  
+  if (total.files == 0 && total.kBytes == 0) totals.erase(uid);
+  WriteLedger(directory, totals, fingerprint);
+}
+
+void CreateLedger(const RealPath& directory)
+{
+  std::lock_guard<std::mutex> lock(LedgerMutex(directory.ToString()));
+  WriteLedger(directory.ToString(), UploaderTotals(), 0);
+}
+
+void InvalidateLedger(const RealPath& directory)
+{
+  std::lock_guard<std::mutex> lock(LedgerMutex(directory.ToString()));
+  RemoveLedger(directory.ToString());
+}
+
+UploaderTotals LedgerTotals(const RealPath& path)
+{
+  UploaderTotals totals;
+  Totals(path.ToString(), totals);
+  return totals;
+}
+
+} /* fs namespace */
@@ -0,0 +1,60 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __FS_LEDGER_HPP
+#define __FS_LEDGER_HPP
+
+#include <map>
+#include <sys/types.h>
+#include "acl/types.hpp"
+
+namespace fs
+{
+
+class RealPath;
+
+struct UploaderTotal
+{
+  long long kBytes;
+  int files;
+  
+  UploaderTotal() : kBytes(0), files(0) { }
+};
+
+typedef std::map<acl::UserID, UploaderTotal> UploaderTotals;
+
+// every directory created by the daemon carries a ledger of the visible
+// regular files directly inside it, totalled by uploader, which uploads
+// and deletes keep current so a nuke reads one attribute per directory
+// instead of stat'ing every file and reading its owner
+//
+// a ledger that can't be kept exact is removed, a missing ledger or one
+// that doesn't account for the files in the directory, by their number
+// and their inodes, is never trusted
+
+// file, with inode ino, has been uploaded by uid, or removed with negative deltas
+void UpdateLedger(const RealPath& file, acl::UserID uid, long long kBytes, int files,
+                  ino_t ino);
+
+void CreateLedger(const RealPath& directory);
+void InvalidateLedger(const RealPath& directory);
+
+// totals of every visible regular file below path, each directory without a
+// ledger that matches its contents is scanned instead, throws util::SystemError
+UploaderTotals LedgerTotals(const RealPath& path);
+
+} /* fs namespace */
+
+#endif
@@ -0,0 +1,83 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include "fs/listingpool.hpp"
+#include "logs/logs.hpp"
+#include "util/verify.hpp"
+
+namespace fs
+{
+
+std::unique_ptr<ListingPool> ListingPool::instance;
+
+void ListingPool::Run()
+{
+  logs::SetThreadIDPrefix('D' /* directory listing */);
+  
+  while (true)
+  {
+    std::function<void()> task;
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      while (tasks.empty()) queued.wait(lock);
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    
+    task();
+  }
+}
+
+void ListingPool::Start()
+{
+  verify(!running);
+  unsigned count = std::max(2u, std::min(8u, boost::thread::hardware_concurrency()));
+  logs::Debug("Starting %1% directory listing threads..", count);
+  
+  boost::lock_guard<boost::mutex> lock(mutex);
+  for (unsigned i = 0; i < count; ++i)
+  {
+    threads.create_thread(std::bind(&ListingPool::Run, this));
+  }
+  running = true;
+}
+
+void ListingPool::Stop()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    if (!running) return;
+    running = false;
+  }
+  
+  logs::Debug("Stopping directory listing threads..");
+  threads.interrupt_all();
+  threads.join_all();
+  tasks.clear();
+}
+
+bool ListingPool::Submit(const std::function<void()>& task)
+{
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    if (!running || tasks.size() >= maximumQueued) return false;
+    tasks.emplace_back(task);
+  }
+  queued.notify_one();
+  return true;
+}
+
+} /* fs namespace */
@@ -0,0 +1,63 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __FS_LISTINGPOOL_HPP
+#define __FS_LISTINGPOOL_HPP
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace fs
+{
+
+// small fixed set of threads shared by all recursive listings to read
+// subdirectories ahead of the client thread that formats and sends them
+class ListingPool
+{
+  boost::thread_group threads;
+  boost::mutex mutex;
+  boost::condition_variable queued;
+  std::deque<std::function<void()>> tasks;
+  bool running;
+
+  static std::unique_ptr<ListingPool> instance;
+  static const size_t maximumQueued = 1024;
+  
+  ListingPool() : running(false) { }
+  
+  void Run();
+  
+public:
+  void Start();
+  void Stop();
+  
+  // returns false if the pool isn't running or is saturated,
+  // the caller should then do the work on its own thread
+  bool Submit(const std::function<void()>& task);
+  
+  static ListingPool& Get()
+  {
+    if (!instance) instance.reset(new ListingPool());
+    return *instance;
+  }
+};
+
+} /* fs namespace */
+
+#endif
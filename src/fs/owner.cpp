@@ -13,29 +13,115 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <atomic>
 #include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
 #include "fs/owner.hpp"
+#include "fs/dircache.hpp"
 #include "util/error.hpp"
 #include "logs/logs.hpp"
 #include "util/path/extattr.hpp"
 
+// getxattrat was added in linux 6.13 and takes the same number on every
+// architecture using the unified syscall table
+#if defined(__linux__) && !defined(SYS_getxattrat) && \
+    (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__) || defined(__arm__))
+# define SYS_getxattrat 464
+#endif
+
 namespace fs
 {
 
 namespace
 {
 
+// ownership is a single binary record, all fields little endian:
+//
+//   0  u8   version
+//   1  u8   reserved
+//   2  u16  record length
+//   4  i32  uid
+//   8  i32  gid
+//
+// later versions may only append fields (upload time, crc, speed ..) so
+// older readers still find uid and gid where they expect them
+const char* ownerAttributeName = "user.ebftpd.owner";
+const uint8_t ownerRecordVersion = 1;
+const size_t ownerRecordLength = 12;
+const size_t ownerRecordMaximum = 256;
+
+// the two decimal text attributes used before the binary record,
+// still read and migrated to a record the first time they are seen
 const char* uidAttributeName = "user.ebftpd.uid";
 const char* gidAttributeName = "user.ebftpd.gid";
 
-int32_t GetAttribute(const std::string& path, const char* attribute)
+void EncodeInt(unsigned char* buf, uint32_t value, int bytes)
 {
-  char buf[11];
+  for (int i = 0; i < bytes; ++i)
+  {
+    buf[i] = value & 0xff;
+    value >>= 8;
+  }
+}
+
+uint32_t DecodeInt(const unsigned char* buf, int bytes)
+{
+  uint32_t value = 0;
+  for (int i = bytes - 1; i >= 0; --i)
+  {
+    value = (value << 8) | buf[i];
+  }
+  return value;
+}
+
+size_t EncodeRecord(const Owner& owner, unsigned char* buf)
+{
+  buf[0] = ownerRecordVersion;
+  buf[1] = 0;
+  EncodeInt(buf + 2, ownerRecordLength, 2);
+  EncodeInt(buf + 4, owner.UID(), 4);
+  EncodeInt(buf + 8, owner.GID(), 4);
+  return ownerRecordLength;
+}
+
+bool DecodeRecord(const unsigned char* buf, ssize_t len, Owner& owner)
+{
+  if (len < static_cast<ssize_t>(ownerRecordLength) || buf[0] < 1) return false;
+  size_t recordLength = DecodeInt(buf + 2, 2);
+  if (recordLength < ownerRecordLength || recordLength > static_cast<size_t>(len)) return false;
+  owner = Owner(static_cast<int32_t>(DecodeInt(buf + 4, 4)),
+                static_cast<int32_t>(DecodeInt(buf + 8, 4)));
+  return true;
+}
+
+util::Error WriteRecord(const std::string& path, const Owner& owner, int flags)
+{
+  unsigned char buf[ownerRecordLength];
+  size_t len = EncodeRecord(owner, buf);
   
 #if defined(__APPLE__)
-  int len = getxattr(path.c_str(), attribute, buf, sizeof(buf), 0, 0);
+  if (setxattr(path.c_str(), ownerAttributeName, buf, len, 0, flags) < 0)
 #else
-  int len = getxattr(path.c_str(), attribute, buf, sizeof(buf));
+  if (setxattr(path.c_str(), ownerAttributeName, buf, len, flags) < 0)
+#endif
+  {
+    return util::Error::Failure(errno);
+  }
+  return util::Error::Success();
+}
+
+bool GetLegacyAttribute(const std::string& path, const char* attribute, int32_t& id)
+{
+  char buf[12];
+  
+#if defined(__APPLE__)
+  int len = getxattr(path.c_str(), attribute, buf, sizeof(buf) - 1, 0, 0);
+#else
+  int len = getxattr(path.c_str(), attribute, buf, sizeof(buf) - 1);
 #endif
 
   if (len < 0)
@@ -45,62 +131,151 @@ int32_t GetAttribute(const std::string& path, const char* attribute)
       logs::Error("Error while reading filesystem attribute %1%: %2%: %3%", 
                   attribute, path, util::Error::Failure(errno).Message());
     }
-    return 0;
+    return false;
   }
   
   buf[len] = '\0';
   
-  int32_t id;
   if (sscanf(buf, "%i", &id) != 1)
   {
     logs::Error("Invalid filesystem ownership attribute %1%, resetting to 0: %2%: %3%", 
                 attribute, path, buf);
+    id = 0;
   }
-  return id;
+  return true;
 }
 
-util::Error SetAttribute(const std::string& path, const char* attribute, int32_t id)
+// returns false if neither legacy attribute exists
+bool GetLegacyOwner(const std::string& path, Owner& owner)
+{
+  int32_t uid = 0;
+  int32_t gid = 0;
+  bool found = GetLegacyAttribute(path, uidAttributeName, uid);
+  found |= GetLegacyAttribute(path, gidAttributeName, gid);
+  owner = Owner(uid, gid);
+  return found;
+}
+
+void RemoveLegacyOwner(const std::string& path)
 {
-  char buf[11];
-  int len = snprintf(buf, sizeof(buf), "%i", id);
-  
 #if defined(__APPLE__)
-  if (setxattr(path.c_str(), attribute, buf, len, 0, 0) < 0)
+  removexattr(path.c_str(), uidAttributeName, 0);
+  removexattr(path.c_str(), gidAttributeName, 0);
 #else
-  if (setxattr(path.c_str(), attribute, buf, len, 0) < 0)
+  removexattr(path.c_str(), uidAttributeName);
+  removexattr(path.c_str(), gidAttributeName);
 #endif
-  {
-    auto e = util::Error::Failure(errno);
-    logs::Error("Error while setting filesystem ownership attribute %1%: %2%: %3%", 
-                attribute, path, e.Message());
-    return e;
-  }  
+}
+
+// the record is only created if it doesn't exist yet, so a concurrent
+// SetOwner always wins over a migration using stale legacy values
+util::Error MigrateLegacyOwner(const std::string& path, Owner& owner, bool& migrated)
+{
+  migrated = false;
+  if (!GetLegacyOwner(path, owner)) return util::Error::Success();
+  
+  auto e = WriteRecord(path, owner, XATTR_CREATE);
+  if (!e && e.Errno() != EEXIST) return e;
+  
+  RemoveLegacyOwner(path);
+  migrated = true;
   return util::Error::Success();
 }
 
+// path is only built when it's needed, either to log an error or
+// to take the legacy route when there's no record yet
+template <typename PathFn>
+Owner OwnerFromRecord(const PathFn& path, const unsigned char* buf, ssize_t len)
+{
+  if (len < 0)
+  {
+    if (errno == ENOATTR || errno == ENODATA)
+    {
+      Owner owner(0, 0);
+      bool migrated;
+      std::string legacyPath(path());
+      auto e = MigrateLegacyOwner(legacyPath, owner, migrated);
+      if (!e)
+      {
+        logs::Debug("Unable to migrate filesystem ownership attributes: %1%: %2%", 
+                    legacyPath, e.Message());
+      }
+      return owner;
+    }
+    
+    if (errno != ENOENT)
+    {
+      logs::Error("Error while reading filesystem attribute %1%: %2%: %3%", 
+                  ownerAttributeName, path(), util::Error::Failure(errno).Message());
+    }
+    return Owner(0, 0);
+  }
+  
+  Owner owner(0, 0);
+  if (!DecodeRecord(buf, len, owner))
+  {
+    logs::Error("Invalid filesystem ownership record %1%, resetting to 0: %2%", 
+                ownerAttributeName, path());
+  }
+  return owner;
 }
 
-Owner GetOwner(const std::string& path)
+#if defined(SYS_getxattrat)
+
+// latched the first time the syscall fails for any reason other than
+// the attribute or file not being there, seccomp filters and container
+// runtimes answer EPERM rather than ENOSYS and older kernels may reject
+// the arguments with EINVAL or EFAULT
+std::atomic<bool> getxattratUnusable(false);
+
+struct XattrArgs
 {
-  return Owner(GetAttribute(path, uidAttributeName),
-               GetAttribute(path, gidAttributeName));
+  uint64_t value;
+  uint32_t size;
+  uint32_t flags;
+};
+
+#endif
+
+}
 
+Owner GetOwner(const std::string& path)
+{
+  unsigned char buf[ownerRecordMaximum];
+#if defined(__APPLE__)
+  ssize_t len = getxattr(path.c_str(), ownerAttributeName, buf, sizeof(buf), 0, 0);
+#else
+  ssize_t len = getxattr(path.c_str(), ownerAttributeName, buf, sizeof(buf));
+#endif
+  return OwnerFromRecord([&path]() { return path; }, buf, len);
 }
 
 util::Error SetOwner(const std::string& path, const Owner& owner)
 {
-  if (owner.UID() != -1)
+  InvalidateListing(RealPath(path));
+  
+  // -1 leaves that half of the ownership unchanged
+  Owner newOwner(owner);
+  if (owner.UID() == -1 || owner.GID() == -1)
   {
-    auto e = SetAttribute(path, uidAttributeName, owner.UID());
-    if (!e) return e;
+    Owner current = GetOwner(path);
+    newOwner = Owner(owner.UID() == -1 ? current.UID() : owner.UID(),
+                     owner.GID() == -1 ? current.GID() : owner.GID());
   }
   
-  if (owner.GID() != -1)
+  auto e = WriteRecord(path, newOwner, 0);
+  if (!e)
   {
-    return SetAttribute(path, gidAttributeName, owner.GID());
+    logs::Error("Error while setting filesystem ownership attribute %1%: %2%: %3%", 
+                ownerAttributeName, path, e.Message());
   }
-  
-  return util::Error::Success();
+  return e;
+}
+
+util::Error MigrateOwner(const std::string& path, bool& migrated)
+{
+  Owner owner(0, 0);
+  return MigrateLegacyOwner(path, owner, migrated);
 }
 
 Owner GetOwner(const RealPath& path)
@@ -109,6 +284,49 @@ Owner GetOwner(const RealPath& path)
 
 }
 
+Owner GetOwnerAt(int dirfd, const RealPath& dir, const char* name)
+{
+  auto path = [&]() { return (dir / name).ToString(); };
+  unsigned char buf[ownerRecordMaximum];
+  
+#if defined(SYS_getxattrat)
+  if (!getxattratUnusable.load(std::memory_order_relaxed))
+  {
+    // follows symlinks like getxattr
+    XattrArgs args = { reinterpret_cast<uintptr_t>(buf), sizeof(buf), 0 };
+    ssize_t len = syscall(SYS_getxattrat, dirfd, name, 0, ownerAttributeName, 
+                          &args, sizeof(args));
+    if (len >= 0 || errno == ENOATTR || errno == ENODATA || errno == ENOENT) 
+      return OwnerFromRecord(path, buf, len);
+    
+    logs::Debug("getxattrat unusable, falling back to fgetxattr: %1%", 
+                util::Error::Failure(errno).Message());
+    getxattratUnusable = true;
+  }
+#endif
+
+  // symlinks, fifos etc fail to open here and take the path based route,
+  // that keeps getxattr's follow semantics without opening special files
+  int fd = openat(dirfd, name, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | 
+                               O_NOCTTY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    if (errno == ENOENT) return Owner(0, 0);
+    return GetOwner(path());
+  }
+  
+#if defined(__APPLE__)
+  ssize_t len = fgetxattr(fd, ownerAttributeName, buf, sizeof(buf), 0, 0);
+#else
+  ssize_t len = fgetxattr(fd, ownerAttributeName, buf, sizeof(buf));
+#endif
+  int errno_ = errno;
+  close(fd);
+  errno = errno_;
+  
+  return OwnerFromRecord(path, buf, len);
+}
+
 util::Error SetOwner(const RealPath& path, const Owner& owner)
 {
   return SetOwner(path.ToString(), owner);
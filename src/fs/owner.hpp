@@ -43,9 +43,16 @@ public:
 Owner GetOwner(const std::string& path);
 util::Error SetOwner(const std::string& path, const Owner& owner);
 
+// converts the old decimal uid / gid attributes to a binary record,
+// migrated is false if the path had no old attributes
+util::Error MigrateOwner(const std::string& path, bool& migrated);
+
 Owner GetOwner(const RealPath& path);
 util::Error SetOwner(const RealPath& path, const Owner& owner);
 
+// name is relative to dirfd, dir is only used for the path based fallback
+Owner GetOwnerAt(int dirfd, const RealPath& dir, const char* name);
+
 inline std::ostream& operator<<(std::ostream& os, const Owner& owner)
 {
   os << owner.UID() << "," << owner.GID();
@@ -18,6 +18,7 @@
 #include "cfg/get.hpp"
 #include "logs/logs.hpp"
 #include "fs/directory.hpp"
+#include "fs/realpathcache.hpp"
 
 namespace fs
 {
@@ -83,21 +84,8 @@ const RealPath& MakeReal(const Path& path)
   if (!path.cache.real)
   {
     auto virt = Resolve(WorkDirectory() / path);
-    path.cache.real = new RealPath(RealPath(cfg::Get().Sitepath()) & virt);
-    std::string& p = path.cache.real->path;
-    std::string noSymlinks;
-    if (util::path::Realpath(p, noSymlinks))
-    {
-      p = noSymlinks;
-    }
-    else
-    {
-      // deal with paths that don't exist yet
-      if (util::path::Realpath(util::path::Dirname(p), noSymlinks))
-      {
-        p = util::path::Join(noSymlinks, util::path::Basename(p));
-      }
-    }
+    RealPath real(RealPath(cfg::Get().Sitepath()) & virt);
+    path.cache.real = new RealPath(RealpathCache::Get().Resolve(real.ToString()));
   }
   return *path.cache.real;
 }
@@ -0,0 +1,98 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <sys/stat.h>
+#include "fs/realpathcache.hpp"
+#include "util/path/path.hpp"
+#include "cfg/get.hpp"
+
+namespace fs
+{
+
+std::unique_ptr<RealpathCache> RealpathCache::instance;
+const std::chrono::seconds RealpathCache::reconcileInterval(60);
+
+bool RealpathCache::Lookup(const std::string& path, std::string& resolved, 
+                           unsigned long long& currentGeneration)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  currentGeneration = generation;
+  auto it = entries.find(path);
+  if (it == entries.end() || it->second.generation != generation ||
+      std::chrono::steady_clock::now() - it->second.time >= reconcileInterval)
+    return false;
+  resolved = it->second.resolved;
+  return true;
+}
+
+void RealpathCache::Insert(const std::string& path, const std::string& resolved,
+                           unsigned long long resolvedGeneration)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  // something may have been moved while it was being resolved
+  if (resolvedGeneration != generation) return;
+  if (entries.size() >= maximumEntries) entries.clear();
+  Entry& entry = entries[path];
+  entry.resolved = resolved;
+  entry.generation = generation;
+  entry.time = std::chrono::steady_clock::now();
+}
+
+std::string RealpathCache::Resolve(const std::string& path)
+{
+  std::string resolved;
+  unsigned long long resolvedGeneration;
+  if (Lookup(path, resolved, resolvedGeneration)) return resolved;
+  
+  std::string dirname(util::path::Dirname(path));
+  if (dirname.empty() || dirname == path)
+  {
+    if (!util::path::Realpath(path, resolved)) return path;
+  }
+  else
+  {
+    // the parent is resolved the same way, so only the components
+    // below the deepest cached directory are looked at
+    resolved = util::path::Join(Resolve(dirname), util::path::Basename(path));
+    
+    struct stat st;
+    if (lstat(path.c_str(), &st) < 0) return resolved;
+    if (S_ISLNK(st.st_mode))
+    {
+      // a dangling link is treated as a path that doesn't exist
+      std::string target;
+      if (!util::path::Realpath(path, target)) return resolved;
+      resolved.swap(target);
+    }
+    else if (!S_ISDIR(st.st_mode)) return resolved;
+  }
+  
+  Insert(path, resolved, resolvedGeneration);
+  return resolved;
+}
+
+void RealpathCache::Invalidate()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  ++generation;
+  entries.clear();
+}
+
+void InitialiseRealpathCache()
+{
+  cfg::ConnectUpdatedSlot([]() { RealpathCache::Get().Invalidate(); });
+}
+
+} /* fs namespace */
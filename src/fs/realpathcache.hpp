@@ -0,0 +1,80 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __FS_REALPATHCACHE_HPP
+#define __FS_REALPATHCACHE_HPP
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace fs
+{
+
+// symlink free targets of directories on the site, so a path inside a
+// directory already resolved needs at most an lstat of its last component
+// instead of realpath walking every component again
+//
+// an entry is only used in the generation it was resolved in, which moves
+// on with every rename or directory removal and on config reload, entries
+// older than the reconcile interval are resolved again to pick up symlinks
+// changed on disk outside the daemon
+class RealpathCache
+{
+  struct Entry
+  {
+    std::string resolved;
+    unsigned long long generation;
+    std::chrono::steady_clock::time_point time;
+  };
+
+  std::mutex mutex;
+  std::unordered_map<std::string, Entry> entries;
+  unsigned long long generation;
+  
+  static std::unique_ptr<RealpathCache> instance;
+  static const size_t maximumEntries = 65536;
+  static const std::chrono::seconds reconcileInterval;
+  
+  RealpathCache() : generation(0) { }
+  
+  bool Lookup(const std::string& path, std::string& resolved, 
+              unsigned long long& currentGeneration);
+  void Insert(const std::string& path, const std::string& resolved,
+              unsigned long long resolvedGeneration);
+  
+public:
+  // as realpath(3), except the components of a path that don't exist,
+  // or are dangling symlinks, are appended unchanged to the resolved
+  // directory above them
+  std::string Resolve(const std::string& path);
+  
+  // anything may now resolve differently
+  void Invalidate();
+  
+  static RealpathCache& Get()
+  {
+    if (!instance) instance.reset(new RealpathCache());
+    return *instance;
+  }
+};
+
+void InitialiseRealpathCache();
+
+} /* fs namespace */
+
+#endif
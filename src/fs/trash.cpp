@@ -0,0 +1,282 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "fs/trash.hpp"
+#include "fs/path.hpp"
+#include "fs/directory.hpp"
+#include "util/path/path.hpp"
+#include "util/path/diriterator.hpp"
+#include "util/path/dircontainer.hpp"
+#include "cfg/get.hpp"
+#include "logs/logs.hpp"
+#include "util/verify.hpp"
+
+namespace fs
+{
+
+const char* trashName = ".ebftpd-trash";
+
+std::unique_ptr<TrashReaper> TrashReaper::instance;
+
+namespace
+{
+
+std::mutex seenMutex;
+std::set<std::string> seen;
+std::atomic<unsigned> counter(0);
+
+// the highest directory inside the site on the same filesystem as directory
+std::string TrashDirectory(const std::string& directory)
+{
+  struct stat st;
+  if (lstat(directory.c_str(), &st) < 0) throw util::SystemError(errno);
+  dev_t device = st.st_dev;
+  
+  std::string root(cfg::Get().Sitepath());
+  if (root.length() > 1 && root.back() == '/') root.pop_back();
+  
+  // only climb while strictly below the site root, a directory outside
+  // it (say /site2 beside /site) has no trash directory to go to
+  auto below = [&root](const std::string& path) -> bool
+    {
+      if (root == "/") return path.length() > 1 && path[0] == '/';
+      return path.length() > root.length() && path[root.length()] == '/' &&
+             !path.compare(0, root.length(), root);
+    };
+  
+  if (!below(directory) && directory != root) throw util::SystemError(EXDEV);
+  
+  std::string top(directory);
+  while (below(top))
+  {
+    std::string parent(util::path::Dirname(top));
+    if (lstat(parent.c_str(), &st) < 0) throw util::SystemError(errno);
+    if (st.st_dev != device) break;
+    top = parent;
+  }
+  
+  return util::path::Join(top, trashName);
+}
+
+// anything left in a trash directory from before a restart is queued
+// the first time we come across it
+void Discover(const std::string& trash)
+{
+  {
+    std::lock_guard<std::mutex> lock(seenMutex);
+    if (!seen.insert(trash).second) return;
+  }
+  
+  try
+  {
+    for (const std::string& name : util::path::DirContainer(trash))
+    {
+      TrashReaper::Get().Queue(util::path::Join(trash, name));
+    }
+  }
+  catch (const util::SystemError& e)
+  {
+    if (e.Errno() != ENOENT)
+      logs::Error("Unable to read trash directory: %1%: %2%", trash, e.Message());
+  }
+}
+
+}
+
+bool IsTrash(const std::string& path)
+{
+  static const size_t length = strlen(trashName);
+  std::string::size_type pos = 0;
+  while ((pos = path.find(trashName, pos)) != std::string::npos)
+  {
+    if ((pos == 0 || path[pos - 1] == '/') &&
+        (pos + length == path.length() || path[pos + length] == '/'))
+      return true;
+    pos += length;
+  }
+  return false;
+}
+
+util::Error Trash(const RealPath& directory)
+{
+  std::string trash;
+  try
+  {
+    trash = TrashDirectory(directory.Dirname().ToString());
+  }
+  catch (const util::SystemError& e)
+  {
+    return util::Error::Failure(e.Errno());
+  }
+  
+  if (mkdir(trash.c_str(), 0700) < 0 && errno != EEXIST) 
+    return util::Error::Failure(errno);
+  
+  Discover(trash);
+  
+  util::Error e;
+  for (int attempt = 0; attempt < 3; ++attempt)
+  {
+    std::ostringstream name;
+    name << time(nullptr) << '.' << getpid() << '.' << ++counter;
+    RealPath target(util::path::Join(trash, name.str()));
+    e = RenameDirectory(directory, target);
+    if (e)
+    {
+      TrashReaper::Get().Queue(target.ToString());
+      break;
+    }
+    
+    if (!e.ValidErrno() || (e.Errno() != EEXIST && e.Errno() != ENOTEMPTY)) break;
+  }
+  
+  return e;
+}
+
+TrashReaper::TrashReaper() :
+  bucket(unlinksPerSecond, std::chrono::seconds(1))
+{
+}
+
+void TrashReaper::Throttle(long long cost)
+{
+  auto wait = bucket.Consume(cost);
+  if (wait.count() > 0)
+  {
+    boost::this_thread::sleep(boost::posix_time::microseconds(wait.count() / 1000));
+  }
+}
+
+void TrashReaper::Reap(int fd, const std::string& path)
+{
+  std::unique_ptr<DIR, int(*)(DIR*)> dir(fdopendir(fd), &closedir);
+  if (!dir)
+  {
+    logs::Error("Unable to read trashed directory: %1%: %2%", path, 
+                util::Error::Failure(errno).Message());
+    close(fd);
+    return;
+  }
+  
+  while (struct dirent* de = readdir(dir.get()))
+  {
+    if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, "..")) continue;
+    
+    struct stat st;
+    if (fstatat(fd, de->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) continue;
+    
+    if (S_ISDIR(st.st_mode))
+    {
+      int child = openat(fd, de->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+      if (child >= 0) Reap(child, path + '/' + de->d_name);
+      
+      Throttle(1);
+      if (unlinkat(fd, de->d_name, AT_REMOVEDIR) < 0)
+      {
+        logs::Error("Unable to remove trashed directory: %1%/%2%: %3%", path, de->d_name,
+                    util::Error::Failure(errno).Message());
+      }
+    }
+    else
+    {
+      // freeing a large file's blocks costs more than the unlink itself
+      Throttle(1 + st.st_size / bytesPerUnlink);
+      if (unlinkat(fd, de->d_name, 0) < 0)
+      {
+        logs::Error("Unable to remove trashed file: %1%/%2%: %3%", path, de->d_name,
+                    util::Error::Failure(errno).Message());
+      }
+    }
+  }
+}
+
+void TrashReaper::Reap(const std::string& path)
+{
+  int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+  if (fd < 0)
+  {
+    if (errno != ENOENT)
+    {
+      logs::Error("Unable to open trashed directory: %1%: %2%", path, 
+                  util::Error::Failure(errno).Message());
+    }
+    return;
+  }
+  
+  Reap(fd, path);
+  if (rmdir(path.c_str()) < 0)
+  {
+    logs::Error("Unable to remove trashed directory: %1%: %2%", path, 
+                util::Error::Failure(errno).Message());
+  }
+}
+
+void TrashReaper::Run()
+{
+  logs::SetThreadIDPrefix('W' /* wipe */);
+  
+  while (true)
+  {
+    std::string path;
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      while (trashed.empty()) queued.wait(lock);
+      path = std::move(trashed.front());
+      trashed.pop_front();
+    }
+    
+    Reap(path);
+  }
+}
+
+void TrashReaper::Start()
+{
+  verify(!thread.joinable());
+  logs::Debug("Starting trash reaper..");
+  thread = boost::thread(&TrashReaper::Run, this);
+  Discover(util::path::Join(cfg::Get().Sitepath(), trashName));
+}
+
+void TrashReaper::Stop()
+{
+  if (thread.joinable())
+  {
+    logs::Debug("Stopping trash reaper..");
+    thread.interrupt();
+    thread.join();
+  }
+}
+
+void TrashReaper::Queue(const std::string& path)
+{
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    trashed.emplace_back(path);
+  }
+  queued.notify_one();
+}
+
+} /* fs namespace */
@@ -0,0 +1,81 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __FS_TRASH_HPP
+#define __FS_TRASH_HPP
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include "util/error.hpp"
+#include "util/tokenbucket.hpp"
+
+namespace fs
+{
+
+class RealPath;
+
+// every filesystem the site spans gets a trash directory at the top of
+// that filesystem, a directory is removed by renaming it in there which
+// is atomic and immediate, the reaper thread then deletes the tree in the
+// background at a limited rate so it doesn't starve everyone else's i/o
+extern const char* trashName;
+
+// true if any component of path is a trash directory, these are never
+// visible to users
+bool IsTrash(const std::string& path);
+
+// returns failure if the directory can't be moved to the trash on its own
+// filesystem, the caller should then delete it in place
+util::Error Trash(const RealPath& directory);
+
+class TrashReaper
+{
+  boost::thread thread;
+  boost::mutex mutex;
+  boost::condition_variable queued;
+  std::deque<std::string> trashed;
+  util::TokenBucket bucket;
+  
+  static std::unique_ptr<TrashReaper> instance;
+  static const long long unlinksPerSecond = 2000;
+  static const long long bytesPerUnlink = 64 * 1024 * 1024;
+  
+  TrashReaper();
+  
+  void Run();
+  void Throttle(long long cost);
+  void Reap(int fd, const std::string& path);
+  void Reap(const std::string& path);
+  
+public:
+  void Start();
+  void Stop();
+  
+  void Queue(const std::string& path);
+  
+  static TrashReaper& Get()
+  {
+    if (!instance) instance.reset(new TrashReaper());
+    return *instance;
+  }
+};
+
+} /* fs namespace */
+
+#endif
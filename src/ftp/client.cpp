@@ -123,6 +123,11 @@ const boost::posix_time::ptime Client::LoggedInAt() const
   return pimpl->LoggedInAt();
 }
 
+int Client::OnlineSlot() const
+{
+  return pimpl->OnlineSlot();
+}
+
 void Client::SetXDupeMode(xdupe::Mode xdupeMode)
 {
   pimpl->SetXDupeMode(xdupeMode);
@@ -133,6 +138,16 @@ xdupe::Mode Client::XDupeMode() const
   return pimpl->XDupeMode();
 }
 
+void Client::SetMlstFacts(mlst::Fact mlstFacts)
+{
+  pimpl->SetMlstFacts(mlstFacts);
+}
+
+mlst::Fact Client::MlstFacts() const
+{
+  return pimpl->MlstFacts();
+}
+
 /*bool Client::IsFxp(const util::net::Endpoint& ep) const
 {
   return pimpl->IsFxp(ep);
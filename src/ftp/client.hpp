@@ -59,6 +59,11 @@ namespace xdupe
 enum class Mode : unsigned;
 }
 
+namespace mlst
+{
+enum class Fact : unsigned;
+}
+
 class ClientImpl;
 class Control;
 class Data;
@@ -97,8 +102,11 @@ public:
   const boost::posix_time::seconds& IdleTimeout() const;
   
   const boost::posix_time::ptime LoggedInAt() const;
+  int OnlineSlot() const;
   void SetXDupeMode(xdupe::Mode xdupeMode);
   xdupe::Mode XDupeMode() const;
+  void SetMlstFacts(mlst::Fact mlstFacts);
+  mlst::Fact MlstFacts() const;
   
   bool IsFxp(const util::net::Endpoint& ep) const;
   
@@ -59,6 +59,7 @@ ClientImpl::ClientImpl(Client& parent) :
   state(ClientState::LoggedOut),
   passwordAttemps(0),
   xdupeMode(xdupe::Mode::Disabled),
+  mlstFacts(mlst::Fact::All),
   kickLogin(false),
   idleTimeout(boost::posix_time::seconds(cfg::Get().IdleTimeout().Timeout())),
   ident("*")
@@ -96,7 +97,7 @@ void ClientImpl::SetState(ClientState state)
 
 void ClientImpl::SetLoggedIn(bool kicked)
 {
-  auto result = loginGuard.Login(kicked, boost::this_thread::get_id());
+  auto result = loginGuard.Login(kicked);
   switch (result)
   {
     case CounterResult::PersonalFail  :
@@ -212,9 +213,7 @@ void ClientImpl::DisplayBanner()
 
 void ClientImpl::IdleReset(std::string commandLine)
 {
-  for (auto & mask : cfg::Get().IdleCommands())
-    if (util::WildcardMatch(mask, commandLine, true))
-      return;
+  if (cfg::Get().IdleCommands().Match(commandLine)) return;
   idleTime = boost::posix_time::second_clock::local_time();
   idleExpires = idleTime + idleTimeout;
 }
@@ -235,7 +234,7 @@ void ClientImpl::ExecuteCommand(const std::string& commandLine)
   
   if (State() == ClientState::LoggedIn)
   {
-    OnlineWriter::Get().Command(boost::this_thread::get_id(), currentCommand);
+    OnlineWriter::Get().Command(loginGuard.OnlineSlot(), currentCommand);
   }
   
   cmd::rfc::CommandDefOptRef def(cmd::rfc::Factory::Lookup(args[0]));
@@ -284,7 +283,7 @@ void ClientImpl::ExecuteCommand(const std::string& commandLine)
   
   if (State() == ClientState::LoggedIn)
   {
-    OnlineWriter::Get().Idle(boost::this_thread::get_id());
+    OnlineWriter::Get().Idle(loginGuard.OnlineSlot());
   }
 }
 
@@ -606,15 +605,14 @@ void ClientImpl::Run()
   (void) finishedGuard; /* silence unused variable warning */
 }
 
-CounterResult LoginGuard::Login(bool kicked, const boost::thread::id& tid)
+CounterResult LoginGuard::Login(bool kicked)
 {
   auto result = Counter::Login().Start(client.User().ID(), client.User().NumLogins(), 
                                        kicked, client.User().HasFlag(acl::Flag::Exempt));
   if (result != CounterResult::Okay) return result;
 
-  OnlineWriter::Get().LoggedIn(tid, client, fs::WorkDirectory().ToString());
+  onlineSlot = OnlineWriter::Get().LoggedIn(client, fs::WorkDirectory().ToString());
   
-  this->tid = tid;
   loggedIn = true;
   return CounterResult::Okay;
 }
@@ -623,7 +621,8 @@ void LoginGuard::Logout()
 {
   assert(loggedIn);
   Counter::Login().Stop(client.User().ID());
-  OnlineWriter::Get().LoggedOut(tid);  
+  OnlineWriter::Get().LoggedOut(onlineSlot);
+  onlineSlot = -1;
   loggedIn = false;
 }
 
@@ -29,6 +29,7 @@
 #include "ftp/data.hpp"
 #include "ftp/control.hpp"
 #include "ftp/xdupe.hpp"
+#include "ftp/mlst.hpp"
 #include "util/processreader.hpp"
 #include "ftp/enums.hpp"
 
@@ -51,11 +52,11 @@ class LoginGuard
 {
   Client& client;
   bool loggedIn;
-  boost::thread::id tid;
+  int onlineSlot;
   
 public:
   LoginGuard(Client& client) : 
-    client(client), loggedIn(false)
+    client(client), loggedIn(false), onlineSlot(-1)
   {
   }
   
@@ -67,8 +68,10 @@ public:
     }
   }
   
-  CounterResult Login(bool kicked, const boost::thread::id& tid);
+  CounterResult Login(bool kicked);
   void Logout();
+  
+  int OnlineSlot() const { return onlineSlot; }
 };
 
 
@@ -90,6 +93,7 @@ class ClientImpl : public util::Thread
   int passwordAttemps;
   boost::optional<std::pair<fs::VirtualPath, std::string>> renameFrom;
   xdupe::Mode xdupeMode;
+  mlst::Fact mlstFacts;
   std::string confirmCommand;
   std::string currentCommand;
   bool kickLogin;
@@ -159,10 +163,16 @@ public:
   const boost::posix_time::ptime LoggedInAt() const
   { return loggedInAt; }
   
+  int OnlineSlot() const { return loginGuard.OnlineSlot(); }
+  
   void SetXDupeMode(xdupe::Mode xdupeMode)
   { this->xdupeMode = xdupeMode; }
   xdupe::Mode XDupeMode() const { return xdupeMode; }
   
+  void SetMlstFacts(mlst::Fact mlstFacts)
+  { this->mlstFacts = mlstFacts; }
+  mlst::Fact MlstFacts() const { return mlstFacts; }
+  
   bool IsFxp(const util::net::Endpoint& ep) const;
   
   bool ConfirmCommand(const std::string& argStr);
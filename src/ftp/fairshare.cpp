@@ -0,0 +1,337 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <limits>
+#include "ftp/fairshare.hpp"
+#include "ftp/speedcounter.hpp"
+#include "cfg/get.hpp"
+#include "logs/logs.hpp"
+#include "util/verify.hpp"
+
+namespace ftp
+{
+
+namespace
+{
+
+const long long minimumRate = 1024;
+
+// a transfer using less than this fraction of its allocation is
+// limited by something other than us and only demands what it uses
+const double greedyThreshold = 0.9;
+const double demandHeadroom = 1.25;
+
+std::vector<double> WaterFill(double capacity, const std::vector<std::pair<int, double>>& claims)
+{
+  std::vector<double> shares(claims.size(), 0);
+  std::vector<bool> satisfied(claims.size(), false);
+  double remaining = capacity;
+
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    double weights = 0;
+    for (size_t i = 0; i < claims.size(); ++i)
+    {
+      if (!satisfied[i]) weights += claims[i].first;
+    }
+    if (weights == 0) break;
+
+    for (size_t i = 0; i < claims.size(); ++i)
+    {
+      if (satisfied[i]) continue;
+      double share = remaining * claims[i].first / weights;
+      if (claims[i].second <= share)
+      {
+        shares[i] = claims[i].second;
+        remaining -= claims[i].second;
+        satisfied[i] = true;
+        changed = true;
+      }
+    }
+  }
+
+  // whatever is left goes to the unsatisfied claims, or if everyone
+  // is satisfied it is spread over all of them so they can ramp up
+  double weights = 0;
+  bool allSatisfied = std::find(satisfied.begin(), satisfied.end(), false) == satisfied.end();
+  for (size_t i = 0; i < claims.size(); ++i)
+  {
+    if (allSatisfied || !satisfied[i]) weights += claims[i].first;
+  }
+
+  if (weights > 0 && remaining > 0)
+  {
+    for (size_t i = 0; i < claims.size(); ++i)
+    {
+      if (allSatisfied || !satisfied[i])
+        shares[i] += remaining * claims[i].first / weights;
+    }
+  }
+
+  return shares;
+}
+
+}
+
+std::unique_ptr<FairShareScheduler> FairShareScheduler::instance;
+const std::chrono::milliseconds FairShareScheduler::interval(100);
+
+FairShareTransfer::FairShareTransfer(long long rate) :
+  bucket(rate, SpeedCounter::maximumBurst),
+  bytes(0),
+  demand(0)
+{
+}
+
+FairShareScheduler::FairShareScheduler() :
+  uploadCapacity(0),
+  downloadCapacity(0),
+  lastSchedule(std::chrono::steady_clock::now())
+{
+}
+
+int FairShareScheduler::Measure(Node& node, double seconds)
+{
+  int count = 0;
+  node.used = 0;
+  node.demand = 0;
+
+  for (auto it = node.transfers.begin(); it != node.transfers.end();)
+  {
+    auto transfer = it->lock();
+    if (!transfer)
+    {
+      it = node.transfers.erase(it);
+      continue;
+    }
+
+    long long rate = transfer->bytes.exchange(0, std::memory_order_relaxed) / seconds;
+    node.used += rate;
+    if (rate >= transfer->bucket.Rate() * greedyThreshold)
+      transfer->demand = std::numeric_limits<double>::infinity();
+    else
+      transfer->demand = std::max<double>(rate * demandHeadroom, minimumRate);
+    node.demand += transfer->demand;
+    ++count;
+    ++it;
+  }
+
+  for (auto it = node.children.begin(); it != node.children.end();)
+  {
+    int childCount = Measure(it->second, seconds);
+    if (childCount == 0)
+    {
+      it = node.children.erase(it);
+      continue;
+    }
+
+    node.used += it->second.used;
+    node.demand += it->second.demand;
+    count += childCount;
+    ++it;
+  }
+
+  return count;
+}
+
+void FairShareScheduler::Allocate(Node& node, long long capacity)
+{
+  node.allocated = capacity;
+
+  std::vector<std::pair<int, double>> claims;
+  std::vector<FairShareTransferPtr> transfers;
+  for (auto& weak : node.transfers)
+  {
+    auto transfer = weak.lock();
+    if (!transfer) continue;
+    claims.emplace_back(1, transfer->demand);
+    transfers.emplace_back(std::move(transfer));
+  }
+
+  for (auto& kv : node.children)
+  {
+    claims.emplace_back(kv.second.weight, kv.second.demand);
+  }
+
+  // negative capacity means fair share has been disabled by a config
+  // reload, transfers still registered are left unlimited
+  std::vector<double> shares;
+  if (capacity >= 0) shares = WaterFill(capacity, claims);
+  else shares.assign(claims.size(), -1);
+
+  size_t i = 0;
+  for (auto& transfer : transfers)
+  {
+    double share = shares[i++];
+    transfer->bucket.SetRate(share < 0 ? 0 : std::max<long long>(share, minimumRate));
+  }
+
+  for (auto& kv : node.children)
+  {
+    Allocate(kv.second, shares[i++]);
+  }
+}
+
+void FairShareScheduler::Schedule()
+{
+  auto now = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(now - lastSchedule).count();
+  if (seconds <= 0) return;
+  lastSchedule = now;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto direction : ::stats::directions)
+  {
+    Node& root = Root(direction);
+    if (Measure(root, seconds) > 0)
+    {
+      long long capacity = Capacity(direction);
+      Allocate(root, capacity > 0 ? capacity : -1);
+    }
+  }
+}
+
+void FairShareScheduler::Run()
+{
+  while (true)
+  {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(interval.count()));
+    Schedule();
+  }
+}
+
+void FairShareScheduler::Start()
+{
+  verify(!thread.joinable());
+  logs::Debug("Starting fair share bandwidth scheduler..");
+  thread = boost::thread(&FairShareScheduler::Run, this);
+}
+
+void FairShareScheduler::Stop()
+{
+  if (thread.joinable())
+  {
+    logs::Debug("Stopping fair share bandwidth scheduler..");
+    thread.interrupt();
+    thread.join();
+  }
+}
+
+void FairShareScheduler::SetCapacity(long long uploads, long long downloads)
+{
+  uploadCapacity = uploads;
+  downloadCapacity = downloads;
+}
+
+void FairShareScheduler::Reweight()
+{
+  const cfg::Config& config = cfg::Get();
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto direction : ::stats::directions)
+  {
+    for (auto& sectionKV : Root(direction).children)
+    {
+      Node& sectionNode = sectionKV.second;
+      sectionNode.weight = config.FairShareWeight(cfg::FairShareWeight::Type::Section, 
+                                                  sectionKV.first);
+      for (auto& groupKV : sectionNode.children)
+      {
+        Node& groupNode = groupKV.second;
+        groupNode.weight = config.FairShareWeight(cfg::FairShareWeight::Type::Group, 
+                                                  groupKV.first);
+        for (auto& userKV : groupNode.children)
+        {
+          userKV.second.weight = config.FairShareWeight(cfg::FairShareWeight::Type::User, 
+                                                        userKV.first);
+        }
+      }
+    }
+  }
+}
+
+FairShareTransferPtr FairShareScheduler::Register(::stats::Direction direction,
+                                                  const std::string& section,
+                                                  const std::string& group,
+                                                  const std::string& user)
+{
+  long long capacity = Capacity(direction);
+  if (capacity <= 0) return nullptr;
+
+  const cfg::Config& config = cfg::Get();
+  std::lock_guard<std::mutex> lock(mutex);
+
+  Node& root = Root(direction);
+  Node& sectionNode = root.children[section];
+  sectionNode.weight = config.FairShareWeight(cfg::FairShareWeight::Type::Section, section);
+  Node& groupNode = sectionNode.children[group];
+  groupNode.weight = config.FairShareWeight(cfg::FairShareWeight::Type::Group, group);
+  Node& userNode = groupNode.children[user];
+  userNode.weight = config.FairShareWeight(cfg::FairShareWeight::Type::User, user);
+
+  // until the next schedule a new transfer gets an even split of the site
+  int count = 1;
+  for (const auto& sectionKV : root.children)
+    for (const auto& groupKV : sectionKV.second.children)
+      for (const auto& userKV : groupKV.second.children)
+        count += userKV.second.transfers.size();
+
+  auto transfer = std::make_shared<FairShareTransfer>(std::max(capacity / count, minimumRate));
+  userNode.transfers.emplace_back(transfer);
+  return transfer;
+}
+
+int FairShareScheduler::Dump(const Node& node, const std::string& name, int depth,
+                             std::vector<FairShareUsage>& usage)
+{
+  FairShareUsage nodeUsage;
+  nodeUsage.depth = depth;
+  nodeUsage.name = name;
+  nodeUsage.weight = node.weight;
+  nodeUsage.allocated = node.allocated;
+  nodeUsage.used = node.used;
+  nodeUsage.transfers = node.transfers.size();
+
+  size_t index = usage.size();
+  usage.emplace_back(nodeUsage);
+  for (const auto& kv : node.children)
+  {
+    usage[index].transfers += Dump(kv.second, kv.first, depth + 1, usage);
+  }
+  return usage[index].transfers;
+}
+
+std::vector<FairShareUsage> FairShareScheduler::Usage(::stats::Direction direction)
+{
+  std::vector<FairShareUsage> usage;
+  std::lock_guard<std::mutex> lock(mutex);
+  Dump(Root(direction), "SITE", 0, usage);
+  return usage;
+}
+
+void InitialiseFairShare()
+{
+  cfg::ConnectUpdatedSlot([]()
+    {
+      const cfg::FairShare& fairShare = cfg::Get().FairShare();
+      FairShareScheduler::Get().SetCapacity(fairShare.Uploads() * 1024,
+                                            fairShare.Downloads() * 1024);
+      FairShareScheduler::Get().Reweight();
+    });
+}
+
+} /* ftp namespace */
@@ -0,0 +1,140 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __FTP_FAIRSHARE_HPP
+#define __FTP_FAIRSHARE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include "util/tokenbucket.hpp"
+#include "stats/types.hpp"
+
+namespace ftp
+{
+
+class FairShareTransfer
+{
+  util::TokenBucket bucket;
+  std::atomic<long long> bytes;
+  double demand; // guarded by the scheduler
+
+public:
+  FairShareTransfer(long long rate);
+
+  std::chrono::nanoseconds Consume(long long bytes)
+  {
+    this->bytes.fetch_add(bytes, std::memory_order_relaxed);
+    return bucket.Consume(bytes);
+  }
+
+  friend class FairShareScheduler;
+};
+
+typedef std::shared_ptr<FairShareTransfer> FairShareTransferPtr;
+
+struct FairShareUsage
+{
+  int depth;
+  std::string name;
+  int weight;
+  long long allocated; // bytes per second
+  long long used;      // bytes per second
+  int transfers;
+};
+
+// hierarchical weighted fair share of the site bandwidth,
+// site -> section -> group -> user -> transfer
+//
+// every interval each transfer's measured rate is used as its demand and
+// capacity is handed down the tree by weighted water filling, so capacity
+// left idle by one node is redistributed to its siblings
+class FairShareScheduler
+{
+  struct Node
+  {
+    int weight;
+    long long allocated;
+    long long used;
+    double demand;
+    std::map<std::string, Node> children;
+    std::vector<std::weak_ptr<FairShareTransfer>> transfers;
+
+    Node() : weight(1), allocated(0), used(0), demand(0) { }
+  };
+
+  boost::thread thread;
+  std::mutex mutex;
+  Node uploads;
+  Node downloads;
+  std::atomic<long long> uploadCapacity;
+  std::atomic<long long> downloadCapacity;
+  std::chrono::steady_clock::time_point lastSchedule;
+
+  static std::unique_ptr<FairShareScheduler> instance;
+  static const std::chrono::milliseconds interval;
+
+  FairShareScheduler();
+
+  void Run();
+  void Schedule();
+  static int Measure(Node& node, double seconds);
+  static void Allocate(Node& node, long long capacity);
+  static int Dump(const Node& node, const std::string& name, int depth,
+                  std::vector<FairShareUsage>& usage);
+
+  Node& Root(::stats::Direction direction)
+  { return direction == ::stats::Direction::Upload ? uploads : downloads; }
+
+  long long Capacity(::stats::Direction direction) const
+  {
+    return direction == ::stats::Direction::Upload ? uploadCapacity.load() :
+                                                     downloadCapacity.load();
+  }
+
+public:
+  void Start();
+  void Stop();
+  void SetCapacity(long long uploads, long long downloads);
+  
+  // rereads the weight of every section, group and user with transfers
+  // running, so a reload applies to them and not only to new transfers
+  void Reweight();
+
+  // returns nullptr if fair share is disabled for that direction
+  FairShareTransferPtr Register(::stats::Direction direction,
+                                const std::string& section,
+                                const std::string& group,
+                                const std::string& user);
+
+  std::vector<FairShareUsage> Usage(::stats::Direction direction);
+
+  static FairShareScheduler& Get()
+  {
+    if (!instance) instance.reset(new FairShareScheduler());
+    return *instance;
+  }
+};
+
+void InitialiseFairShare();
+
+} /* ftp namespace */
+
+#endif
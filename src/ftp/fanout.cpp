@@ -0,0 +1,122 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cstring>
+#include "ftp/fanout.hpp"
+#include "cfg/get.hpp"
+
+namespace ftp
+{
+
+std::unique_ptr<Fanout> Fanout::instance;
+
+FanoutRing::FanoutRing(size_t capacity, off_t offset) :
+  ring(capacity),
+  start(offset),
+  end(offset),
+  retired(false)
+{
+}
+
+void FanoutRing::Copy(off_t offset, const char* buffer, size_t len)
+{
+  size_t pos = offset % ring.size();
+  size_t first = std::min(len, ring.size() - pos);
+  std::memcpy(&ring[pos], buffer, first);
+  std::memcpy(&ring[0], buffer + first, len - first);
+}
+
+void FanoutRing::Publish(const char* buffer, size_t len)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (retired) return;
+  if (len >= ring.size())
+  {
+    // only the tail fits
+    buffer += len - ring.size();
+    end += len - ring.size();
+    start = end;
+    len = ring.size();
+  }
+  
+  Copy(end, buffer, len);
+  end += len;
+  start = std::max<off_t>(start, end - ring.size());
+}
+
+void FanoutRing::Retire()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  retired = true;
+  start = end;
+}
+
+bool FanoutRing::Retired()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return retired;
+}
+
+size_t FanoutRing::Read(off_t offset, char* buffer, size_t len)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (retired || offset < start || offset >= end) return 0;
+  
+  len = std::min<size_t>(len, end - offset);
+  size_t pos = offset % ring.size();
+  size_t first = std::min(len, ring.size() - pos);
+  std::memcpy(buffer, &ring[pos], first);
+  std::memcpy(buffer + first, &ring[0], len - first);
+  return len;
+}
+
+FanoutRingPtr Fanout::Create(const std::string& path, off_t offset)
+{
+  long long capacity = cfg::Get().FanoutBuffer() * 1024;
+  
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto it = rings.begin(); it != rings.end();)
+  {
+    if (it->second.expired()) it = rings.erase(it);
+    else ++it;
+  }
+  
+  // downloaders still holding the previous upload's window must not
+  // be served its bytes at this upload's offsets
+  auto it = rings.find(path);
+  if (it != rings.end())
+  {
+    auto previous = it->second.lock();
+    if (previous) previous->Retire();
+    rings.erase(it);
+  }
+  
+  if (capacity <= 0) return nullptr;
+  
+  auto ring = std::make_shared<FanoutRing>(capacity, offset);
+  rings[path] = ring;
+  return ring;
+}
+
+FanoutRingPtr Fanout::Find(const std::string& path)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = rings.find(path);
+  if (it == rings.end()) return nullptr;
+  return it->second.lock();
+}
+
+} /* ftp namespace */
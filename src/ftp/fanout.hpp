@@ -0,0 +1,82 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __FTP_FANOUT_HPP
+#define __FTP_FANOUT_HPP
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+namespace ftp
+{
+
+// window of the most recently uploaded data of a file in progress, so
+// downloaders racing the upload can be served from memory rather than
+// rereading what was just written
+class FanoutRing
+{
+  std::mutex mutex;
+  std::vector<char> ring;
+  off_t start; // file offset of the oldest byte held
+  off_t end;   // file offset following the newest byte held
+  bool retired;
+  
+  void Copy(off_t offset, const char* buffer, size_t len);
+  
+public:
+  FanoutRing(size_t capacity, off_t offset);
+  
+  void Publish(const char* buffer, size_t len);
+  
+  // another upload of the path has started, what's held no longer
+  // matches the file so nothing more is served from it
+  void Retire();
+  bool Retired();
+  
+  // returns the number of bytes copied from offset onwards,
+  // zero if offset has fallen out of or is beyond the window
+  size_t Read(off_t offset, char* buffer, size_t len);
+};
+
+typedef std::shared_ptr<FanoutRing> FanoutRingPtr;
+
+class Fanout
+{
+  std::mutex mutex;
+  std::unordered_map<std::string, std::weak_ptr<FanoutRing>> rings;
+  
+  static std::unique_ptr<Fanout> instance;
+  
+  Fanout() = default;
+  
+public:
+  // called by the uploader, returns nullptr if fanout_buffer is disabled
+  FanoutRingPtr Create(const std::string& path, off_t offset);
+  FanoutRingPtr Find(const std::string& path);
+  
+  static Fanout& Get()
+  {
+    if (!instance) instance.reset(new Fanout());
+    return *instance;
+  }
+};
+
+} /* ftp namespace */
+
+#endif
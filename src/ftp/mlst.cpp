@@ -0,0 +1,94 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <boost/algorithm/string/predicate.hpp>
+#include "ftp/mlst.hpp"
+
+namespace ftp { namespace mlst
+{
+
+namespace
+{
+
+const struct
+{
+  Fact fact;
+  const char* name;
+} factNames[] =
+{
+  { Fact::Type,       "type"        },
+  { Fact::Size,       "size"        },
+  { Fact::Modify,     "modify"      },
+  { Fact::Perm,       "perm"        },
+  { Fact::Unique,     "unique"      },
+  { Fact::UnixMode,   "UNIX.mode"   },
+  { Fact::UnixOwner,  "UNIX.owner"  },
+  { Fact::UnixGroup,  "UNIX.group"  }
+};
+
+}
+
+Fact ParseFacts(const std::string& factList)
+{
+  Fact facts = Fact::None;
+  std::string::size_type start = 0;
+  while (start < factList.length())
+  {
+    std::string::size_type end = factList.find(';', start);
+    if (end == std::string::npos) end = factList.length();
+    
+    std::string name(factList, start, end - start);
+    for (const auto& fn : factNames)
+    {
+      if (boost::iequals(name, fn.name))
+      {
+        facts |= fn.fact;
+        break;
+      }
+    }
+    
+    start = end + 1;
+  }
+  return facts;
+}
+
+std::string FeatureString(Fact enabled)
+{
+  std::string features;
+  for (const auto& fn : factNames)
+  {
+    features += fn.name;
+    if (HasFact(enabled, fn.fact)) features += '*';
+    features += ';';
+  }
+  return features;
+}
+
+std::string FactsString(Fact enabled)
+{
+  std::string facts;
+  for (const auto& fn : factNames)
+  {
+    if (HasFact(enabled, fn.fact))
+    {
+      facts += fn.name;
+      facts += ';';
+    }
+  }
+  return facts;
+}
+
+} /* mlst namespace */
+} /* ftp namespace */
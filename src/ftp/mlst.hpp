@@ -0,0 +1,60 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __FTP_MLST_HPP
+#define __FTP_MLST_HPP
+
+#include <string>
+
+namespace ftp { namespace mlst
+{
+
+// RFC 3659 facts, a session can narrow them down with OPTS MLST
+enum class Fact : unsigned
+{
+  None        = 0,
+  Type        = 1 << 0,
+  Size        = 1 << 1,
+  Modify      = 1 << 2,
+  Perm        = 1 << 3,
+  Unique      = 1 << 4,
+  UnixMode    = 1 << 5,
+  UnixOwner   = 1 << 6,
+  UnixGroup   = 1 << 7,
+  All         = (1 << 8) - 1
+};
+
+inline Fact operator|(Fact f1, Fact f2)
+{ return static_cast<Fact>(static_cast<unsigned>(f1) | static_cast<unsigned>(f2)); }
+
+inline Fact& operator|=(Fact& f1, Fact f2)
+{ return f1 = f1 | f2; }
+
+inline bool HasFact(Fact facts, Fact fact)
+{ return (static_cast<unsigned>(facts) & static_cast<unsigned>(fact)) != 0; }
+
+// unknown facts are ignored as the rfc requires
+Fact ParseFacts(const std::string& factList);
+
+// every supported fact, those enabled are marked with an asterisk
+std::string FeatureString(Fact enabled);
+
+// enabled facts only, as echoed back by OPTS MLST
+std::string FactsString(Fact enabled);
+
+} /* mlst namespace */
+} /* ftp namespace */
+
+#endif
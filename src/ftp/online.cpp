@@ -13,9 +13,14 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <cassert>
 #include <cstring>
+#include <new>
 #include <sstream>
 #include <fstream>
+#include <type_traits>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/thread/thread.hpp>
 #include "ftp/online.hpp"
 #include "ftp/client.hpp"
 #include "acl/user.hpp"
@@ -27,18 +32,6 @@ using namespace boost::interprocess;
 namespace ftp
 {
 
-namespace
-{
-long ThreadIdToLong(const boost::thread::id& tid)
-{
-  std::stringstream ss;
-  ss << tid;
-  long ltid;
-  ss >> std::hex >> ltid;
-  return ltid;
-}
-}
-
 std::unique_ptr<OnlineWriter> OnlineWriter::instance;
 boost::posix_time::milliseconds OnlineTransferUpdater::interval(10);
 
@@ -49,6 +42,16 @@ OnlineXfer::OnlineXfer(stats::Direction direction, const boost::posix_time::ptim
 {
 }
 
+OnlineClient::OnlineClient() :
+  uid(-1),
+  command{0},
+  workDir{0},
+  ident{0},
+  ip{0},
+  hostname{0}
+{
+}
+
 OnlineClient::OnlineClient(
       acl::UserID uid, const std::string& ident, 
       const std::string& ip, const std::string& hostname,
@@ -63,9 +66,14 @@ OnlineClient::OnlineClient(
   strncpy(this->workDir, workDir.c_str(), sizeof(this->workDir));
 }
 
-OnlineData::OnlineData(boost::interprocess::managed_shared_memory& segment, int maxClients) :
-  clients(maxClients, std::hash<long>(), std::equal_to<long>(), segment.get_allocator<ShmOnlineMap::mapped_type>())
+OnlineData::OnlineData(int maxClients) :
+  maxClients(maxClients)
 {
+  OnlineSlot* slots = Slots();
+  for (int i = 0; i < maxClients; ++i)
+  {
+    new (&slots[i]) OnlineSlot();
+  }
 }
 
 OnlineWriter::OnlineWriter(const std::string& id, int maxClients) :
@@ -78,13 +86,11 @@ void OnlineWriter::OpenSharedMemory(int maxClients)
 {  
   try
   {
-    segment.reset(new managed_shared_memory(open_or_create, id.c_str(), clientSize * (maxClients + 1)));
-
-    segment->construct<OnlineData>("online")(*segment, maxClients);
-    data = segment->find<OnlineData>("online").first;
-    if (!data) throw util::SystemError(ENOMEM);
-    scoped_lock<interprocess_mutex> lock(data->mutex);
-    data->clients.clear();
+    shared_memory_object::remove(id.c_str());
+    shared_memory_object shm(create_only, id.c_str(), read_write);
+    shm.truncate(OnlineData::Size(maxClients));
+    region.reset(new mapped_region(shm, read_write));
+    data = new (region->get_address()) OnlineData(maxClients);
   }
   catch (const interprocess_exception& e)
   {
@@ -94,123 +100,101 @@ void OnlineWriter::OpenSharedMemory(int maxClients)
 
 OnlineWriter::~OnlineWriter()
 {
-  segment = nullptr;
+  region = nullptr;
   shared_memory_object::remove(id.c_str());
 }
 
-void OnlineWriter::LoggedIn(long tid, Client& client, const std::string& workDir)
-{
-  scoped_lock<interprocess_mutex> lock(data->mutex);
-  data->clients.insert(std::make_pair(tid, OnlineClient(client.User().ID(), client.Ident(), 
-              client.IP(), client.Hostname(), workDir)));  
-}
-
-void OnlineWriter::LoggedIn(const boost::thread::id& tid, Client& client, const std::string& workDir)
-{
-  LoggedIn(ThreadIdToLong(tid), client, workDir);
-}
-
-void OnlineWriter::LoggedOut(long tid)
-{
-  scoped_lock<interprocess_mutex> lock(data->mutex);
-  data->clients.erase(tid);
-}
-
-void OnlineWriter::LoggedOut(const boost::thread::id& tid)
+template <typename Function>
+void OnlineWriter::Write(int slot, Function function)
 {
-  LoggedOut(ThreadIdToLong(tid));
+  if (slot < 0) return;
+  OnlineSlot& s = data->Slots()[slot];
+  unsigned sequence = s.sequence.load(std::memory_order_relaxed);
+  s.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  function(s);
+  s.sequence.store(sequence + 2, std::memory_order_release);
 }
 
-void OnlineWriter::Command(long tid, const std::string& command)
+int OnlineWriter::LoggedIn(Client& client, const std::string& workDir)
 {
-  scoped_lock<interprocess_mutex> lock(data->mutex);
-  auto it = data->clients.find(tid);
-  verify(it != data->clients.end());
-  strncpy(it->second.command, command.c_str(), sizeof(it->second.command));
+  OnlineSlot* slots = data->Slots();
+  for (int slot = 0; slot < data->maxClients; ++slot)
+  {
+    bool claimed = false;
+    if (slots[slot].claimed.compare_exchange_strong(claimed, true))
+    {
+      OnlineClient online(client.User().ID(), client.Ident(), 
+                          client.IP(), client.Hostname(), workDir);
+      Write(slot, [&](OnlineSlot& s)
+        {
+          s.client = online;
+          s.online = true;
+        });
+      return slot;
+    }
+  }
+  return -1;
 }
 
-void OnlineWriter::Command(const boost::thread::id& tid, const std::string& command)
+void OnlineWriter::LoggedOut(int slot)
 {
-  Command(ThreadIdToLong(tid), command);
+  if (slot < 0) return;
+  Write(slot, [](OnlineSlot& s) { s.online = false; });
+  data->Slots()[slot].claimed.store(false, std::memory_order_release);
 }
 
-void OnlineWriter::Idle(long tid)
+void OnlineWriter::Command(int slot, const std::string& command)
 {
-  scoped_lock<interprocess_mutex> lock(data->mutex);
-  auto it = data->clients.find(tid);
-  verify(it != data->clients.end());
-  it->second.command[0] = '\0';
-  it->second.lastCommand = boost::posix_time::second_clock::local_time();
+  Write(slot, [&](OnlineSlot& s)
+    {
+      strncpy(s.client.command, command.c_str(), sizeof(s.client.command));
+    });
 }
 
-void OnlineWriter::Idle(const boost::thread::id& tid)
+void OnlineWriter::Idle(int slot)
 {
-  Idle(ThreadIdToLong(tid));
+  auto now = boost::posix_time::second_clock::local_time();
+  Write(slot, [&](OnlineSlot& s)
+    {
+      s.client.command[0] = '\0';
+      s.client.lastCommand = now;
+    });
 }
 
-void OnlineWriter::StartTransfer(long tid, stats::Direction direction, 
+void OnlineWriter::StartTransfer(int slot, stats::Direction direction, 
                                  const boost::posix_time::ptime& start)
 {
-  scoped_lock<interprocess_mutex> lock(data->mutex);
-  auto it = data->clients.find(tid);
-  verify(it != data->clients.end());
-  it->second.xfer.reset(OnlineXfer(direction, start));
-}
-
-void OnlineWriter::TransferUpdate(long tid, long long bytes)
-{
-  scoped_lock<interprocess_mutex> lock(data->mutex);
-  auto it = data->clients.find(tid);
-  verify(it != data->clients.end());
-  assert(it->second.xfer);
-  it->second.xfer->bytes = bytes;
-}
-
-void OnlineWriter::StopTransfer(long tid)
-{
-  scoped_lock<interprocess_mutex> lock(data->mutex);
-  auto it = data->clients.find(tid);
-  verify(it != data->clients.end());
-  assert(it->second.xfer);
-  it->second.xfer = boost::none;
-}
-
-OnlineReaderIterator::OnlineReaderIterator(const OnlineReader* const reader) :
-  reader(reader)
-{
-  if (reader && reader->data) iter.reset(reader->data->clients.begin());
-}
-
-OnlineReaderIterator::OnlineReaderIterator(const OnlineReader* const reader, bool /* end */) :
-  reader(reader)
-{
-  if (reader && reader->data) iter.reset(reader->data->clients.end());
+  Write(slot, [&](OnlineSlot& s) { s.client.xfer.reset(OnlineXfer(direction, start)); });
 }
 
-OnlineReaderIterator& OnlineReaderIterator::operator++()
+void OnlineWriter::TransferUpdate(int slot, long long bytes)
 {
-  client = boost::none;
-  verify(iter && reader && reader->locked);
-  ++(*iter);
-  return *this;
+  Write(slot, [&](OnlineSlot& s)
+    {
+      assert(s.client.xfer);
+      s.client.xfer->bytes = bytes;
+    });
 }
 
-OnlineReaderIterator OnlineReaderIterator::operator++(int)
+void OnlineWriter::StopTransfer(int slot)
 {
-  client = boost::none;
-  verify(iter && reader && reader->locked);
-  OnlineReaderIterator temp(*this);
-  ++(*iter);
-  return temp;
+  Write(slot, [](OnlineSlot& s) { s.client.xfer = boost::none; });
 }
 
 OnlineReader::OnlineReader(const std::string& id) :    
-  data(nullptr), locked(false)
+  data(nullptr)
 {
   try
   {
-    segment.reset(new managed_shared_memory(open_only, id.c_str()));
-    data = segment->find<OnlineData>("online").first;
+    shared_memory_object shm(open_only, id.c_str(), read_only);
+    region.reset(new mapped_region(shm, read_only));
+    data = static_cast<const OnlineData*>(region->get_address());
+    if (region->get_size() < sizeof(OnlineData) ||
+        region->get_size() < OnlineData::Size(data->maxClients))
+    {
+      data = nullptr;
+    }
   }
   catch (const boost::interprocess::interprocess_exception& e)
   {
@@ -220,57 +204,68 @@ OnlineReader::OnlineReader(const std::string& id) :
 
 OnlineReader::~OnlineReader()
 {
-  segment = nullptr;
-  shared_memory_object::remove(id.c_str());
-}
-
-OnlineReaderIterator OnlineReader::begin() const
-{
-  verify(locked);
-  return OnlineReaderIterator(this);
-}
-
-OnlineReaderIterator OnlineReader::end() const
-{
-  verify(locked);
-  return OnlineReaderIterator(this, true);
 }
 
-OnlineReader::size_type OnlineReader::size() const
+bool OnlineReader::Read(const OnlineSlot& slot, OnlineClient& client)
 {
-  if (!data) return 0;
-  if (locked) return data->clients.size();
-  else
+  // the copy is taken as raw bytes as it may be torn, it is only
+  // treated as an OnlineClient once the sequence confirms it isn't
+  std::aligned_storage<sizeof(OnlineClient), alignof(OnlineClient)>::type copy;
+  for (int attempt = 0; attempt < maximumReadAttempts; ++attempt)
   {
-    scoped_lock<interprocess_mutex> lock(data->mutex);
-    return data->clients.size();
+    // a writer holds the slot for a handful of stores, yield to let it
+    // finish and back off to sleeping if it doesn't, a busy slot must
+    // never keep the reader burning a core
+    if (attempt >= yieldReadAttempts) 
+      boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+    else if (attempt > 0) 
+      boost::this_thread::yield();
+    
+    unsigned before = slot.sequence.load(std::memory_order_acquire);
+    if (before & 1) continue;
+    
+    bool online = slot.online;
+    std::memcpy(&copy, &slot.client, sizeof(copy));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    
+    if (slot.sequence.load(std::memory_order_relaxed) == before)
+    {
+      if (!online) return false;
+      client = *reinterpret_cast<const OnlineClient*>(&copy);
+      return true;
+    }
   }
+  
+  // writer never let go, left out of this snapshot
+  return false;
 }
 
-void OnlineReader::Lock() const
-{
-  locked = true;
-  if (data) data->mutex.lock();
-}
-
-void OnlineReader::Unlock() const
+std::vector<OnlineClient> OnlineReader::Snapshot() const
 {
-  locked = false;
-  if (data) data->mutex.unlock();
+  std::vector<OnlineClient> clients;
+  if (!data) return clients;
+  
+  const OnlineSlot* slots = data->Slots();
+  OnlineClient client;
+  for (int i = 0; i < data->maxClients; ++i)
+  {
+    if (Read(slots[i], client)) clients.emplace_back(client);
+  }
+  return clients;
 }
 
 OnlineTransferUpdater::OnlineTransferUpdater(
-        const boost::thread::id& tid, stats::Direction direction,
+        int slot, stats::Direction direction,
         const boost::posix_time::ptime& start) :
-  tid(ThreadIdToLong(tid)),
+  slot(slot),
   nextUpdate(start)
 {
-  OnlineWriter::Get().StartTransfer(this->tid, direction, start);
+  OnlineWriter::Get().StartTransfer(slot, direction, start);
 }
 
 OnlineTransferUpdater::~OnlineTransferUpdater()
 {
-  OnlineWriter::Get().StopTransfer(tid);
+  OnlineWriter::Get().StopTransfer(slot);
 }
 
 std::string SharedMemoryID(pid_t pid)
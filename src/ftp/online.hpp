@@ -13,17 +13,13 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-#include <iterator>
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
-#include <boost/interprocess/segment_manager.hpp>
-#include <boost/interprocess/managed_shared_memory.hpp>
-// #include <boost/interprocess/containers/map.hpp>
-#include <boost/interprocess/allocators/allocator.hpp>
-#include <boost/thread/thread.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/interprocess/mapped_region.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/optional.hpp>
-#include <boost/unordered_map.hpp>
 #include <limits.h>
 #if defined(__FreeBSD__)
 #include <sys/param.h>
@@ -31,7 +27,6 @@
 #include <netinet/in.h>
 #include "acl/types.hpp"
 #include "stats/types.hpp"
-#include "util/verify.hpp"
 
 namespace ftp
 {
@@ -64,6 +59,7 @@ struct OnlineClient
   
   boost::optional<OnlineXfer> xfer;
 
+  OnlineClient();
   OnlineClient(acl::UserID uid, const std::string& ident, 
                const std::string& ip, const std::string& hostname,
                const std::string& workDir);
@@ -71,17 +67,32 @@ struct OnlineClient
   bool IsIdle() const { return command[0] == '\0'; }
 };
 
-typedef boost::interprocess::managed_shared_memory::segment_manager SegmentManager;
-typedef boost::interprocess::allocator<std::pair<const long, OnlineClient>, 
-                                       SegmentManager> ShmOnlineMapAlloc;
-typedef boost::unordered_map<long, OnlineClient, std::hash<long>, std::equal_to<long>, ShmOnlineMapAlloc> ShmOnlineMap;
+// each client owns one cache line aligned slot for the whole session, the
+// owning thread is the only writer so updates need no lock, only a sequence
+// counter that is odd while the slot is being written. readers copy a slot
+// and retry if the sequence moved underneath them, backing off and in the
+// end giving up on the slot rather than spinning
+struct alignas(64) OnlineSlot
+{
+  std::atomic<bool> claimed;      // slot allocation, server process only
+  std::atomic<unsigned> sequence; // odd while being written
+  bool online;
+  OnlineClient client;
+  
+  OnlineSlot() : claimed(false), sequence(0), online(false) { }
+};
 
-struct OnlineData
+struct alignas(64) OnlineData
 {
-  ShmOnlineMap clients;
-  boost::interprocess::interprocess_mutex mutex;
+  int maxClients;
   
-  OnlineData(boost::interprocess::managed_shared_memory& segment, int maxClients);
+  OnlineData(int maxClients);
+  
+  OnlineSlot* Slots() { return reinterpret_cast<OnlineSlot*>(this + 1); }
+  const OnlineSlot* Slots() const { return reinterpret_cast<const OnlineSlot*>(this + 1); }
+  
+  static size_t Size(int maxClients)
+  { return sizeof(OnlineData) + sizeof(OnlineSlot) * maxClients; }
 };
 
 class Client;
@@ -90,32 +101,29 @@ class OnlineTransferUpdater;
 class OnlineWriter
 {
   std::string id;
-  std::unique_ptr<boost::interprocess::managed_shared_memory> segment;
+  std::unique_ptr<boost::interprocess::mapped_region> region;
   OnlineData* data;
 
   static std::unique_ptr<OnlineWriter> instance;
-  constexpr static float clientOverhead = 0.02;
-  constexpr static size_t clientSize = sizeof(OnlineClient) * (1 + clientOverhead);
 
   OnlineWriter(const std::string& id, int maxClients);
   void OpenSharedMemory(int maxClients);
 
-  void LoggedIn(long tid, Client& client, const std::string& workDir);
-  void LoggedOut(long tid);
-  void Command(long tid, const std::string& command);
-  void Idle(long tid);
+  template <typename Function>
+  void Write(int slot, Function function);
 
-  void StartTransfer(long tid, stats::Direction direction, const boost::posix_time::ptime& start);
-  void TransferUpdate(long tid, long long bytes);
-  void StopTransfer(long tid);
+  void StartTransfer(int slot, stats::Direction direction, const boost::posix_time::ptime& start);
+  void TransferUpdate(int slot, long long bytes);
+  void StopTransfer(int slot);
   
 public:
   ~OnlineWriter();
   
-  void LoggedIn(const boost::thread::id& tid, Client& client, const std::string& workDir);
-  void LoggedOut(const boost::thread::id& tid);
-  void Command(const boost::thread::id& tid, const std::string& command);
-  void Idle(const boost::thread::id& tid);
+  // returns the slot for all further updates, or -1 if the table is full
+  int LoggedIn(Client& client, const std::string& workDir);
+  void LoggedOut(int slot);
+  void Command(int slot, const std::string& command);
+  void Idle(int slot);
   
   static void Initialise(const std::string& id, int maxClients)
   {
@@ -132,114 +140,33 @@ public:
   friend class OnlineTransferUpdater;
 };
 
-class OnlineReaderLock;
-class OnlineReader;
-
-class OnlineReaderIterator : public std::iterator<std::forward_iterator_tag, OnlineClient>
-{
-  const OnlineReader* const reader;
-  boost::optional<ShmOnlineMap::iterator> iter;
-  mutable boost::optional<OnlineClient> client;
-    
-  OnlineReaderIterator(const OnlineReader* const reader, bool end); 
-  OnlineReaderIterator(const OnlineReader* const reader);
-  
-public:
-    
-  OnlineReaderIterator& operator++();
-  OnlineReaderIterator operator++(int);
-  
-  bool operator==(const OnlineReaderIterator& rhs) const
-  {
-    if (!iter && !rhs.iter) return true;
-    verify(iter);
-    return *iter == *rhs.iter;
-  }
-  
-  bool operator!=(const OnlineReaderIterator& rhs) const
-  {
-    return !operator==(rhs);
-  }
-  
-  const OnlineClient& operator*() const
-  {
-    if (!client) client.reset((*iter)->second);
-    return *client;
-  }
-
-  const OnlineClient* operator->() const
-  {
-    if (!client) client.reset((*iter)->second);
-    return &*client;
-  }
-  
-  friend class OnlineReader;
-};
-
 class OnlineReader
 {
-  std::string id;
-  std::unique_ptr<boost::interprocess::managed_shared_memory> segment;
-  OnlineData* data;
-  mutable bool locked;
+  std::unique_ptr<boost::interprocess::mapped_region> region;
+  const OnlineData* data;
   
-  void Lock() const;
-  void Unlock() const;
+  static const int yieldReadAttempts = 16;
+  static const int maximumReadAttempts = 1000;
+  
+  static bool Read(const OnlineSlot& slot, OnlineClient& client);
   
 public:
-  typedef OnlineReaderIterator const_iterator;
-  typedef OnlineClient value_type;
-  typedef ShmOnlineMap::size_type size_type;
-
   OnlineReader(const std::string& id);
   ~OnlineReader();
   
-  OnlineReaderIterator begin() const;
-  OnlineReaderIterator end() const;
-  
-  size_type size() const;
-
-  friend class OnlineReaderLock;
-  friend class OnlineReaderIterator;
-};
-
-class OnlineReaderLock
-{
-  const OnlineReader& reader;
-  bool released;
-  
-public:
-  OnlineReaderLock(const OnlineReader& reader) :
-    reader(reader), released(false)
-  {
-    reader.Lock();
-  }
-  
-  ~OnlineReaderLock()
-  {
-    if (!released)
-    {
-      reader.Unlock();
-    }
-  }
-  
-  void Release()
-  {
-    verify(!released);
-    reader.Unlock();
-    released = true;
-  }
+  // consistent copy of every online client, never blocks the server
+  std::vector<OnlineClient> Snapshot() const;
 };
 
 class OnlineTransferUpdater
 {
-  long tid;
+  int slot;
   boost::posix_time::ptime nextUpdate;
   
   static boost::posix_time::milliseconds interval;
   
 public:
-  OnlineTransferUpdater(const boost::thread::id& tid, stats::Direction direction,
+  OnlineTransferUpdater(int slot, stats::Direction direction,
                         const boost::posix_time::ptime& start);
   
   ~OnlineTransferUpdater();
@@ -249,7 +176,7 @@ public:
     auto now = boost::posix_time::microsec_clock::local_time();
     if (now >= nextUpdate)
     {
-      OnlineWriter::Get().TransferUpdate(tid, bytes);
+      OnlineWriter::Get().TransferUpdate(slot, bytes);
       nextUpdate = now + interval;
     }
   }
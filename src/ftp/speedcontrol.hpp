@@ -17,6 +17,8 @@
 #define __FTP_SPEEDCONTROL_HPP
 
 #include <algorithm>
+#include <chrono>
+#include <memory>
 #include <vector>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/thread/thread.hpp>
@@ -24,12 +26,15 @@
 #include "cfg/setting.hpp"
 #include "ftp/error.hpp"
 #include "ftp/counter.hpp"
-#include "stats/util.hpp"
 #include "ftp/client.hpp"
 #include "acl/misc.hpp"
 #include "ftp/data.hpp"
 #include "acl/user.hpp"
 #include "fs/path.hpp"
+#include "util/tokenbucket.hpp"
+#include "ftp/fairshare.hpp"
+#include "acl/flags.hpp"
+#include "cfg/get.hpp"
 
 namespace ftp
 {
@@ -37,77 +42,102 @@ namespace ftp
 class SpeedControl
 {
 private:
+  typedef std::chrono::steady_clock Clock;
+
   long long minimumSpeed;
-  long long maximumSpeed;
   const TransferState& state;
-  std::vector<const cfg::SpeedLimit*> globalLimits;
-  SpeedCounter& globalCounter;
-  boost::posix_time::ptime lastMinimumOk;
-  SpeedInfoOpt lastSpeedInfo;
+  std::unique_ptr<util::TokenBucket> personalBucket;
+  std::vector<SpeedBucketPtr> globalBuckets;
+  FairShareTransferPtr fairShare;
+  Clock::time_point startTime;
+  Clock::time_point lastMinimumOk;
+  long long lastBytes;
   
   static const int minimumSpeedKickTime = 5;
   
-  inline void CheckMinimum(double speed)
+  inline void CheckMinimum(long long bytes, const Clock::time_point& now)
   {
-    auto now = boost::posix_time::microsec_clock::local_time();
+    double seconds = std::chrono::duration<double>(now - startTime).count();
+    double speed = seconds > 0 ? bytes / seconds / 1024 : bytes / 1024;
     if (speed > minimumSpeed)
     {
       lastMinimumOk = now;
     }
     else
-    if ((now - lastMinimumOk).total_seconds() > minimumSpeedKickTime)
+    if (now - lastMinimumOk > std::chrono::seconds(minimumSpeedKickTime))
     {
       throw ftp::MinimumSpeedError(minimumSpeed, speed);
     }
   }
 
 protected:
+  static FairShareTransferPtr RegisterFairShare(const ftp::Client& client, 
+                                                const fs::VirtualPath& path,
+                                                ::stats::Direction direction)
+  {
+    const acl::User& user = client.User();
+    if (user.HasFlag(acl::Flag::Exempt)) return nullptr;
+    auto section = cfg::Get().SectionMatch(path.ToString());
+    return FairShareScheduler::Get().Register(direction, section ? section->Name() : "DEFAULT",
+                                              user.PrimaryGroup(), user.Name());
+  }
+
   SpeedControl(int minimumSpeed, int maximumSpeed, 
                   const TransferState& state, 
-                  std::vector<const cfg::SpeedLimit*>&& globalLimits,
-                  SpeedCounter& globalCounter) :
+                  const std::vector<const cfg::SpeedLimit*>& globalLimits,
+                  SpeedCounter& globalCounter,
+                  const FairShareTransferPtr& fairShare) :
     minimumSpeed(minimumSpeed),
-    maximumSpeed(maximumSpeed),
     state(state),
-    globalLimits(globalLimits),
-    globalCounter(globalCounter),
-    lastMinimumOk(boost::posix_time::microsec_clock::local_time())
+    personalBucket(maximumSpeed > 0 ? 
+                   new util::TokenBucket(maximumSpeed * 1024LL, SpeedCounter::maximumBurst) : 
+                   nullptr),
+    globalBuckets(globalCounter.Acquire(globalLimits)),
+    fairShare(fairShare),
+    startTime(Clock::now()),
+    lastMinimumOk(startTime),
+    lastBytes(state.Bytes())
   {
   }
   
 public:
   inline void Apply()
   {
-    if (minimumSpeed == 0 && maximumSpeed == 0 && globalLimits.empty()) return;
+    if (minimumSpeed <= 0 && !personalBucket && globalBuckets.empty() && !fairShare) return;
 
-    auto speedInfo = ftp::SpeedInfo(state.Duration(), state.Bytes());
+    long long bytes = state.Bytes();
+    long long consumed = bytes - lastBytes;
+    lastBytes = bytes;
     
     if (minimumSpeed > 0)
     {
-      CheckMinimum(speedInfo.Speed() / 1024);
+      CheckMinimum(bytes, Clock::now());
     }
     
-    boost::posix_time::time_duration sleepTime(boost::posix_time::microseconds(0));
+    std::chrono::nanoseconds sleepTime(0);
+    if (personalBucket)
+    {
+      sleepTime = personalBucket->Consume(consumed);
+    }
     
-    if (maximumSpeed > 0)
+    for (auto& bucket : globalBuckets)
     {
-      sleepTime = stats::SpeedLimitSleep(speedInfo.xfertime, speedInfo.bytes, 
-                                         maximumSpeed * 1024);
+      sleepTime = std::max(sleepTime, bucket->Consume(consumed));
     }
     
-    if (!globalLimits.empty())
+    if (fairShare)
     {
-      sleepTime = std::max(sleepTime, globalCounter.Update(lastSpeedInfo, speedInfo, globalLimits));
+      sleepTime = std::max(sleepTime, fairShare->Consume(consumed));
     }
     
-    boost::this_thread::sleep(sleepTime);
-    lastSpeedInfo = speedInfo;
+    if (sleepTime.count() > 0)
+    {
+      auto micros = std::chrono::duration_cast<std::chrono::microseconds>(sleepTime);
+      boost::this_thread::sleep(boost::posix_time::microseconds(micros.count()));
+    }
   }
   
-  virtual ~SpeedControl()
-  {
-    globalCounter.Clear(lastSpeedInfo, globalLimits);
-  }
+  virtual ~SpeedControl() { }
 };
 
 class UploadSpeedControl : public SpeedControl
@@ -118,7 +148,8 @@ public:
                  client.User().MaxUpSpeed(),
                  client.Data().State(),
                  acl::speed::UploadMaximum(client.User(), path),
-                 Counter::UploadSpeeds())
+                 Counter::UploadSpeeds(),
+                 RegisterFairShare(client, path, ::stats::Direction::Upload))
   {
   }
 };
@@ -131,7 +162,8 @@ public:
                  client.User().MaxDownSpeed(),
                  client.Data().State(),
                  acl::speed::DownloadMaximum(client.User(), path),
-                 Counter::DownloadSpeeds())
+                 Counter::DownloadSpeeds(),
+                 RegisterFairShare(client, path, ::stats::Direction::Download))
   {
   }
 };
@@ -13,60 +13,47 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-#include <algorithm>
 #include "ftp/speedcounter.hpp"
-#include "stats/util.hpp"
 #include "cfg/setting.hpp"
 
 namespace ftp
 {
 
-boost::posix_time::time_duration 
-SpeedCounter::Update(const SpeedInfoOpt& last, const SpeedInfo& current, const SpeedLimitList& limits)
+const std::chrono::milliseconds SpeedCounter::maximumBurst(100);
+
+std::vector<SpeedBucketPtr> SpeedCounter::Acquire(const SpeedLimitList& limits)
 {
-  boost::posix_time::time_duration sleep = boost::posix_time::microseconds(0);
+  std::vector<SpeedBucketPtr> acquired;
+  if (limits.empty()) return acquired;
+  
+  acquired.reserve(limits.size());
   std::lock_guard<std::mutex> lock(mutex);
-  for (const auto& limit : limits)
+  for (auto it = buckets.begin(); it != buckets.end();)
   {
-    auto it = speeds.find(limit->Path());
-    if (it == speeds.end())
-    {
-      auto result = speeds.insert(std::make_pair(
-            limit->Path(), std::make_pair(1, current)));
-      it = result.first;
-    }
-    else
-    {
-      if (last) it->second.second -= *last;
-      else ++it->second.first;
-      it->second.second += current;
-    }
-
-    sleep = std::max(sleep, stats::SpeedLimitSleep(it->second.second.xfertime / it->second.first, 
-                                                   it->second.second.bytes, 
-                                                   getSpeedLimit(*limit) * 1024));
+    if (it->second.expired()) it = buckets.erase(it);
+    else ++it;
   }
-  return sleep;
-}
-
-void SpeedCounter::Clear(const SpeedInfoOpt& last, const SpeedLimitList& limits)
-{
-  if (!last) return;
   
-  std::lock_guard<std::mutex> lock(mutex);
   for (const auto& limit : limits)
   {
-    auto it = speeds.find(limit->Path());
-    if (it != speeds.end())
+    long long rate = getSpeedLimit(*limit) * 1024;
+    auto& weak = buckets[limit->Path()];
+    auto bucket = weak.lock();
+    if (!bucket)
+    {
+      bucket = std::make_shared<util::TokenBucket>(rate, maximumBurst);
+      weak = bucket;
+    }
+    else
+    if (bucket->Rate() != rate)
     {
-      if (--it->second.first <= 0)
-      {
-        speeds.erase(it);
-      }
-      else
-        it->second.second -= *last;
+      // config has been reloaded since the bucket was created
+      bucket->SetRate(rate);
     }
+    
+    acquired.emplace_back(std::move(bucket));
   }
+  return acquired;
 }
 
 } /* ftp namespace */
@@ -16,14 +16,14 @@
 #ifndef __SPEEDCOUNTER_HPP
 #define __SPEEDCOUNTER_HPP
 
-#include <cassert>
-#include <mutex>
-#include <boost/date_time/posix_time/posix_time.hpp>
-#include <unordered_map>
+#include <chrono>
 #include <functional>
-#include <boost/optional.hpp>
+#include <memory>
+#include <mutex>
 #include <string>
-#include "acl/types.hpp"
+#include <unordered_map>
+#include <vector>
+#include "util/tokenbucket.hpp"
 
 namespace cfg
 {
@@ -35,52 +35,14 @@ namespace ftp
 
 enum class CounterResult : int;
 
-struct SpeedInfo
-{
-  boost::posix_time::time_duration xfertime;
-  long long bytes;
-  
-  SpeedInfo() :
-    xfertime(boost::posix_time::microseconds(0)), bytes(0)
-  { }
-  
-  SpeedInfo(const boost::posix_time::time_duration& xfertime, long long bytes) :
-    xfertime(xfertime), bytes(bytes) 
-  { }
-  
-  SpeedInfo& operator+=(const SpeedInfo& rhs)
-  {
-    xfertime += rhs.xfertime;
-    bytes += rhs.bytes;
-    return *this;
-  }
-  
-  SpeedInfo& operator-=(const SpeedInfo& rhs)
-  {
-    xfertime -= rhs.xfertime;
-    bytes -= rhs.bytes;
-    
-    assert(xfertime >= boost::posix_time::microseconds(0));
-    assert(bytes >= 0);
-    
-    return *this;
-  }
-  
-  double Speed() const 
-  {
-    if (xfertime.total_microseconds() == 0)
-      return bytes;
-    else
-      return bytes / (xfertime.total_microseconds() / 1000000.0);
-  }
-};
-
-typedef boost::optional<SpeedInfo> SpeedInfoOpt;
+typedef std::shared_ptr<util::TokenBucket> SpeedBucketPtr;
 
+// registry of token buckets shared by all transfers matching the same
+// maximum_speed path, buckets are only looked up when a transfer starts
 class SpeedCounter
 {
   std::mutex mutex;
-  std::unordered_map<std::string, std::pair<int, SpeedInfo>> speeds;
+  std::unordered_map<std::string, std::weak_ptr<util::TokenBucket>> buckets;
   std::function<long long(const cfg::SpeedLimit&)> getSpeedLimit;
 
   SpeedCounter(const std::function<long long(const cfg::SpeedLimit&)>& getSpeedLimit) :
@@ -93,12 +55,11 @@ class SpeedCounter
   SpeedCounter(SpeedCounter&&) = delete;
   
 public:
+  static const std::chrono::milliseconds maximumBurst;
 
-  typedef std::vector<const cfg::SpeedLimit*>& SpeedLimitList;
+  typedef std::vector<const cfg::SpeedLimit*> SpeedLimitList;
   
-  boost::posix_time::time_duration 
-  Update(const SpeedInfoOpt& last, const SpeedInfo& current, const SpeedLimitList& limits);
-  void Clear(const SpeedInfoOpt& last, const SpeedLimitList& limits);
+  std::vector<SpeedBucketPtr> Acquire(const SpeedLimitList& limits);
   
   friend class Counter;
 };
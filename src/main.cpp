@@ -26,6 +26,10 @@
 #include "util/net/error.hpp"
 #include "logs/logs.hpp"
 #include "fs/owner.hpp"
+#include "fs/follow.hpp"
+#include "fs/dircache.hpp"
+#include "fs/listingpool.hpp"
+#include "fs/trash.hpp"
 #include "cfg/config.hpp"
 #include "cfg/get.hpp"
 #include "cfg/error.hpp"
@@ -44,8 +48,14 @@
 #include "db/initialise.hpp"
 #include "util/scopeguard.hpp"
 #include "db/replicator.hpp"
+#include "db/stats/aggregator.hpp"
+#include "db/stats/weekly.hpp"
+#include "db/user/creditledger.hpp"
+#include "db/writebehind.hpp"
 #include "ftp/online.hpp"
+#include "ftp/fairshare.hpp"
 #include "fs/mode.hpp"
+#include "fs/realpathcache.hpp"
 
 #include "version.hpp"
 
@@ -166,7 +176,9 @@ int Main(int argc, char** argv)
   cfg::Config::PopulateACLKeywords(cmd::site::Factory::ACLKeywords());
   ftp::InitialisePortAllocators();
   ftp::InitialiseAddrAllocators();
+  ftp::InitialiseFairShare();
   fs::InitialiseUmask();
+  fs::InitialiseRealpathCache();
   
   try
   {
@@ -247,11 +259,28 @@ int Main(int argc, char** argv)
       {
         ftp::OnlineWriter::Initialise(ftp::SharedMemoryID(), cfg::Config::MaxOnline().Total());
         signals::Handler::StartThread();
+        db::WriteBehind::Get().Start();
         db::Replicator::Get().Start();
+        db::stats::WeeklyCounters::Get().Load();
+        db::stats::Aggregator::Get().Start();
+        db::CreditLedger::Get().Start();
+        ftp::FairShareScheduler::Get().Start();
+        fs::FileFollower::Get().Start();
+        fs::DirCache::Get().Start();
+        fs::ListingPool::Get().Start();
+        fs::TrashReaper::Get().Start();
         ftp::Server::Get().StartThread();
         ftp::Server::Get().JoinThread();
+        ftp::FairShareScheduler::Get().Stop();
+        fs::FileFollower::Get().Stop();
+        fs::DirCache::Get().Stop();
+        fs::ListingPool::Get().Stop();
+        fs::TrashReaper::Get().Stop();
         db::Replicator::Get().Stop();
         ftp::Server::Cleanup();
+        db::stats::Aggregator::Get().Stop();
+        db::CreditLedger::Get().Stop();
+        db::WriteBehind::Get().Stop();
         signals::Handler::StopThread();
         ftp::OnlineWriter::Cleanup();
       }
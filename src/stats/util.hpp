@@ -53,10 +53,6 @@ double CalculateSpeed(long long bytes, const boost::posix_time::time_duration& d
 double CalculateSpeed(long long bytes, const boost::posix_time::ptime& start, 
         const boost::posix_time::ptime& end);
 
-boost::posix_time::time_duration SpeedLimitSleep(
-      const boost::posix_time::time_duration& xfertime, 
-      long long bytes, long long limitBytes);
-        
 std::string AutoUnitSpeedString(double speed);
 std::string AutoUnitString(double kBytes);
 std::string HighResSecondsString(const boost::posix_time::time_duration& duration);
@@ -0,0 +1,65 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#define BOOST_TEST_MODULE creditledger
+#include <boost/test/included/unit_test.hpp>
+#include "db/user/creditledger.hpp"
+
+using db::CreditLedger;
+
+BOOST_AUTO_TEST_CASE(seeded_once)
+{
+  auto& ledger = CreditLedger::Get();
+  BOOST_CHECK_EQUAL(ledger.Balance(1, "", 1000), 1000);
+  
+  // a later, stale seed doesn't replace the cached balance
+  BOOST_CHECK_EQUAL(ledger.Balance(1, "", 5000), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(changed_externally_while_cached)
+{
+  auto& ledger = CreditLedger::Get();
+  BOOST_CHECK_EQUAL(ledger.Balance(2, "", 1000), 1000);
+  BOOST_CHECK_EQUAL(ledger.Balance(2, "MP3", 300), 300);
+  
+  // another node takes credits, the user is then replicated
+  ledger.Reconcile(2, { { "", 400 }, { "MP3", 300 } }, ledger.Generation());
+  BOOST_CHECK_EQUAL(ledger.Balance(2, "", 1000), 400);
+  BOOST_CHECK_EQUAL(ledger.Balance(2, "MP3", 300), 300);
+  
+  // a section missing from the stored credits has none
+  ledger.Reconcile(2, { { "", 400 } }, ledger.Generation());
+  BOOST_CHECK_EQUAL(ledger.Balance(2, "MP3", 300), 0);
+}
+
+BOOST_AUTO_TEST_CASE(reconcile_only_touches_that_user)
+{
+  auto& ledger = CreditLedger::Get();
+  BOOST_CHECK_EQUAL(ledger.Balance(3, "", 100), 100);
+  BOOST_CHECK_EQUAL(ledger.Balance(4, "", 200), 200);
+  
+  ledger.Reconcile(3, { { "", 50 } }, ledger.Generation());
+  BOOST_CHECK_EQUAL(ledger.Balance(3, "", 100), 50);
+  BOOST_CHECK_EQUAL(ledger.Balance(4, "", 200), 200);
+}
+
+BOOST_AUTO_TEST_CASE(deleted_user_reseeded)
+{
+  auto& ledger = CreditLedger::Get();
+  BOOST_CHECK_EQUAL(ledger.Balance(5, "", 100), 100);
+  ledger.Forget(5);
+  BOOST_CHECK_EQUAL(ledger.Balance(5, "", 700), 700);
+}
@@ -0,0 +1,135 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#define BOOST_TEST_MODULE dirsnapshot
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <boost/test/included/unit_test.hpp>
+#include "fs/direnumerator.hpp"
+#include "util/path/path.hpp"
+#include "util/error.hpp"
+
+namespace
+{
+
+// a scratch directory with one of each kind of entry
+struct Scratch
+{
+  std::string root;
+  
+  Scratch()
+  {
+    char tmpl[] = "/tmp/dirsnapshot.XXXXXX";
+    BOOST_REQUIRE(mkdtemp(tmpl));
+    root = tmpl;
+    
+    std::ofstream(root + "/file") << std::string(12345, 'x');
+    std::ofstream(root + "/.hidden") << "h";
+    BOOST_REQUIRE(mkdir((root + "/dir").c_str(), 0755) == 0);
+    BOOST_REQUIRE(symlink("dir", (root + "/dirlink").c_str()) == 0);
+    BOOST_REQUIRE(symlink("file", (root + "/filelink").c_str()) == 0);
+    BOOST_REQUIRE(symlink("missing", (root + "/dangling").c_str()) == 0);
+  }
+  
+  ~Scratch()
+  {
+    for (const char* name : { "file", ".hidden", "dirlink", "filelink", "dangling" })
+      unlink((root + "/" + name).c_str());
+    rmdir((root + "/dir").c_str());
+    rmdir(root.c_str());
+  }
+};
+
+std::map<std::string, const fs::DirEntry*> ByName(const fs::DirSnapshot& snapshot)
+{
+  std::map<std::string, const fs::DirEntry*> entries;
+  for (const auto& de : snapshot.entries) entries[de.Path().ToString()] = &de;
+  return entries;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(same_as_path_based_status)
+{
+  Scratch scratch;
+  auto snapshot = fs::ReadSnapshot(fs::RealPath(scratch.root), false);
+  auto entries = ByName(*snapshot);
+  
+  BOOST_REQUIRE_EQUAL(entries.size(), 6);
+  BOOST_CHECK(!entries.count(".") && !entries.count(".."));
+  
+  off_t total = 0;
+  for (const auto& kv : entries)
+  {
+    // the fd relative stat must agree with a stat of the whole path
+    util::path::Status expected(util::path::Join(scratch.root, kv.first));
+    const auto& status = kv.second->Status();
+    BOOST_TEST_CHECKPOINT(kv.first);
+    BOOST_CHECK_EQUAL(status.IsRegularFile(), expected.IsRegularFile());
+    BOOST_CHECK_EQUAL(status.IsDirectory(), expected.IsDirectory());
+    BOOST_CHECK_EQUAL(status.IsSymLink(), expected.IsSymLink());
+    BOOST_CHECK_EQUAL(status.Size(), expected.Size());
+    BOOST_CHECK_EQUAL(status.ModTime(), expected.ModTime());
+    BOOST_CHECK_EQUAL(status.Native().st_mode, expected.Native().st_mode);
+    BOOST_CHECK_EQUAL(status.Native().st_ino, expected.Native().st_ino);
+    BOOST_CHECK_EQUAL(status.Native().st_nlink, expected.Native().st_nlink);
+    total += status.Size();
+  }
+  
+  BOOST_CHECK_EQUAL(snapshot->totalBytes, total);
+  BOOST_CHECK(!snapshot->owners);
+}
+
+BOOST_AUTO_TEST_CASE(symlinks_typed_by_target)
+{
+  Scratch scratch;
+  auto entries = ByName(*fs::ReadSnapshot(fs::RealPath(scratch.root), false));
+  
+  BOOST_CHECK(entries["dirlink"]->Status().IsSymLink());
+  BOOST_CHECK(entries["dirlink"]->Status().IsDirectory());
+  BOOST_CHECK(entries["filelink"]->Status().IsRegularFile());
+  BOOST_CHECK(entries["dangling"]->Status().IsSymLink());
+  BOOST_CHECK(!entries["dangling"]->Status().IsDirectory());
+  BOOST_CHECK(!entries["dangling"]->Status().IsRegularFile());
+}
+
+BOOST_AUTO_TEST_CASE(large_directory)
+{
+  // more entries than fit in one getdents buffer
+  char tmpl[] = "/tmp/dirsnapshot.XXXXXX";
+  BOOST_REQUIRE(mkdtemp(tmpl));
+  std::string root(tmpl);
+  const int count = 3000;
+  for (int i = 0; i < count; ++i)
+  {
+    std::ofstream(root + "/a-fairly-long-release-file-name." + std::to_string(i) + ".rar");
+  }
+  
+  auto snapshot = fs::ReadSnapshot(fs::RealPath(root), false);
+  BOOST_CHECK_EQUAL(snapshot->entries.size(), count);
+  
+  for (const auto& de : snapshot->entries) unlink((root + "/" + de.Path().ToString()).c_str());
+  rmdir(root.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(missing_directory)
+{
+  BOOST_CHECK_THROW(fs::ReadSnapshot(fs::RealPath("/nonexistent/dirsnapshot"), false),
+                    util::SystemError);
+}
@@ -0,0 +1,137 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#define BOOST_TEST_MODULE glob
+#include <cstdlib>
+#include <fnmatch.h>
+#include <boost/test/included/unit_test.hpp>
+#include "util/glob.hpp"
+
+namespace
+{
+
+// util::Glob is a drop in for fnmatch without flags, so everything is
+// checked against it rather than a hand written expectation
+void CheckAgainstFnmatch(const std::string& pattern, const std::string& str, bool iCase = false)
+{
+  util::Glob glob(pattern, iCase);
+  bool expected = !fnmatch(pattern.c_str(), str.c_str(), iCase ? FNM_CASEFOLD : 0);
+  BOOST_CHECK_MESSAGE(glob.Match(str) == expected, 
+      "pattern '" << pattern << "' against '" << str << "' should " <<
+      (expected ? "" : "not ") << "match" << (iCase ? " caselessly" : ""));
+}
+
+const char* strings[] =
+{
+  "", "/", "a", "ab", "abc", "/site/", "/site/mp3/", "/site/mp3/Some-Release/",
+  "/site/mp3/Some-Release/01-track.mp3", "/site/MP3/some-release/", "/site/.hidden/",
+  "/site/0day/0101/", "/site/0day/1231/file.zip", "a/b", "a*b", "a?b", "a[b", "a]b",
+  "[", "]", "-", "!", "\\", "/site/x/Sample/", "/site/x/sample/", "file.nfo", "FILE.NFO"
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(star)
+{
+  for (const char* pattern : { "*", "**", "/site/*", "*/", "*.mp3", "/site/*/", "*mp3*",
+                               "/site/*/*/", "a*b*c", "*a*", "/site/*/Sample/*" })
+    for (const char* str : strings) CheckAgainstFnmatch(pattern, str);
+}
+
+BOOST_AUTO_TEST_CASE(question_mark)
+{
+  for (const char* pattern : { "?", "??", "a?", "?b", "a?b", "/site/0day/?\?\?\?/", 
+                               "/site/?/", "*?", "?*?" })
+    for (const char* str : strings) CheckAgainstFnmatch(pattern, str);
+}
+
+BOOST_AUTO_TEST_CASE(character_classes)
+{
+  for (const char* pattern : { "[abc]", "[a-c]b", "[!a]", "[^a]*", "[]]", "[!]]", "[a-]", 
+                               "a[*?]b", "/site/0day/[0-9][0-9][0-9][0-9]/", 
+                               "[[:digit:]]*", "/site/[[:upper:]]*/", "[[:alpha:][:punct:]]",
+                               "[\\]]", "a[", "[", "[!", "*.[nN][fF][oO]" })
+    for (const char* str : strings) CheckAgainstFnmatch(pattern, str);
+}
+
+BOOST_AUTO_TEST_CASE(escapes)
+{
+  for (const char* pattern : { "a\\*b", "a\\?b", "a\\[b", "\\\\", "\\a\\b", "*\\*" })
+    for (const char* str : strings) CheckAgainstFnmatch(pattern, str);
+}
+
+BOOST_AUTO_TEST_CASE(trailing_slash)
+{
+  // directory rules end in a slash and must not match the bare name
+  for (const char* pattern : { "/site/mp3/", "/site/mp3/*/", "/site/*/", "*/Sample/",
+                               "/site/mp3/*", "/site/" })
+    for (const char* str : strings) CheckAgainstFnmatch(pattern, str);
+  
+  util::Glob glob("/site/*/");
+  BOOST_CHECK(glob.Match("/site/mp3/"));
+  BOOST_CHECK(!glob.Match("/site/mp3"));
+}
+
+BOOST_AUTO_TEST_CASE(case_insensitive)
+{
+  for (const char* pattern : { "*.nfo", "/site/mp3/*", "[a-c]B", "FILE.*", "*SAMPLE/" })
+    for (const char* str : strings) CheckAgainstFnmatch(pattern, str, true);
+}
+
+BOOST_AUTO_TEST_CASE(variables)
+{
+  util::Glob glob("/site/private/[:username:]/*", false, { "[:username:]" });
+  std::string bob("bob");
+  const std::string* values[] = { &bob };
+  std::string path("/site/private/bob/file");
+  BOOST_CHECK(glob.Match(path.data(), path.length(), values));
+  path = "/site/private/alice/file";
+  BOOST_CHECK(!glob.Match(path.data(), path.length(), values));
+  
+  // unbound, it's the bracket expression fnmatch would have seen
+  const std::string* unbound[] = { nullptr };
+  path = "/site/private/e/file";
+  BOOST_CHECK(glob.Match(path.data(), path.length(), unbound));
+  path = "/site/private/bob/file";
+  BOOST_CHECK(!glob.Match(path.data(), path.length(), unbound));
+}
+
+BOOST_AUTO_TEST_CASE(randomised)
+{
+  const char alphabet[] = "ab/*?[]!-\\";
+  const char subjects[] = "ab/-*?[]";
+  srand(1);
+  for (int i = 0; i < 20000; ++i)
+  {
+    std::string pattern, str;
+    for (int n = rand() % 8; n > 0; --n) pattern += alphabet[rand() % (sizeof(alphabet) - 1)];
+    for (int n = rand() % 8; n > 0; --n) str += subjects[rand() % (sizeof(subjects) - 1)];
+    CheckAgainstFnmatch(pattern, str);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(glob_list)
+{
+  util::GlobList list(true);
+  list.Add("*.nfo");
+  list.Add("file_id.diz");
+  list.Add("[0-9]*.sfv");
+  BOOST_CHECK(list.Match("release.NFO"));
+  BOOST_CHECK(list.Match("FILE_ID.DIZ"));
+  BOOST_CHECK(list.Match("01.sfv"));
+  BOOST_CHECK(!list.Match("a1.sfv"));
+  BOOST_CHECK(!list.Match("file_id.diz.bak"));
+}
@@ -0,0 +1,135 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#define BOOST_TEST_MODULE listbuffer
+#include <string>
+#include <vector>
+#include <boost/test/included/unit_test.hpp>
+#include "cmd/rfc/dirlist.hpp"
+
+using cmd::rfc::ListBuffer;
+
+namespace
+{
+
+struct Socket : public ftp::Writeable
+{
+  std::vector<std::string> writes;
+  
+  void Write(const char* buffer, size_t len)
+  {
+    writes.emplace_back(buffer, len);
+  }
+  
+  std::string All() const
+  {
+    std::string all;
+    for (const auto& w : writes) all += w;
+    return all;
+  }
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(nothing_written_until_flushed)
+{
+  Socket socket;
+  ListBuffer buffer(socket);
+  buffer.Append("drwxr-xr-x");
+  buffer.Append(' ');
+  BOOST_CHECK(socket.writes.empty());
+  
+  buffer.Flush();
+  BOOST_REQUIRE_EQUAL(socket.writes.size(), 1);
+  BOOST_CHECK_EQUAL(socket.writes[0], "drwxr-xr-x ");
+  
+  // an empty buffer isn't written
+  buffer.Flush();
+  BOOST_CHECK_EQUAL(socket.writes.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(padding_and_numbers)
+{
+  Socket socket;
+  ListBuffer buffer(socket);
+  buffer.AppendNumber(0);
+  buffer.Append('|');
+  buffer.AppendNumber(18446744073709551615ULL);
+  buffer.Append('|');
+  buffer.AppendNumber(42, 5, ListBuffer::Right);
+  buffer.Append('|');
+  buffer.AppendNumber(42, 5, ListBuffer::Left);
+  buffer.Append('|');
+  buffer.AppendPadded("bob", 10, ListBuffer::Left);
+  buffer.Append('|');
+  buffer.AppendPadded("longer than width", 4, ListBuffer::Right);
+  buffer.Append('|');
+  // wider than the padding is written in chunks
+  buffer.AppendPadded("x", 40, ListBuffer::Right);
+  buffer.Flush();
+  
+  BOOST_CHECK_EQUAL(socket.All(), "0|18446744073709551615|   42|42   |bob       |"
+                                  "longer than width|" + std::string(39, ' ') + "x");
+}
+
+BOOST_AUTO_TEST_CASE(fills_then_writes)
+{
+  Socket socket;
+  ListBuffer buffer(socket);
+  
+  // lines that don't divide the buffer evenly, none may be lost or reordered
+  std::string expected;
+  for (int i = 0; i < 10000; ++i)
+  {
+    std::string line("-rw-r--r--   1 bob        iND        " + std::to_string(i) + " file\r\n");
+    buffer.Append(line);
+    expected += line;
+  }
+  buffer.Flush();
+  
+  BOOST_CHECK(socket.writes.size() > 1);
+  for (const auto& w : socket.writes) BOOST_CHECK(w.length() <= 64 * 1024);
+  BOOST_CHECK(socket.All() == expected);
+}
+
+BOOST_AUTO_TEST_CASE(single_characters_at_the_boundary)
+{
+  Socket socket;
+  ListBuffer buffer(socket);
+  std::string expected(64 * 1024 + 10, 'a');
+  for (char ch : expected) buffer.Append(ch);
+  buffer.Flush();
+  
+  BOOST_REQUIRE_EQUAL(socket.writes.size(), 2);
+  BOOST_CHECK_EQUAL(socket.writes[0].length(), 64 * 1024);
+  BOOST_CHECK(socket.All() == expected);
+}
+
+BOOST_AUTO_TEST_CASE(oversized_append_goes_straight_out)
+{
+  Socket socket;
+  ListBuffer buffer(socket);
+  std::string big(100 * 1024, 'b');
+  buffer.Append("before");
+  buffer.Append(big);
+  buffer.Append("after");
+  buffer.Flush();
+  
+  BOOST_REQUIRE_EQUAL(socket.writes.size(), 3);
+  BOOST_CHECK_EQUAL(socket.writes[0], "before");
+  BOOST_CHECK(socket.writes[1] == big);
+  BOOST_CHECK_EQUAL(socket.writes[2], "after");
+}
@@ -0,0 +1,164 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#define BOOST_TEST_MODULE setting
+#include <boost/algorithm/string/replace.hpp>
+#include <boost/test/included/unit_test.hpp>
+#include "cfg/setting.hpp"
+#include "util/string.hpp"
+
+namespace
+{
+
+const char* rules[] =
+{
+  "/site/private/[:username:]/*",
+  "/site/groups/[:groupname:]/*",
+  "/site/[:groupname:]-*/*",
+  "*/Sample/*",
+  "/site/mp3/*.nfo",
+  "/site/mp3/*/",
+  "/site/0day/[0-9][0-9][0-9][0-9]/*",
+  "*.sfv",
+  "/site/*/Subs/",
+  "/site/incoming/*",
+  "/site/mp3/*",
+  "*"
+};
+
+const char* paths[] =
+{
+  "/site/private/bob/file.rar", "/site/private/alice/file.rar", "/site/private/bob",
+  "/site/groups/iND/Release/", "/site/groups/ind/Release/", "/site/groups/[:groupname:]/x",
+  "/site/iND-archive/Release/", "/site/x-archive/Release/", "/site/mp3/Some-Release/Sample/a.avi",
+  "/site/mp3/Some-Release/sample/a.avi", "/site/mp3/Some-Release/a.nfo", "/site/mp3/Some-Release/",
+  "/site/mp3/Some-Release", "/site/0day/0101/file.zip", "/site/0day/01a1/file.zip",
+  "/site/tv/Show/a.sfv", "/site/tv/Show/Subs/", "/site/tv/Show/Subs", "/site/incoming/x/",
+  "/", "/site/", "a.sfv"
+};
+
+// the rule loop every right check ran before the rules were compiled
+int OldMatch(const std::string& path, const std::string& username, const std::string& group)
+{
+  for (size_t i = 0; i < sizeof(rules) / sizeof(rules[0]); ++i)
+  {
+    std::string rule(rules[i]);
+    boost::replace_all(rule, "[:username:]", username);
+    if (!group.empty()) boost::replace_all(rule, "[:groupname:]", group);
+    if (util::WildcardMatch(rule, path)) return i;
+  }
+  return -1;
+}
+
+int NewMatch(const cfg::Rights& rights, const std::string& path, 
+             const std::string& username, const std::string& group)
+{
+  const cfg::Right* right = rights.Match(path, username, !group.empty() ? &group : nullptr);
+  return right ? right - &rights[0] : -1;
+}
+
+cfg::Rights Compile(size_t begin)
+{
+  cfg::Rights rights;
+  for (size_t i = begin; i < sizeof(rules) / sizeof(rules[0]); ++i)
+  {
+    rights.Add({ rules[i], "*" });
+  }
+  return rights;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(rights_first_match_unchanged)
+{
+  cfg::Rights rights(Compile(0));
+  for (const char* username : { "bob", "alice" })
+    for (const char* group : { "iND", "ind", "" })
+      for (const char* path : paths)
+      {
+        BOOST_CHECK_MESSAGE(NewMatch(rights, path, username, group) == 
+                            OldMatch(path, username, group),
+            path << " as " << username << "/" << group);
+      }
+}
+
+BOOST_AUTO_TEST_CASE(rights_path_suffix)
+{
+  // no literal prefix, every path is a candidate for these
+  cfg::Rights rights(Compile(3));
+  BOOST_CHECK_EQUAL(rights.Match("/site/tv/Show/Sample/a.avi", "bob", nullptr)->Path(), "*/Sample/*");
+  BOOST_CHECK_EQUAL(rights.Match("/site/tv/Show/a.sfv", "bob", nullptr)->Path(), "*.sfv");
+  BOOST_CHECK_EQUAL(rights.Match("/site/tv/Show/a.SFV", "bob", nullptr)->Path(), "*");
+  BOOST_CHECK_EQUAL(rights.Match("/site/mp3/x/a.nfo", "bob", nullptr)->Path(), "/site/mp3/*.nfo");
+  BOOST_CHECK(!cfg::Rights().Match("/site/", "bob", nullptr));
+}
+
+BOOST_AUTO_TEST_CASE(rule_matching_is_case_sensitive)
+{
+  cfg::Rights rights(Compile(3));
+  BOOST_CHECK_EQUAL(rights.Match("/site/MP3/x/a.nfo", "bob", nullptr)->Path(), "*");
+  BOOST_CHECK_EQUAL(rights.Match("/site/tv/x/SAMPLE/a", "bob", nullptr)->Path(), "*");
+}
+
+BOOST_AUTO_TEST_CASE(ascii_masks)
+{
+  const std::vector<std::string> masks { "*.nfo", "*.sfv", "file_id.diz", "*/README*" };
+  cfg::AsciiUploads uploads(masks);
+  std::vector<std::string> toks(masks);
+  toks.insert(toks.begin(), "100");
+  cfg::AsciiDownloads downloads(toks);
+  
+  for (const char* path : { "a.nfo", "/site/x/a.nfo", "a.NFO", "a.sfv", "file_id.diz", 
+                            "/site/file_id.diz", "FILE_ID.DIZ", "/site/x/README", 
+                            "/site/x/README.txt", "README", "a.rar" })
+  {
+    bool old = false;
+    for (const auto& mask : masks) old = old || util::WildcardMatch(mask, path);
+    BOOST_CHECK_MESSAGE(uploads.Allowed(path) == old, path);
+    BOOST_CHECK_MESSAGE(downloads.Allowed(1024, path) == old, path);
+  }
+  
+  BOOST_CHECK(!downloads.Allowed(200 * 1024, "a.nfo"));
+  BOOST_CHECK(cfg::AsciiUploads(std::vector<std::string>()).Allowed("a.rar"));
+}
+
+BOOST_AUTO_TEST_CASE(caseless_list)
+{
+  // as idle_commands, which was matched caselessly against the command line
+  const std::vector<std::string> masks { "NOOP", "SITE WHO*", "STAT *", "site idle?" };
+  util::GlobList list(true);
+  list.Add(masks.begin(), masks.end());
+  
+  for (const char* line : { "NOOP", "noop", "NoOp ", "SITE WHO", "site who", "site whois bob", 
+                            "stat", "stat -l", "SITE IDLE1", "site idle", "SITE IDLE12" })
+  {
+    bool old = false;
+    for (const auto& mask : masks) old = old || util::WildcardMatch(mask, line, true);
+    BOOST_CHECK_MESSAGE(list.Match(line) == old, line);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(hidden_files)
+{
+  cfg::HiddenFiles hf({ "/site/*/", ".*", "*.bad", "[Ss]ample" });
+  BOOST_CHECK(hf.Path().Match("/site/mp3/"));
+  BOOST_CHECK(!hf.Path().Match("/site/mp3"));
+  BOOST_CHECK(hf.Masks().Match(".message"));
+  BOOST_CHECK(hf.Masks().Match("x.bad"));
+  BOOST_CHECK(hf.Masks().Match("sample"));
+  BOOST_CHECK(!hf.Masks().Match("SAMPLE"));
+  BOOST_CHECK(!hf.Masks().Match("x.BAD"));
+}
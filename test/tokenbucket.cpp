@@ -0,0 +1,174 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE tokenbucket
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <boost/test/included/unit_test.hpp>
+#include "util/tokenbucket.hpp"
+#include "ftp/counter.hpp"
+#include "cfg/setting.hpp"
+
+using util::TokenBucket;
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+using std::chrono::seconds;
+
+namespace
+{
+
+// buckets run on simulated time so the results don't depend on
+// how quickly or evenly the test gets scheduled
+long long now = 1000000000LL;
+
+long long FakeNow()
+{
+  return now;
+}
+
+void Advance(const nanoseconds& duration)
+{
+  now += duration.count();
+}
+
+struct FakeClock
+{
+  FakeClock() { TokenBucket::SetClock(&FakeNow); }
+  ~FakeClock() { TokenBucket::SetClock(nullptr); }
+};
+
+}
+
+BOOST_GLOBAL_FIXTURE(FakeClock);
+
+BOOST_AUTO_TEST_CASE(unlimited)
+{
+  TokenBucket bucket(0, milliseconds(100));
+  BOOST_CHECK(bucket.Consume(1024 * 1024 * 1024) == nanoseconds(0));
+  
+  bucket.SetRate(1000);
+  BOOST_CHECK_EQUAL(bucket.Rate(), 1000);
+  BOOST_CHECK(bucket.Consume(0) == nanoseconds(0));
+}
+
+BOOST_AUTO_TEST_CASE(burst_is_free)
+{
+  // a full bucket lets a burst's worth through without waiting
+  TokenBucket bucket(1000000, milliseconds(500));
+  Advance(milliseconds(600));
+  BOOST_CHECK(bucket.Consume(400000) == nanoseconds(0));
+  BOOST_CHECK(bucket.Consume(100000) == nanoseconds(0));
+  BOOST_CHECK(bucket.Consume(100000) == milliseconds(100));
+}
+
+BOOST_AUTO_TEST_CASE(wait_matches_rate)
+{
+  // 1MB/s with no burst, 100KB costs 100ms
+  TokenBucket bucket(1000000, nanoseconds(0));
+  BOOST_CHECK(bucket.Consume(100000) == milliseconds(100));
+  
+  // debt accumulates, the next 100KB waits behind the first
+  BOOST_CHECK(bucket.Consume(100000) == milliseconds(200));
+  
+  // and is paid off as time passes
+  Advance(milliseconds(150));
+  BOOST_CHECK(bucket.Consume(100000) == milliseconds(150));
+}
+
+BOOST_AUTO_TEST_CASE(idle_credit_is_capped)
+{
+  TokenBucket bucket(1000000, milliseconds(50));
+  Advance(milliseconds(200));
+  
+  // only 50ms of credit was kept, so 150KB still waits 100ms
+  BOOST_CHECK(bucket.Consume(150000) == milliseconds(100));
+}
+
+BOOST_AUTO_TEST_CASE(shared_between_threads)
+{
+  // concurrent consumers share one rate, none of the charges are lost
+  TokenBucket bucket(1000000, nanoseconds(0));
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i)
+  {
+    threads.emplace_back([&bucket]()
+      {
+        for (int j = 0; j < 1000; ++j) bucket.Consume(100);
+      });
+  }
+  for (auto& thread : threads) thread.join();
+  
+  // 800KB was charged in total, the clock hasn't moved
+  BOOST_CHECK(bucket.Consume(1000) == milliseconds(801));
+}
+
+BOOST_AUTO_TEST_CASE(many_transfers_share_section_limit)
+{
+  // 1000K/s for everything below /site, split between 40 transfers with
+  // differing buffer sizes that each sleep for whatever the shared
+  // bucket tells them to, as SpeedControl::Apply does
+  cfg::SpeedLimit limit({ "/site/*", "1000", "1000", "*" });
+  const long long rate = 1000 * 1024;
+  
+  struct Transfer
+  {
+    std::vector<ftp::SpeedBucketPtr> buckets;
+    long long chunk;
+    long long ready;
+  };
+  
+  std::vector<Transfer> transfers;
+  for (int i = 0; i < 40; ++i)
+  {
+    Transfer transfer;
+    transfer.buckets = ftp::Counter::DownloadSpeeds().Acquire({ &limit });
+    transfer.chunk = 4096 * (1 + i % 16);
+    transfer.ready = now;
+    BOOST_REQUIRE_EQUAL(transfer.buckets.size(), 1U);
+    transfers.emplace_back(std::move(transfer));
+  }
+  
+  for (const auto& transfer : transfers)
+  {
+    BOOST_CHECK(transfer.buckets.front() == transfers.front().buckets.front());
+  }
+  
+  const long long start = now;
+  const long long end = start + nanoseconds(seconds(600)).count();
+  long long bytes = 0;
+  while (true)
+  {
+    auto next = std::min_element(transfers.begin(), transfers.end(),
+                    [](const Transfer& a, const Transfer& b) { return a.ready < b.ready; });
+    if (next->ready >= end) break;
+    
+    now = next->ready;
+    bytes += next->chunk;
+    nanoseconds wait(0);
+    for (auto& bucket : next->buckets)
+    {
+      wait = std::max(wait, bucket->Consume(next->chunk));
+    }
+    next->ready = now + wait.count();
+  }
+  
+  // each transfer's last chunk is sent before it is paid for, over ten
+  // minutes that overshoot is well inside the tolerance
+  double actual = bytes / 600.0;
+  BOOST_TEST_MESSAGE("aggregate " << actual << " bytes/s, limit " << rate);
+  BOOST_CHECK_LE(actual, rate * 1.01);
+  BOOST_CHECK_GE(actual, rate * 0.99);
+}
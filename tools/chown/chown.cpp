@@ -34,6 +34,7 @@ std::shared_ptr<cfg::Config> config;
 void DisplayHelp(char* argv0, boost::program_options::options_description& desc)
 {
   std::cout << "usage: " << argv0 << " [options] [user][:[group]] <path> [<path>..]" << std::endl;
+  std::cout << "       " << argv0 << " --migrate [options] <path> [<path>..]" << std::endl;
   std::cout << desc;
 }
 
@@ -42,7 +43,7 @@ void DisplayVersion()
   std::cout << "ebftpd chown " + std::string(version) << std::endl;
 }
 
-bool ParseOptions(int argc, char** argv, bool& recursive, std::string& configPath,
+bool ParseOptions(int argc, char** argv, bool& recursive, bool& migrate, std::string& configPath,
                   std::string& user, std::string& group, std::vector<std::string>& paths)
 {
   namespace po = boost::program_options;
@@ -52,14 +53,15 @@ bool ParseOptions(int argc, char** argv, bool& recursive, std::string& configPat
     ("version,v", "display version")
     ("config-path,c", po::value<std::string>(), "specify location of config file")
     ("recursive,R", "apply changes recursively")
+    ("migrate,m", "convert old text ownership attributes to the binary format")
   ;
 
   std::string who;
   po::options_description all("positional options");
   all.add(visible);
   all.add_options()
-    ("who", po::value<std::string>(&who)->required(), "who")
-    ("paths", po::value(&paths)->required(), "paths")
+    ("who", po::value<std::string>(&who), "who")
+    ("paths", po::value(&paths), "paths")
   ;
 
   po::positional_options_description pos;
@@ -86,16 +88,30 @@ bool ParseOptions(int argc, char** argv, bool& recursive, std::string& configPat
 
     po::notify(vm);
 
-    boost::smatch match;
-    if (!boost::regex_match(who, match, boost::regex("(\\w+)?(?::(\\w+))?")))
-      throw boost::program_options::error("invalid user:group option specified");
+    // with --migrate there's no owner, so the first positional is a path
+    migrate = vm.count("migrate") > 0;
+    if (migrate)
+    {
+      if (vm.count("who")) paths.insert(paths.begin(), who);
+    }
+    else
+    {
+      if (!vm.count("who"))
+        throw boost::program_options::error("no user:group specified");
+        
+      boost::smatch match;
+      if (!boost::regex_match(who, match, boost::regex("(\\w+)?(?::(\\w+))?")))
+        throw boost::program_options::error("invalid user:group option specified");
 
-    user = match[1].str();
-    group = match[2].str();
+      user = match[1].str();
+      group = match[2].str();
 
-    if (user.empty() && group.empty())
-      throw boost::program_options::error("invalid user:group option specified");
+      if (user.empty() && group.empty())
+        throw boost::program_options::error("invalid user:group option specified");
+    }
     
+    if (paths.empty())
+      throw boost::program_options::error("no path specified");
   }
   catch (const boost::program_options::error& e)
   {
@@ -140,6 +156,39 @@ void SetOwner(Iterator begin, Iterator end, const fs::Owner& owner, bool recursi
   }
 }
 
+template <typename Iterator>
+void MigrateOwner(Iterator begin, Iterator end, bool recursive, long long& migrated)
+{
+  using namespace util::path;
+
+  for (auto it = begin; it != end; ++it)
+  {
+    const std::string& path = *it;
+    
+    bool pathMigrated;
+    auto e = fs::MigrateOwner(path, pathMigrated);
+    if (!e) std::cerr << path << ": " << e.Message() << std::endl;
+    else if (pathMigrated) ++migrated;
+    
+    if (recursive)
+    {
+      try
+      {
+        auto status = Status(path);
+        if (status.IsDirectory() && !status.IsSymLink())
+        {
+          MigrateOwner(DirIterator(path, DirIterator::AbsolutePath), 
+                       DirIterator(), recursive, migrated);
+        }
+      }
+      catch (const util::SystemError& e)
+      {
+        std::cerr << path << ": " << e.Message() << std::endl;
+      }
+    }
+  }
+}
+
 acl::UserID LookupUID(db::SafeConnection& conn, const std::string& user)
 {
   auto query = QUERY("name" << user);
@@ -188,8 +237,17 @@ int main(int argc, char** argv)
   std::vector<std::string> paths;
   std::string configPath;
   bool recursive = false;
+  bool migrate = false;
+
+  if (!ParseOptions(argc, argv, recursive, migrate, configPath, user, group, paths)) return 1;
 
-  if (!ParseOptions(argc, argv, recursive, configPath, user, group, paths)) return 1;
+  if (migrate)
+  {
+    long long migrated = 0;
+    MigrateOwner(paths.begin(), paths.end(), recursive, migrated);
+    std::cout << "Migrated ownership of " << migrated << " path(s)" << std::endl;
+    return 0;
+  }
 
   try
   {
@@ -0,0 +1,481 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include "util/glob.hpp"
+
+namespace util
+{
+
+namespace
+{
+
+const size_t noMatch = static_cast<size_t>(-1);
+
+int (*CharClass(const std::string& name))(int)
+{
+  static const std::pair<const char*, int(*)(int)> classes[] =
+  {
+    { "alnum", isalnum }, { "alpha", isalpha }, { "blank", isblank },
+    { "cntrl", iscntrl }, { "digit", isdigit }, { "graph", isgraph },
+    { "lower", islower }, { "print", isprint }, { "punct", ispunct },
+    { "space", isspace }, { "upper", isupper }, { "xdigit", isxdigit }
+  };
+  
+  for (const auto& cls : classes)
+  {
+    if (name == cls.first) return cls.second;
+  }
+  return nullptr;
+}
+
+}
+
+Glob::Glob(const std::string& pattern, bool iCase, const std::vector<std::string>& variables) :
+  pattern(pattern),
+  iCase(iCase),
+  shape(Shape::General)
+{
+  std::string::size_type pos = 0;
+  while (pos < pattern.length())
+  {
+    bool variable = false;
+    for (unsigned i = 0; i < variables.size(); ++i)
+    {
+      if (!variables[i].empty() && !pattern.compare(pos, variables[i].length(), variables[i]))
+      {
+        std::string::size_type end;
+        unsigned set = sets.size();
+        if (!ParseSet(pos, end)) sets.emplace_back();
+        tokens.emplace_back(Op::Variable, i, set);
+        pos += variables[i].length();
+        variable = true;
+        break;
+      }
+    }
+    if (variable) continue;
+    
+    char ch = pattern[pos];
+    if (ch == '*')
+    {
+      if (tokens.empty() || tokens.back().op != Op::Star) tokens.emplace_back(Op::Star);
+      ++pos;
+    }
+    else if (ch == '?')
+    {
+      tokens.emplace_back(Op::Any);
+      ++pos;
+    }
+    else if (ch == '[')
+    {
+      std::string::size_type end;
+      unsigned set = sets.size();
+      if (ParseSet(pos, end))
+      {
+        tokens.emplace_back(Op::Set, set);
+        pos = end;
+      }
+      else
+      {
+        AppendLiteral(ch);
+        ++pos;
+      }
+    }
+    else if (ch == '\\')
+    {
+      if (pos + 1 < pattern.length()) AppendLiteral(pattern[pos + 1]);
+      else
+      {
+        // fnmatch never matches a pattern ending in an escape
+        tokens.emplace_back(Op::Set, sets.size());
+        sets.emplace_back();
+      }
+      pos += 2;
+    }
+    else
+    {
+      AppendLiteral(ch);
+      ++pos;
+    }
+  }
+  
+  Classify();
+}
+
+void Glob::Classify()
+{
+  auto is = [&](std::initializer_list<Op> ops)
+    {
+      return std::equal(ops.begin(), ops.end(), tokens.begin(), 
+                        [](Op op, const Token& token) { return op == token.op; });
+    };
+  
+  switch (tokens.size())
+  {
+    case 0  :
+      shape = Shape::Exact;
+      break;
+    case 1  :
+      if (is({ Op::Literal })) shape = Shape::Exact;
+      else if (is({ Op::Star })) shape = Shape::Anything;
+      break;
+    case 2  :
+      if (is({ Op::Literal, Op::Star })) shape = Shape::Prefix;
+      else if (is({ Op::Star, Op::Literal })) shape = Shape::Suffix;
+      break;
+    case 3  :
+      if (!iCase && is({ Op::Star, Op::Literal, Op::Star })) shape = Shape::Contains;
+      break;
+  }
+}
+
+void Glob::AppendLiteral(char ch)
+{
+  if (tokens.empty() || tokens.back().op != Op::Literal)
+    tokens.emplace_back(Op::Literal, literals.length());
+  literals += iCase ? std::tolower(static_cast<unsigned char>(ch)) : ch;
+  ++tokens.back().length;
+}
+
+// parses the bracket expression at pos into a new set, 
+// returns false leaving sets unchanged if it isn't terminated
+bool Glob::ParseSet(std::string::size_type pos, std::string::size_type& end)
+{
+  std::bitset<256> set;
+  // a caseless set holds lower case and is indexed by the lowered character
+  auto fold = [&](unsigned char ch) -> unsigned char
+    { return iCase ? std::tolower(ch) : ch; };
+  
+  std::string::size_type i = pos + 1;
+  bool negate = false;
+  if (i < pattern.length() && (pattern[i] == '!' || pattern[i] == '^'))
+  {
+    negate = true;
+    ++i;
+  }
+  
+  bool first = true;
+  while (i < pattern.length())
+  {
+    unsigned char ch = pattern[i];
+    if (ch == ']' && !first)
+    {
+      if (negate) set.flip();
+      sets.emplace_back(set);
+      end = i + 1;
+      return true;
+    }
+    first = false;
+    
+    if (ch == '[' && i + 1 < pattern.length() && pattern[i + 1] == ':')
+    {
+      auto close = pattern.find(":]", i + 2);
+      if (close != std::string::npos)
+      {
+        auto predicate = CharClass(pattern.substr(i + 2, close - i - 2));
+        if (!predicate) return false;
+        for (unsigned c = 0; c < 256; ++c)
+        {
+          if (predicate(c)) set.set(fold(c));
+        }
+        i = close + 2;
+        continue;
+      }
+    }
+    
+    if (ch == '\\' && i + 1 < pattern.length()) ch = pattern[++i];
+    ++i;
+    
+    if (i + 1 < pattern.length() && pattern[i] == '-' && pattern[i + 1] != ']')
+    {
+      unsigned char last = pattern[i + 1];
+      i += 2;
+      if (last == '\\' && i < pattern.length()) last = pattern[i++];
+      for (unsigned c = fold(ch); c <= fold(last); ++c) set.set(c);
+    }
+    else
+      set.set(fold(ch));
+  }
+  
+  return false;
+}
+
+bool Glob::Compare(const char* lhs, const char* rhs, size_t length) const
+{
+  if (!iCase) return !std::memcmp(lhs, rhs, length);
+  for (size_t i = 0; i < length; ++i)
+  {
+    if (std::tolower(static_cast<unsigned char>(lhs[i])) != 
+        std::tolower(static_cast<unsigned char>(rhs[i]))) return false;
+  }
+  return true;
+}
+
+// returns the number of characters matched or noMatch
+size_t Glob::MatchToken(const Token& token, const char* str, size_t length,
+                        const std::string* const* values) const
+{
+  switch (token.op)
+  {
+    case Op::Literal  :
+      if (token.length > length || 
+          !Compare(literals.data() + token.index, str, token.length)) return noMatch;
+      return token.length;
+    case Op::Any      :
+      return length > 0 ? 1 : noMatch;
+    case Op::Set      :
+      return length > 0 && sets[token.index][Fold(*str)] ? 1 : noMatch;
+    case Op::Variable :
+    {
+      const std::string* value = values ? values[token.index] : nullptr;
+      if (!value)
+        return length > 0 && sets[token.length][Fold(*str)] ? 1 : noMatch;
+      if (value->length() > length || 
+          !Compare(value->data(), str, value->length())) return noMatch;
+      return value->length();
+    }
+    case Op::Star     :
+      break;
+  }
+  return noMatch;
+}
+
+// where the star before token may stop to let the rest match from pos on,
+// a literal after the star can only match where its first character is
+size_t Glob::SkipStar(size_t token, const char* str, size_t pos, size_t length) const
+{
+  if (tokens[token].op != Op::Literal || iCase) return pos;
+  const void* found = std::memchr(str + pos, literals[tokens[token].index], length - pos);
+  return found ? static_cast<const char*>(found) - str : noMatch;
+}
+
+// every token other than a star matches a fixed number of characters,
+// so on a mismatch it's enough to let the last star take one more
+bool Glob::Match(const char* str, size_t length, const std::string* const* values) const
+{
+  switch (shape)
+  {
+    case Shape::Exact     :
+      return length == literals.length() && Compare(literals.data(), str, length);
+    case Shape::Prefix    :
+      return length >= literals.length() && Compare(literals.data(), str, literals.length());
+    case Shape::Suffix    :
+      return length >= literals.length() && 
+             Compare(literals.data(), str + length - literals.length(), literals.length());
+    case Shape::Contains  :
+      return std::search(str, str + length, literals.begin(), literals.end()) != str + length;
+    case Shape::Anything  :
+      return true;
+    case Shape::General   :
+      break;
+  }
+  
+  size_t token = 0;
+  size_t pos = 0;
+  size_t starToken = noMatch;
+  size_t starPos = 0;
+  
+  while (true)
+  {
+    if (token < tokens.size())
+    {
+      if (tokens[token].op == Op::Star)
+      {
+        starToken = ++token;
+        if (starToken == tokens.size()) return true;
+        starPos = pos = SkipStar(starToken, str, pos, length);
+        if (pos == noMatch) return false;
+        continue;
+      }
+      
+      size_t matched = MatchToken(tokens[token], str + pos, length - pos, values);
+      if (matched != noMatch)
+      {
+        pos += matched;
+        ++token;
+        continue;
+      }
+    }
+    else if (pos == length) return true;
+    
+    if (starToken == noMatch || starPos == length) return false;
+    token = starToken;
+    starPos = pos = SkipStar(starToken, str, starPos + 1, length);
+    if (pos == noMatch) return false;
+  }
+}
+
+size_t Glob::Length(const Token& token, const std::string* const* values) const
+{
+  switch (token.op)
+  {
+    case Op::Literal  :
+      return token.length;
+    case Op::Variable :
+      if (values && values[token.index]) return values[token.index]->length();
+      return 1;
+    case Op::Star     :
+      return noMatch;
+    default           :
+      return 1;
+  }
+}
+
+// ch is -1 for whichever character other than a slash suits the token
+bool Glob::Consume(const Token& token, size_t offset, int ch, 
+                   const std::string* const* values) const
+{
+  std::bitset<256> slash;
+  slash.set('/');
+  
+  switch (token.op)
+  {
+    case Op::Literal  :
+      return ch < 0 ? literals[token.index + offset] != '/' : 
+                      literals[token.index + offset] == static_cast<char>(Fold(ch));
+    case Op::Any      :
+      return true;
+    case Op::Set      :
+      return ch < 0 ? (sets[token.index] & ~slash).any() : sets[token.index][Fold(ch)];
+    case Op::Variable :
+    {
+      const std::string* value = values ? values[token.index] : nullptr;
+      if (!value)
+        return ch < 0 ? (sets[token.length] & ~slash).any() : sets[token.length][Fold(ch)];
+      return ch < 0 ? (*value)[offset] != '/' : Fold((*value)[offset]) == Fold(ch);
+    }
+    case Op::Star     :
+      return true;
+  }
+  return false;
+}
+
+// adds the state and every state reachable from it without a character
+void Glob::Close(size_t token, size_t offset, std::vector<State>& states, 
+                 const std::string* const* values) const
+{
+  while (true)
+  {
+    if (token < tokens.size() && offset == Length(tokens[token], values))
+    {
+      ++token;
+      offset = 0;
+      continue;
+    }
+    
+    State state(token, offset);
+    if (std::find(states.begin(), states.end(), state) != states.end()) return;
+    states.emplace_back(state);
+    if (token == tokens.size() || tokens[token].op != Op::Star) return;
+    ++token;
+  }
+}
+
+void Glob::Step(const std::vector<State>& states, int ch, std::vector<State>& next,
+                const std::string* const* values) const
+{
+  for (const auto& state : states)
+  {
+    if (state.first == tokens.size()) continue;
+    const Token& token = tokens[state.first];
+    if (token.op == Op::Star) Close(state.first, 0, next, values);
+    else if (Consume(token, state.second, ch, values))
+      Close(state.first, state.second + 1, next, values);
+  }
+}
+
+Glob::Outcome Glob::MatchSegment(const char* prefix, size_t length, bool directory,
+                                 const std::string* const* values) const
+{
+  std::vector<State> states;
+  std::vector<State> next;
+  Close(0, 0, states, values);
+  for (size_t i = 0; i < length && !states.empty(); ++i)
+  {
+    next.clear();
+    Step(states, static_cast<unsigned char>(prefix[i]), next, values);
+    states.swap(next);
+  }
+  
+  for (const auto& state : states)
+  {
+    if (state.first + 1 == tokens.size() && tokens[state.first].op == Op::Star)
+      return Outcome::Always;
+  }
+  
+  // every state reachable by a non empty segment
+  std::vector<State> reach;
+  Step(states, -1, reach, values);
+  for (size_t i = 0; i < reach.size(); ++i)
+  {
+    next.clear();
+    Step(std::vector<State>(1, reach[i]), -1, next, values);
+    for (const auto& state : next)
+    {
+      if (std::find(reach.begin(), reach.end(), state) == reach.end()) 
+        reach.emplace_back(state);
+    }
+  }
+  
+  if (directory)
+  {
+    next.clear();
+    Step(reach, '/', next, values);
+    reach.swap(next);
+  }
+  
+  for (const auto& state : reach)
+  {
+    if (state.first == tokens.size()) return Outcome::Depends;
+  }
+  return Outcome::Never;
+}
+
+void GlobList::Add(const std::string& pattern)
+{
+  patterns.emplace_back(pattern);
+  Glob glob(pattern, iCase);
+  if (glob.Exact()) exact.insert(*glob.Exact());
+  else if (glob.Simple()) globs.insert(globs.begin() + simple++, std::move(glob));
+  else globs.emplace_back(std::move(glob));
+}
+
+bool GlobList::Match(const std::string& str) const
+{
+  if (!exact.empty())
+  {
+    if (!iCase)
+    {
+      if (exact.count(str)) return true;
+    }
+    else
+    {
+      std::string folded(str);
+      std::transform(folded.begin(), folded.end(), folded.begin(), 
+                     [](unsigned char ch) { return std::tolower(ch); });
+      if (exact.count(folded)) return true;
+    }
+  }
+  
+  for (const auto& glob : globs)
+  {
+    if (glob.Match(str)) return true;
+  }
+  return false;
+}
+
+} /* util namespace */
@@ -0,0 +1,138 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __UTIL_GLOB_HPP
+#define __UTIL_GLOB_HPP
+
+#include <bitset>
+#include <cctype>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace util
+{
+
+// fnmatch(3) pattern compiled once and matched without flags, so as
+// with WildcardMatch '*' and '?' also match '/' and leading dots
+//
+// variables are literal strings in the pattern, like [:username:], whose
+// text is supplied with each match instead of being substituted into a
+// copy of the pattern
+class Glob
+{
+  enum class Op : unsigned char { Literal, Any, Set, Star, Variable };
+  
+  struct Token
+  {
+    Op op;
+    unsigned index;  // literal offset, set number or variable number
+    unsigned length; // literal length or for a variable the set to match when unbound
+    
+    Token(Op op, unsigned index = 0, unsigned length = 0) : 
+      op(op), index(index), length(length) { }
+  };
+
+  // patterns that are one literal and stars at either end are matched
+  // by comparing the literal without going through the tokens
+  enum class Shape : unsigned char { General, Exact, Prefix, Suffix, Contains, Anything };
+
+  typedef std::pair<size_t, size_t> State; // token, characters of it matched
+
+  std::string pattern;
+  std::string literals;
+  std::vector<std::bitset<256>> sets;
+  std::vector<Token> tokens;
+  bool iCase;
+  Shape shape;
+  
+  void Classify();
+  bool ParseSet(std::string::size_type pos, std::string::size_type& end);
+  void AppendLiteral(char ch);
+  unsigned char Fold(char ch) const
+  {
+    return iCase ? std::tolower(static_cast<unsigned char>(ch)) : 
+                   static_cast<unsigned char>(ch);
+  }
+  
+  bool Compare(const char* lhs, const char* rhs, size_t length) const;
+  size_t Length(const Token& token, const std::string* const* values) const;
+  bool Consume(const Token& token, size_t offset, int ch, const std::string* const* values) const;
+  void Close(size_t token, size_t offset, std::vector<State>& states, 
+             const std::string* const* values) const;
+  void Step(const std::vector<State>& states, int ch, std::vector<State>& next,
+            const std::string* const* values) const;
+  size_t SkipStar(size_t token, const char* str, size_t pos, size_t length) const;
+  size_t MatchToken(const Token& token, const char* str, size_t length, 
+                    const std::string* const* values) const;
+  
+public:
+  enum class Outcome { Never, Always, Depends };
+
+  Glob() : iCase(false), shape(Shape::Exact) { }
+  explicit Glob(const std::string& pattern, bool iCase = false, 
+                const std::vector<std::string>& variables = std::vector<std::string>());
+  
+  const std::string& Pattern() const { return pattern; }
+  bool CaseInsensitive() const { return iCase; }
+  
+  // the only string matched, lower case if caseless, null for a pattern with wildcards
+  const std::string* Exact() const { return shape == Shape::Exact ? &literals : nullptr; }
+  bool Simple() const { return shape != Shape::General; }
+  
+  bool Match(const std::string& str) const
+  { return Match(str.data(), str.length(), nullptr); }
+  
+  // values holds one pointer per variable, an unbound variable is
+  // matched as the bracket expression its name looks like, as fnmatch would
+  bool Match(const char* str, size_t length, const std::string* const* values) const;
+  
+  // whether the pattern matches prefix followed by any one path segment, 
+  // with a trailing slash if directory is true, Depends if that varies 
+  // with the segment or can't be proven either way
+  Outcome MatchSegment(const char* prefix, size_t length, bool directory,
+                       const std::string* const* values) const;
+};
+
+// any of a list of patterns, those without wildcards are looked up in a hash
+// set and the rest tried with the cheapest shapes first
+class GlobList
+{
+  std::vector<std::string> patterns;
+  std::unordered_set<std::string> exact;
+  std::vector<Glob> globs;
+  size_t simple; // globs before this have a shape matched without tokens
+  bool iCase;
+  
+public:
+  explicit GlobList(bool iCase = false) : simple(0), iCase(iCase) { }
+  
+  void Add(const std::string& pattern);
+  
+  template <typename Iterator>
+  void Add(Iterator begin, Iterator end)
+  {
+    for (; begin != end; ++begin) Add(*begin);
+  }
+  
+  bool Match(const std::string& str) const;
+  
+  const std::vector<std::string>& Patterns() const { return patterns; }
+  bool Empty() const { return patterns.empty(); }
+};
+
+} /* util namespace */
+
+#endif
@@ -30,6 +30,10 @@
 
 #include <sys/extattr.h>
 
+#ifndef XATTR_CREATE
+# define XATTR_CREATE 0x1
+#endif
+
 inline int setxattr(const char *path, const char *name, const void *value, size_t size, int /* flags */)
 {
   int ret = extattr_set_file(path, EXTATTR_NAMESPACE_USER, name, value, size);
@@ -41,6 +45,11 @@ inline ssize_t getxattr(const char *path, const char *name, void *value, size_t
   return extattr_get_file(path, EXTATTR_NAMESPACE_USER, name, value, size);
 }
 
+inline ssize_t fgetxattr(int fd, const char *name, void *value, size_t size)
+{
+  return extattr_get_fd(fd, EXTATTR_NAMESPACE_USER, name, value, size);
+}
+
 inline int removexattr(const char *path, const char *name)
 {
   return extattr_delete_file(path, EXTATTR_NAMESPACE_USER, name);
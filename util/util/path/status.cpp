@@ -38,6 +38,14 @@ Status::Status(const std::string& path) :
   Reset();
 }
 
+Status::Status(const struct stat& native, mode_t linkMode) :
+  native(native),
+  linkDirectory(S_ISLNK(native.st_mode) && S_ISDIR(linkMode)),
+  linkRegularFile(S_ISLNK(native.st_mode) && S_ISREG(linkMode)),
+  statOkay(true)
+{
+}
+
 Status& Status::Reset()
 {
   if (path.empty()) throw std::logic_error("no path set");
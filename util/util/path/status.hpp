@@ -40,6 +40,9 @@ class Status
 public:
   Status();
   Status(const std::string& path);
+  // from an lstat result already in hand, linkMode is the mode of
+  // the target when native is a symlink
+  Status(const struct stat& native, mode_t linkMode = 0);
   
   Status& Reset(const std::string& path);
   
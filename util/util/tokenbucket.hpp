@@ -0,0 +1,97 @@
+//    Copyright (C) 2012, 2013 ebftpd team
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __UTIL_TOKENBUCKET_HPP
+#define __UTIL_TOKENBUCKET_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace util
+{
+
+// lock free token bucket implemented as a generic cell rate algorithm,
+// the whole bucket state is a single theoretical arrival time so
+// any number of threads can consume from the same bucket with a cas loop
+class TokenBucket
+{
+  std::atomic<long long> rate;  // bytes per second
+  std::atomic<long long> burst; // nanoseconds of credit an idle bucket may accumulate
+  std::atomic<long long> tat;   // nanoseconds on the bucket clock
+
+  static long long SteadyNow()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+  
+  static std::atomic<long long (*)()>& ClockSource()
+  {
+    static std::atomic<long long (*)()> clock(&SteadyNow);
+    return clock;
+  }
+  
+  static long long Now()
+  {
+    return ClockSource().load(std::memory_order_relaxed)();
+  }
+
+public:
+  // nanoseconds on a monotonic clock, the steady clock unless replaced
+  // so tests can run buckets on simulated time. set before creating
+  // any buckets, nullptr restores the steady clock
+  typedef long long (*Clock)();
+  static void SetClock(Clock clock)
+  {
+    ClockSource().store(clock ? clock : &SteadyNow, std::memory_order_relaxed);
+  }
+
+  TokenBucket(long long rate, const std::chrono::nanoseconds& burst) :
+    rate(rate), burst(burst.count()), tat(Now())
+  { }
+
+  TokenBucket(const TokenBucket&) = delete;
+  TokenBucket& operator=(const TokenBucket&) = delete;
+
+  long long Rate() const { return rate.load(std::memory_order_relaxed); }
+  void SetRate(long long rate) { this->rate.store(rate, std::memory_order_relaxed); }
+
+  // takes bytes already sent out of the bucket and returns how long
+  // the caller must wait before sending any more
+  std::chrono::nanoseconds Consume(long long bytes)
+  {
+    long long rate = this->rate.load(std::memory_order_relaxed);
+    if (rate <= 0 || bytes <= 0) return std::chrono::nanoseconds(0);
+
+    long long cost = static_cast<long long>(bytes * (1000000000.0 / rate));
+    long long burst = this->burst.load(std::memory_order_relaxed);
+    long long now = Now();
+    long long current = tat.load(std::memory_order_relaxed);
+    long long next;
+    do
+    {
+      next = std::max(current, now - burst) + cost;
+    }
+    while (!tat.compare_exchange_weak(current, next, std::memory_order_acq_rel,
+                                      std::memory_order_relaxed));
+
+    return std::chrono::nanoseconds(std::max(0LL, next - now));
+  }
+};
+
+} /* util namespace */
+
+#endif